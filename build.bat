@@ -4,6 +4,9 @@ python .\src\net\rpc_parse.py .\src\net\messages.rpc .\src\net
 if not exist build mkdir build
 @REM pushd src
 @REM clang -g -std=c++17 ./fracas_server.cpp -o ../build/fracas_server.exe
+@REM clang -g -std=c++17 ./fracas_bots.cpp -o ../build/fracas_bots.exe
+@REM clang -g -std=c++17 ./fracas_questions.cpp -o ../build/fracas_questions.exe
+@REM clang -g -O2 -std=c++17 ./fracas_bench.cpp -o ../build/fracas_bench.exe
 @REM popd
 
 clang -g -std=c++17 ./src/fracas_client.cpp ^
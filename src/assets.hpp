@@ -102,15 +102,15 @@ Mesh load_mesh(String filepath, int asset_id, Memory mem)
 }
 
 struct Assets {
-  FreeList<VertexBuffer> vertex_buffers;
-  FreeList<Mesh> meshes;
-  FreeList<RenderTarget> render_targets;
-  FreeList<Texture> textures;
-  FreeList<EnvMap> env_maps;
-  FreeList<Material> materials;
-  FreeList<Shader> shaders;
-  FreeList<FileData> font_files;
-  FreeList<KeyedAnimation> keyed_animations;
+  Pool<VertexBuffer> vertex_buffers;
+  Pool<Mesh> meshes;
+  Pool<RenderTarget> render_targets;
+  Pool<Texture> textures;
+  Pool<EnvMap> env_maps;
+  Pool<Material> materials;
+  Pool<Shader> shaders;
+  Pool<FileData> font_files;
+  Pool<KeyedAnimation> keyed_animations;
 
   std::map<std::pair<int, int>, Font> fonts;
 
@@ -129,92 +129,87 @@ struct Assets {
 
   void save(String filepath)
   {
-    auto tmp = Temp::start(&assets_temp_allocator);
+    auto tmp = Temp::start(&assets_temp_allocator, "assets save");
 
     auto assets               = YAML::new_dict(tmp);
     auto keyed_animations_out = YAML::new_list(tmp);
 
-    for (u32 i = 0; i < keyed_animations.size; i++) {
-      if (keyed_animations.data[i].assigned) {
-        KeyedAnimation *ka = &keyed_animations.data[i].value;
-
-        auto keyed_animation_out = YAML::new_dict(tmp);
-
-        keyed_animation_out->push_back(
-            "asset_id", YAML::new_literal(String::from(ka->asset_id, tmp), tmp), tmp);
-        keyed_animation_out->push_back("asset_name", YAML::new_literal(ka->asset_name, tmp), tmp);
-        keyed_animation_out->push_back("fps", YAML::new_literal(String::from(ka->fps, tmp), tmp),
-                                       tmp);
-
-        keyed_animation_out->push_back(
-            "start_frame", YAML::new_literal(String::from(ka->start_frame, tmp), tmp), tmp);
-        keyed_animation_out->push_back(
-            "end_frame", YAML::new_literal(String::from(ka->end_frame, tmp), tmp), tmp);
-
-        auto tracks_out = YAML::new_list(tmp);
-        for (u32 track_i = 0; track_i < ka->tracks.count; track_i++) {
-          KeyedAnimationTrack *track = &ka->tracks[track_i];
-
-          auto track_out = YAML::new_dict(tmp);
-          track_out->push_back("entity_id",
-                               YAML::new_literal(String::from(track->entity_id, tmp), tmp), tmp);
-
-          auto keys_out = YAML::new_list(tmp);
-          for (u32 key_i = 0; key_i < track->keys.count; key_i++) {
-            KeyedAnimationTrack::Key *key = &track->keys[key_i];
-
-            auto key_out = YAML::new_dict(tmp);
-
-            YAML::Dict *transform_yaml = YAML::new_dict(tmp);
-            YAML::Dict *position_yaml  = YAML::new_dict(tmp);
-            position_yaml->push_back(
-                "x", YAML::new_literal(String::from(key->transform.position.x, tmp), tmp), tmp);
-            position_yaml->push_back(
-                "y", YAML::new_literal(String::from(key->transform.position.y, tmp), tmp), tmp);
-            position_yaml->push_back(
-                "z", YAML::new_literal(String::from(key->transform.position.z, tmp), tmp), tmp);
-            YAML::Dict *rotation_yaml = YAML::new_dict(tmp);
-            rotation_yaml->push_back(
-                "x", YAML::new_literal(String::from(key->transform.rotation.x, tmp), tmp), tmp);
-            rotation_yaml->push_back(
-                "y", YAML::new_literal(String::from(key->transform.rotation.y, tmp), tmp), tmp);
-            rotation_yaml->push_back(
-                "z", YAML::new_literal(String::from(key->transform.rotation.z, tmp), tmp), tmp);
-            YAML::Dict *scale_yaml = YAML::new_dict(tmp);
-            scale_yaml->push_back(
-                "x", YAML::new_literal(String::from(key->transform.scale.x, tmp), tmp), tmp);
-            scale_yaml->push_back(
-                "y", YAML::new_literal(String::from(key->transform.scale.y, tmp), tmp), tmp);
-            scale_yaml->push_back(
-                "z", YAML::new_literal(String::from(key->transform.scale.z, tmp), tmp), tmp);
-            transform_yaml->push_back("position", position_yaml, tmp);
-            transform_yaml->push_back("rotation", rotation_yaml, tmp);
-            transform_yaml->push_back("scale", scale_yaml, tmp);
-            key_out->push_back("transform", transform_yaml, tmp);
-
-            key_out->push_back(
-                "interpolation_type",
-                YAML::new_literal(String::from((u32)key->interpolation_type, tmp), tmp), tmp);
-            key_out->push_back("frame", YAML::new_literal(String::from(key->frame, tmp), tmp), tmp);
-
-            keys_out->push_back(key_out, tmp);
-          }
-          track_out->push_back("keys", keys_out, tmp);
-
-          tracks_out->push_back(track_out, tmp);
+    for (u32 i : keyed_animations.ids()) {
+      KeyedAnimation *ka = &keyed_animations[i];
+
+      auto keyed_animation_out = YAML::new_dict(tmp);
+
+      keyed_animation_out->push_back(
+          "asset_id", YAML::new_literal(String::from(ka->asset_id, tmp), tmp), tmp);
+      keyed_animation_out->push_back("asset_name", YAML::new_literal(ka->asset_name, tmp), tmp);
+      keyed_animation_out->push_back("fps", YAML::new_literal(String::from(ka->fps, tmp), tmp),
+                                     tmp);
+
+      keyed_animation_out->push_back(
+          "start_frame", YAML::new_literal(String::from(ka->start_frame, tmp), tmp), tmp);
+      keyed_animation_out->push_back(
+          "end_frame", YAML::new_literal(String::from(ka->end_frame, tmp), tmp), tmp);
+
+      auto tracks_out = YAML::new_list(tmp);
+      for (u32 track_i = 0; track_i < ka->tracks.count; track_i++) {
+        KeyedAnimationTrack *track = &ka->tracks[track_i];
+
+        auto track_out = YAML::new_dict(tmp);
+        track_out->push_back("entity_id",
+                             YAML::new_literal(String::from(track->entity_id, tmp), tmp), tmp);
+
+        auto keys_out = YAML::new_list(tmp);
+        for (u32 key_i = 0; key_i < track->keys.count; key_i++) {
+          KeyedAnimationTrack::Key *key = &track->keys[key_i];
+
+          auto key_out = YAML::new_dict(tmp);
+
+          YAML::Dict *transform_yaml = YAML::new_dict(tmp);
+          YAML::Dict *position_yaml  = YAML::new_dict(tmp);
+          position_yaml->push_back(
+              "x", YAML::new_literal(String::from(key->transform.position.x, tmp), tmp), tmp);
+          position_yaml->push_back(
+              "y", YAML::new_literal(String::from(key->transform.position.y, tmp), tmp), tmp);
+          position_yaml->push_back(
+              "z", YAML::new_literal(String::from(key->transform.position.z, tmp), tmp), tmp);
+          YAML::Dict *rotation_yaml = YAML::new_dict(tmp);
+          rotation_yaml->push_back(
+              "x", YAML::new_literal(String::from(key->transform.rotation.x, tmp), tmp), tmp);
+          rotation_yaml->push_back(
+              "y", YAML::new_literal(String::from(key->transform.rotation.y, tmp), tmp), tmp);
+          rotation_yaml->push_back(
+              "z", YAML::new_literal(String::from(key->transform.rotation.z, tmp), tmp), tmp);
+          YAML::Dict *scale_yaml = YAML::new_dict(tmp);
+          scale_yaml->push_back(
+              "x", YAML::new_literal(String::from(key->transform.scale.x, tmp), tmp), tmp);
+          scale_yaml->push_back(
+              "y", YAML::new_literal(String::from(key->transform.scale.y, tmp), tmp), tmp);
+          scale_yaml->push_back(
+              "z", YAML::new_literal(String::from(key->transform.scale.z, tmp), tmp), tmp);
+          transform_yaml->push_back("position", position_yaml, tmp);
+          transform_yaml->push_back("rotation", rotation_yaml, tmp);
+          transform_yaml->push_back("scale", scale_yaml, tmp);
+          key_out->push_back("transform", transform_yaml, tmp);
+
+          key_out->push_back(
+              "interpolation_type",
+              YAML::new_literal(String::from((u32)key->interpolation_type, tmp), tmp), tmp);
+          key_out->push_back("frame", YAML::new_literal(String::from(key->frame, tmp), tmp), tmp);
+
+          keys_out->push_back(key_out, tmp);
         }
-        keyed_animation_out->push_back("tracks", tracks_out, tmp);
+        track_out->push_back("keys", keys_out, tmp);
 
-        keyed_animations_out->push_back(keyed_animation_out, tmp);
+        tracks_out->push_back(track_out, tmp);
       }
+      keyed_animation_out->push_back("tracks", tracks_out, tmp);
+
+      keyed_animations_out->push_back(keyed_animation_out, tmp);
     }
 
     assets->push_back("keyed_animations", keyed_animations_out, tmp);
 
-    String out;
-    out.data = tmp.allocator->next;
-    YAML::serialize(assets, tmp, 0, false);
-    out.len = tmp.allocator->next - out.data;
+    String out = YAML::serialize(assets, tmp);
 
     write_file(filepath.to_char_array(tmp), out);
   }
@@ -223,16 +218,15 @@ struct Assets {
   {
     if (fonts.count({font_id, size}) == 0) {
       fonts.emplace(std::pair(font_id, size),
-                    load_font(font_files.data[font_id].value, size, &assets_temp_allocator));
+                    load_font(font_files[font_id], size, &assets_temp_allocator));
     }
     return &fonts[{font_id, size}];
   }
 
   RenderTarget get_render_target(String name)
   {
-    for (int i = 0; i < render_targets.size; i++) {
-      if (strcmp(name, render_targets.data[i].value.asset_name))
-        return render_targets.data[i].value;
+    for (RenderTarget &target : render_targets) {
+      if (strcmp(name, target.asset_name)) return target;
     }
 
     assert(false);
@@ -242,7 +236,7 @@ struct Assets {
   KeyedAnimation *create_keyed_animation(String folder, String name = {})
   {
     u32 i                = keyed_animations.push_back({30});
-    KeyedAnimation *anim = &keyed_animations.data[i].value;
+    KeyedAnimation *anim = &keyed_animations[i];
 
     String path;
     if (name.len == 0) {
@@ -258,9 +252,8 @@ struct Assets {
   // TODO: maybe assets ids should include asset type
   KeyedAnimation *get_keyed_animation(String name)
   {
-    for (int i = 0; i < keyed_animations.size; i++) {
-      if (strcmp(name, keyed_animations.data[i].value.asset_name))
-        return &keyed_animations.data[i].value;
+    for (KeyedAnimation &anim : keyed_animations) {
+      if (strcmp(name, anim.asset_name)) return &anim;
     }
 
     assert(false);
@@ -2211,10 +2211,7 @@ void save_layout()
                          YAML::new_literal(String::from(state.anchored_center, a), a), a);
   out_layout->push_back("anchors", out_anchors, a);
 
-  String out;
-  out.data = a->next;
-  YAML::serialize(out_layout, a, 0, false);
-  out.len = a->next - out.data;
+  String out = YAML::serialize(out_layout, a);
   printf("%.*s\n", out.len, out.data);
 
   write_file(state.layout_filepath, out);
@@ -2266,6 +2263,7 @@ void load_layout()
 void init(String layout_filepath)
 {
   state.per_frame_alloc.init(1034 * 1024 * 50);  // 50mb
+  state.per_frame_alloc.track("imm per frame");
 
   state.layout_filepath = layout_filepath;
   load_layout();
@@ -2291,4 +2289,38 @@ void add_window_menubar_menu()
   Imm::end_menubar_menu();
 }
 
+// how full each tracked arena is, for sizing them and spotting temp memory that's never given back
+void arena_stats_window(Rect rect)
+{
+  auto line = [](const char *format, auto... args) {
+    const i32 LINE_LEN = 128;
+    char *buf          = state.per_frame_alloc.alloc(LINE_LEN);
+    i32 len            = snprintf(buf, LINE_LEN, format, args...);
+    label(String(buf, std::min(std::max(len, 0), LINE_LEN - 1)));
+  };
+  const f64 MB = 1024. * 1024.;
+
+  start_window("Arenas", rect);
+  u32 count = tracked_arena_count.load(std::memory_order_acquire);
+  for (u32 i = 0; i < count; i++) {
+    ArenaStats *stats = tracked_arenas[i];
+    line("%s: %.2f MB, peak %.2f MB", stats->name, stats->in_use.get() / MB,
+         stats->high_water.get() / MB);
+    line("  %.2f of %.0f MB committed, %llu chained", stats->committed.get() / MB,
+         stats->reserved.get() / MB, (unsigned long long)stats->chained_blocks.get());
+    line("  %llu allocs, %llu temps, biggest %.2f MB", (unsigned long long)stats->allocations.get(),
+         (unsigned long long)stats->temp_scopes.get(), stats->biggest_temp.get() / MB);
+    if (stats->unscoped_allocations.get()) {
+      line("  unscoped: %llu allocs, %.2f MB",
+           (unsigned long long)stats->unscoped_allocations.get(), stats->unscoped_bytes.get() / MB);
+    }
+    u32 tags = stats->tag_count.load(std::memory_order_acquire);
+    for (u32 t = 0; t < tags; t++) {
+      line("    %s: %llu allocs, %.2f MB", stats->tags[t].name,
+           (unsigned long long)stats->tags[t].allocations.get(), stats->tags[t].bytes.get() / MB);
+    }
+  }
+  end_window();
+}
+
 }  // namespace Imm
@@ -200,13 +200,11 @@ struct Editor {
     Imm::add_window_menubar_menu();
 
     Imm::start_window("Entities", {0, 0, 300, 600});
-    for (int i = 0; i < editor_scene.entities.size; i++) {
-      if (editor_scene.entities.data[i].assigned) {
-        Entity &e = editor_scene.entities.data[i].value;
-        if (Imm::list_item((ImmId)&e, e.debug_tag.name, selected_entity_i == i)) {
-          selected_entity   = &e;
-          selected_entity_i = i;
-        }
+    for (u32 i : editor_scene.entities.ids()) {
+      Entity &e = editor_scene.entities[i];
+      if (Imm::list_item((ImmId)&e, e.debug_tag.name, selected_entity_i == i)) {
+        selected_entity   = &e;
+        selected_entity_i = i;
       }
     }
     Imm::end_window();
@@ -327,7 +325,7 @@ struct Editor {
       for (int i = 0; i < selected_script->inputs.size(); i++) {
         Imm::label(selected_script->inputs[i].name);
 
-        Entity *input_entity = &editor_scene.entities.data[*selected_script->inputs[i].value].value;
+        Entity *input_entity = &editor_scene.entities[*selected_script->inputs[i].value];
         if (Imm::button((ImmId)selected_script->inputs[i].value, input_entity->debug_tag.name)) {
           if (selected_entity && selected_entity->type == selected_script->inputs[i].entity_type) {
             *selected_script->inputs[i].value = selected_entity_i;
@@ -385,31 +383,38 @@ struct Editor {
       assets.create_keyed_animation(RESOURCE_PATH);
     }
 
-    for (int i = 0; i < assets.keyed_animations.size; i++) {
-      if (assets.keyed_animations.data[i].assigned) {
-        KeyedAnimation *ka      = &assets.keyed_animations.data[i].value;
-        AllocatedString<64> tmp = string_to_allocated_string<64>(ka->asset_name);
-        Imm::listitem_with_editing((ImmId)ka, &tmp, ka == editor_scene.current_sequence);
-        if (Imm::state.just_activated == (ImmId)ka) {
-          editor_scene.stop_sequence();
-          editor_scene.set_sequence(ka);
-        }
+    // removed after the loop, removing reorders the ids being walked
+    i32 deleted_animation = -1;
+    for (u32 i : assets.keyed_animations.ids()) {
+      KeyedAnimation *ka      = &assets.keyed_animations[i];
+      AllocatedString<64> tmp = string_to_allocated_string<64>(ka->asset_name);
+      Imm::listitem_with_editing((ImmId)ka, &tmp, ka == editor_scene.current_sequence);
+      if (Imm::state.just_activated == (ImmId)ka) {
+        editor_scene.stop_sequence();
+        editor_scene.set_sequence(ka);
+      }
 
-        if (!strcmp(tmp, ka->asset_name)) {
-          ka->asset_name = String::copy(tmp, &assets_allocator);
-        }
+      if (!strcmp(tmp, ka->asset_name)) {
+        ka->asset_name = String::copy(tmp, &assets_allocator);
+      }
 
-        if (Imm::state.was_last_item_right_clicked) {
-          Imm::open_popup((ImmId)ka, input->mouse_pos);
-        }
-        if (Imm::start_popup((ImmId)ka, {})->visible) {
-          if (Imm::button("Delete")) {
-            assets.keyed_animations.free(&assets.keyed_animations.data[i]);
-            Imm::close_popup();
-          }
+      if (Imm::state.was_last_item_right_clicked) {
+        Imm::open_popup((ImmId)ka, input->mouse_pos);
+      }
+      if (Imm::start_popup((ImmId)ka, {})->visible) {
+        if (Imm::button("Delete")) {
+          deleted_animation = i;
+          Imm::close_popup();
         }
-        Imm::end_popup();
       }
+      Imm::end_popup();
+    }
+    if (deleted_animation > -1) {
+      if (editor_scene.current_sequence == &assets.keyed_animations[deleted_animation]) {
+        editor_scene.stop_sequence();
+        editor_scene.set_sequence(nullptr);
+      }
+      assets.keyed_animations.remove(deleted_animation);
     }
     Imm::end_window();
 
@@ -487,6 +492,8 @@ struct Editor {
     Imm::texture(&renderer.rt_gpu_tex);
     Imm::end_window();
 
+    Imm::arena_stats_window({1300, 50, 400, 500});
+
     compositor.final_target.color_tex.gen_mipmaps();
 
     Imm::end_frame(&assets);
@@ -573,12 +580,7 @@ struct Editor {
       scripts.push_back(script, alloc);
     }
 
-    String out;
-    out.data = alloc->next;
-    YAML::serialize(&scene_yaml, alloc, 0, false);
-    out.len = alloc->next - out.data;
-
-    return out;
+    return YAML::serialize(&scene_yaml, alloc);
   }
 
   void deserialize(Scripts *game, StackAllocator *alloc)
@@ -658,7 +660,7 @@ struct Editor {
       }
     }
 
-    static DynamicArray<DynamicArray<i32>> selected_keys(&assets_temp_allocator);
+    static DynamicArray<DynamicArray<i32, 8>> selected_keys(&assets_temp_allocator);
     selected_keys.clear();
     if (editor_scene.current_sequence) {
       for (u32 i = 0; i < editor_scene.current_sequence->tracks.count; i++) {
@@ -912,8 +914,8 @@ struct Editor {
       return &debug_camera;
     }
     if (compositor.view_layers[0].active_camera_id > -1) {
-      *transform_out = scene->entities.data[compositor.view_layers[0].active_camera_id].value.transform;
-      return &scene->entities.data[compositor.view_layers[0].active_camera_id].value.camera;
+      *transform_out = scene->entities[compositor.view_layers[0].active_camera_id].transform;
+      return &scene->entities[compositor.view_layers[0].active_camera_id].camera;
     }
 
     transform_out->position = {debug_camera.pos_x, debug_camera.pos_y, debug_camera.pos_z};
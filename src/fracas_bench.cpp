@@ -0,0 +1,303 @@
+// allocator and container benchmarks. the allocator ones give every thread count the same total
+// work split between the threads, so a flat line is perfect scaling and a falling one is
+// contention. the container ones replay what the editor and the yaml reader do to their arrays.
+//
+//   fracas_bench                        everything
+//   fracas_bench --alloc [max threads]  allocators under contention
+//   fracas_bench --arrays               DynamicArray against std::vector
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+#include "util.hpp"
+
+const i32 TOTAL_ALLOCATIONS = 2000000;
+const i32 BATCH             = 256;  // allocations between frees, or per scope
+const u64 SHARED_RESERVE    = 1024ull * 1024 * 1024;
+
+// 16 to 128 bytes, the same sequence for every allocator
+inline u64 allocation_size(u32 *state)
+{
+  *state = *state * 1664525 + 1013904223;
+  return 16 + ((*state >> 16) % 8) * 16;
+}
+
+// runs work(thread index, allocations) on each thread at once and returns millions of allocations
+// a second, best of 3. reset runs before each, untimed
+template <typename Work, typename Reset>
+f64 run_threads(i32 thread_count, Work work, Reset reset)
+{
+  f64 best = 0;
+  for (i32 run = 0; run < 3; run++) {
+    reset();
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (i32 i = 0; i < thread_count; i++) {
+      threads.emplace_back(work, i, TOTAL_ALLOCATIONS / thread_count);
+    }
+    for (std::thread &thread : threads) thread.join();
+    f64 seconds =
+        std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+    best = std::max(best, TOTAL_ALLOCATIONS / seconds / 1e6);
+  }
+  return best;
+}
+
+f64 bench_malloc(i32 thread_count)
+{
+  return run_threads(thread_count, [](i32 thread_i, i32 count) {
+    u32 state = thread_i;
+    char *batch[BATCH];
+    for (i32 i = 0; i < count; i += BATCH) {
+      i32 n = std::min(BATCH, count - i);
+      for (i32 j = 0; j < n; j++) {
+        batch[j]  = (char *)malloc(allocation_size(&state));
+        *batch[j] = 1;
+      }
+      for (i32 j = 0; j < n; j++) free(batch[j]);
+    }
+  }, []() {});
+}
+
+// what sharing one arena between threads takes today
+f64 bench_locked_arena(i32 thread_count)
+{
+  StackAllocator arena;
+  std::mutex lock;
+  arena.init(SHARED_RESERVE);
+  f64 mops = run_threads(thread_count, [&](i32 thread_i, i32 count) {
+    u32 state = thread_i;
+    for (i32 i = 0; i < count; i++) {
+      lock.lock();
+      char *at = arena.alloc(allocation_size(&state), 16);
+      lock.unlock();
+      *at = 1;
+    }
+  }, [&]() { arena.reset(); });
+  arena.deinit();
+  return mops;
+}
+
+f64 bench_concurrent_arena(i32 thread_count)
+{
+  ConcurrentArena arena;
+  arena.init(SHARED_RESERVE);
+  f64 mops = run_threads(thread_count, [&](i32 thread_i, i32 count) {
+    u32 state = thread_i;
+    for (i32 i = 0; i < count; i++) {
+      char *at = arena.alloc(allocation_size(&state), 16);
+      *at      = 1;
+    }
+  }, [&]() { arena.reset(); });
+  arena.deinit();
+  return mops;
+}
+
+f64 bench_scratch(i32 thread_count)
+{
+  return run_threads(thread_count, [](i32 thread_i, i32 count) {
+    u32 state = thread_i;
+    for (i32 i = 0; i < count; i += BATCH) {
+      Scratch scratch;
+      i32 n = std::min(BATCH, count - i);
+      for (i32 j = 0; j < n; j++) {
+        char *at = scratch.allocator->alloc(allocation_size(&state), 16);
+        *at      = 1;
+      }
+    }
+  }, []() {});
+}
+
+// the shape of a KeyedAnimationTrack::Key
+struct BenchKey {
+  f32 transform[9];
+  i32 frame;
+  i32 interpolation_type;
+};
+
+const i32 BENCH_TRACKS = 64;
+const i32 BENCH_KEYS   = 20000;
+
+// keys set at random frames on random tracks, kept sorted by frame the way add_key does, then a
+// quarter of them deleted and every track evaluated at every frame. returns a checksum
+template <typename Keys>
+i64 edit_sequence(Keys *tracks)
+{
+  u32 state = 1;
+  auto next = [&]() { return (state = state * 1664525 + 1013904223) >> 8; };
+
+  for (i32 k = 0; k < BENCH_KEYS; k++) {
+    Keys &keys = tracks[next() % BENCH_TRACKS];
+    i32 frame  = next() % 4000;
+    u32 pos    = 0;
+    while (pos < keys.size() && keys[pos].frame < frame) pos++;
+    if (pos < keys.size() && keys[pos].frame == frame) continue;
+
+    keys.push_back({});
+    for (u32 i = keys.size() - 1; i > pos; i--) keys[i] = keys[i - 1];
+    keys[pos]       = {};
+    keys[pos].frame = frame;
+  }
+  for (i32 k = 0; k < BENCH_KEYS / 4; k++) {
+    Keys &keys = tracks[next() % BENCH_TRACKS];
+    if (keys.size()) keys.erase(next() % keys.size());
+  }
+
+  i64 checksum = 0;
+  for (i32 t = 0; t < BENCH_TRACKS; t++) {
+    u32 base = 0;
+    for (i32 frame = 0; frame < 4000; frame += 8) {
+      while (base + 1 < tracks[t].size() && tracks[t][base + 1].frame <= frame) base++;
+      if (tracks[t].size()) checksum += tracks[t][base].frame;
+    }
+  }
+  return checksum;
+}
+
+// a document read the way YAML::deserialize reads one: every child is built, and allocates, before
+// it's added to its parent, so parents never grow at the top of the arena. the nodes themselves
+// come out of one block sized up front whatever the array, so only the arrays are compared
+const i32 BENCH_DOCUMENT_ENTRIES = 4000;
+const i32 BENCH_ENTRY_FIELDS     = 12;
+const i32 BENCH_DOCUMENT_NODES   = 1 + BENCH_DOCUMENT_ENTRIES * (1 + BENCH_ENTRY_FIELDS);
+
+template <typename Node, typename Init>
+i64 read_document(Init init)
+{
+  std::vector<Node> nodes;
+  nodes.reserve(BENCH_DOCUMENT_NODES);
+  auto make = [&]() {
+    Node *node = &nodes.emplace_back();
+    init(node);
+    return node;
+  };
+
+  Node *root = make();
+  for (i32 e = 0; e < BENCH_DOCUMENT_ENTRIES; e++) {
+    Node *entry = make();
+    for (i32 f = 0; f < BENCH_ENTRY_FIELDS; f++) {
+      Node *field = make();
+      field->value = e * BENCH_ENTRY_FIELDS + f;
+      entry->children.push_back(field);
+    }
+    root->children.push_back(entry);
+  }
+
+  i64 checksum = 0;
+  for (u32 e = 0; e < root->children.size(); e++) {
+    Node *entry = root->children[e];
+    for (u32 f = 0; f < entry->children.size(); f++) checksum += entry->children[f]->value;
+  }
+  return checksum;
+}
+
+// std::vector's names over DynamicArray, so one workload runs on both
+template <typename T, u32 INLINE_CAPACITY>
+struct BenchArray : DynamicArray<T, INLINE_CAPACITY> {
+  using DynamicArray<T, INLINE_CAPACITY>::DynamicArray;
+  u32 size() { return this->count; }
+  void erase(u32 i) { this->remove(i); }
+};
+
+struct ArenaNode {
+  BenchArray<ArenaNode *, 4> children;
+  i64 value = 0;
+};
+struct VectorNode {
+  std::vector<VectorNode *> children;
+  i64 value = 0;
+};
+
+template <typename Run>
+void time_arrays(const char *name, Run run)
+{
+  f64 best     = 1e30;
+  i64 checksum = 0;
+  u64 arena    = 0;
+  for (i32 i = 0; i < 5; i++) {
+    auto start = std::chrono::steady_clock::now();
+    checksum   = run(&arena);
+    best       = std::min(best, std::chrono::duration<f64, std::milli>(
+                                    std::chrono::steady_clock::now() - start)
+                                    .count());
+  }
+  if (arena) {
+    printf("  %-32s %8.2fms  %7.2f MB of arena  (checksum %lld)\n", name, best, arena / 1e6,
+           (long long)checksum);
+  } else {
+    printf("  %-32s %8.2fms                   (checksum %lld)\n", name, best, (long long)checksum);
+  }
+}
+
+void bench_arrays()
+{
+  StackAllocator arena;
+  arena.init(SHARED_RESERVE);
+
+  printf("editing a sequence, %d keys over %d tracks\n", BENCH_KEYS, BENCH_TRACKS);
+  // keys used to grow in assets_allocator, this shows what that strands in the arena
+  time_arrays("DynamicArray<Key, 4>, arena", [&](u64 *used) {
+    arena.reset();
+    BenchArray<BenchKey, 4> *tracks = arena.alloc<BenchArray<BenchKey, 4>>(BENCH_TRACKS);
+    for (i32 t = 0; t < BENCH_TRACKS; t++) new (&tracks[t]) BenchArray<BenchKey, 4>(&arena);
+    i64 checksum = edit_sequence(tracks);
+    *used        = arena.in_use();
+    return checksum;
+  });
+  // what tracks use
+  time_arrays("DynamicArray<Key, 4>, heap", [&](u64 *) {
+    std::vector<BenchArray<BenchKey, 4>> tracks(BENCH_TRACKS);
+    return edit_sequence(tracks.data());
+  });
+  time_arrays("std::vector<Key>", [&](u64 *) {
+    struct Keys : std::vector<BenchKey> {
+      void erase(u32 i) { std::vector<BenchKey>::erase(begin() + i); }
+    };
+    std::vector<Keys> tracks(BENCH_TRACKS);
+    return edit_sequence(tracks.data());
+  });
+
+  // the arena keeps every buffer an array grew out of, so it holds more than this
+  printf("reading a document, %d entries of %d fields, %.2f MB of child pointers\n",
+         BENCH_DOCUMENT_ENTRIES, BENCH_ENTRY_FIELDS,
+         (BENCH_DOCUMENT_NODES - 1) * sizeof(void *) / 1e6);
+  time_arrays("DynamicArray<Value *, 4>, arena", [&](u64 *used) {
+    arena.reset();
+    i64 checksum = read_document<ArenaNode>(
+        [&](ArenaNode *node) { node->children = BenchArray<ArenaNode *, 4>(&arena); });
+    *used = arena.in_use();
+    return checksum;
+  });
+  time_arrays("std::vector<Value *>", [&](u64 *) {
+    return read_document<VectorNode>([](VectorNode *) {});
+  });
+
+  arena.deinit();
+}
+
+void bench_allocators(i32 max_threads)
+{
+  printf("%d allocations of 16-128 bytes, Mops/s, best of 3\n", TOTAL_ALLOCATIONS);
+  printf("%8s %10s %12s %12s %10s\n", "threads", "malloc", "locked arena", "concurrent",
+         "scratch");
+  for (i32 threads = 1; threads <= max_threads; threads *= 2) {
+    printf("%8d %10.1f %12.1f %12.1f %10.1f\n", threads, bench_malloc(threads),
+           bench_locked_arena(threads), bench_concurrent_arena(threads), bench_scratch(threads));
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  b8 alloc  = argc < 2 || strcmp(argv[1], "--alloc") == 0;
+  b8 arrays = argc < 2 || strcmp(argv[1], "--arrays") == 0;
+
+  if (alloc) bench_allocators(argc > 2 ? std::max(1, atoi(argv[2])) : 64);
+  if (arrays) bench_arrays();
+  return 0;
+}
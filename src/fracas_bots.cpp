@@ -0,0 +1,508 @@
+// headless load generator. spawns bot players that connect to a server over loopback, form lobbies,
+// and play full games through the generated RpcClient, then reports rpc latency percentiles,
+// message throughput and the server's cpu usage.
+//
+//   fracas_bots [--bots N] [--players-per-game N] [--think-ms MIN MAX] [--duration S]
+//               [--threads N] [--address ADDR] [--port PORT] [--server-pid PID]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "net/net.cpp"
+
+#include "common.hpp"
+#include "net/generated_rpc_client.hpp"
+#include "net/net.hpp"
+#include "net/poller.hpp"
+#include "net/state_replication.hpp"
+#include "server/timer_wheel.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+const u64 MILLISECOND = 1000000;
+const u64 SECOND      = 1000 * MILLISECOND;
+
+struct BotConfig {
+  i32 bots             = 1024;
+  i32 players_per_game = 4;
+  u64 think_min        = 50 * MILLISECOND;
+  u64 think_max        = 250 * MILLISECOND;
+  u64 duration         = 30 * SECOND;
+  i32 threads          = 1;
+  const char *address  = "127.0.0.1";
+  uint16_t port        = 6666;
+  i64 server_pid       = 0;
+};
+
+enum BotAction : u32 {
+  BOT_CREATE_GAME,
+  BOT_JOIN_GAME,
+  BOT_START_GAME,
+  BOT_READY,
+  BOT_BUZZ,
+  BOT_ANSWER,
+  BOT_CHOOSE_PASS_OR_PLAY,
+  BOT_LEAVE_GAME,
+};
+
+enum struct BotState {
+  IDLE,
+  IN_LOBBY,
+  IN_GAME,
+  LEAVING,
+};
+
+// the bots that play one lobby together. always owned by a single worker
+struct BotGroup {
+  i32 first_bot  = 0;
+  i32 size       = 0;
+  GameId game_id = 0;
+  i32 joined     = 0;
+  i32 left       = 0;
+};
+
+struct Bot {
+  RpcClient rpc;
+  BotState state = BotState::IDLE;
+  i32 group      = 0;
+  ClientId my_id = 0;
+  bool faceoffer = false;
+  StateHistory replicated;
+
+  // send times of requests still waiting on their response. the server answers each connection's
+  // requests in order, so responses pop from the front
+  static const u32 MAX_IN_FLIGHT = 64;
+  u64 in_flight[MAX_IN_FLIGHT];
+  u32 in_flight_head = 0;
+  u32 in_flight_tail = 0;
+};
+
+struct Worker {
+  BotConfig config;
+  std::vector<Bot *> bots;
+  std::vector<BotGroup> groups;
+  Poller poller;
+  TimerWheel timers;
+  std::mt19937_64 rng;
+
+  std::chrono::steady_clock::time_point start_time;
+
+  // latencies in microseconds, only touched by this worker until it has joined
+  std::vector<u32> latencies;
+  std::atomic<u64> sent        = 0;
+  std::atomic<u64> received    = 0;
+  std::atomic<u64> games       = 0;
+  std::atomic<u64> state_bytes = 0;  // GameStatePing bytes received
+  std::atomic<bool> stop       = false;
+
+  u64 now()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                                                                start_time)
+        .count();
+  }
+
+  u64 think_time()
+  {
+    if (config.think_max <= config.think_min) return config.think_min;
+    return config.think_min + rng() % (config.think_max - config.think_min);
+  }
+
+  void schedule(i32 bot, BotAction action, u64 delay) { timers.schedule(delay, bot, action); }
+  void think(i32 bot, BotAction action) { schedule(bot, action, think_time()); }
+
+  void sent_request(Bot *bot)
+  {
+    if (bot->in_flight_tail - bot->in_flight_head < Bot::MAX_IN_FLIGHT) {
+      bot->in_flight[bot->in_flight_tail % Bot::MAX_IN_FLIGHT] = now();
+      bot->in_flight_tail++;
+    }
+    sent++;
+  }
+
+  void got_response(Bot *bot)
+  {
+    if (bot->in_flight_head == bot->in_flight_tail) return;
+
+    u64 sent_at = bot->in_flight[bot->in_flight_head % Bot::MAX_IN_FLIGHT];
+    bot->in_flight_head++;
+    latencies.push_back((u32)((now() - sent_at) / 1000));
+  }
+
+  void init(BotConfig config, i32 bot_count, u64 seed)
+  {
+    this->config = config;
+    rng.seed(seed);
+    start_time = std::chrono::steady_clock::now();
+
+    poller.init(bot_count);
+    // a bot rarely has more than a couple of actions pending at once
+    timers.init(bot_count * 4);
+    latencies.reserve(1 << 20);
+
+    for (i32 i = 0; i < bot_count; i += config.players_per_game) {
+      BotGroup group;
+      group.first_bot = i;
+      group.size      = std::min(config.players_per_game, bot_count - i);
+      groups.push_back(group);
+    }
+
+    for (i32 i = 0; i < bot_count; i++) {
+      Bot *bot   = new Bot;
+      bot->group = i / config.players_per_game;
+      bot->rpc.connect(config.address, config.port);
+      poller.add(bot->rpc.peer.s, i, POLL_READ);
+      bot->rpc.peer.watch(&poller, i);
+      bots.push_back(bot);
+    }
+
+    // stagger lobby creation so the server isn't hit with every CreateGame at once
+    for (BotGroup &group : groups) {
+      if (group.size >= 2) schedule(group.first_bot, BOT_CREATE_GAME, think_time());
+    }
+  }
+
+  void run()
+  {
+    PollEvent events[MAX_POLL_EVENTS];
+    while (!stop) {
+      // wake at least every 100ms to notice stop
+      u64 until_next  = std::min(timers.time_until_next(), 100 * MILLISECOND);
+      i64 timeout_ms  = (i64)((until_next + MILLISECOND - 1) / MILLISECOND);
+      int event_count = poller.wait(events, MAX_POLL_EVENTS, timeout_ms);
+
+      timers.advance(now(), [&](u64 key, u32 kind) { act((i32)key, (BotAction)kind); });
+
+      for (int e = 0; e < event_count; e++) {
+        i32 index = (i32)events[e].key;
+        Bot *bot  = bots[index];
+        if (events[e].events & POLL_WRITE) {
+          bot->rpc.peer.flush();
+        }
+
+        int msg_len;
+        char *msg;
+        while ((msg_len = bot->rpc.peer.recieve_msg(&msg)) > 0) {
+          received++;
+          on_message(index, msg, msg_len);
+        }
+        if (events[e].events & POLL_HANGUP) bot->rpc.peer.disconnect();
+        if (!bot->rpc.peer.is_connected()) {
+          printf("bot %d lost its connection\n", index);
+          poller.remove(bot->rpc.peer.s);
+        }
+      }
+    }
+
+    for (Bot *bot : bots) {
+      bot->rpc.peer.close();
+    }
+  }
+
+  void act(i32 index, BotAction action)
+  {
+    Bot *bot        = bots[index];
+    BotGroup *group = &groups[bot->group];
+    RpcClient *rpc  = &bot->rpc;
+    if (!rpc->peer.is_connected()) return;
+
+    switch (action) {
+    case BOT_CREATE_GAME: {
+      char name[64];
+      snprintf(name, sizeof(name), "bots %d", index);
+      CreateGameRequest req;
+      req.name           = string_to_allocated_string<64>(String(name, strlen(name)));
+      req.owner_name     = string_to_allocated_string<64>(String("host"));
+      req.is_self_hosted = true;
+      rpc->CreateGame(req);
+    } break;
+    case BOT_JOIN_GAME: {
+      char name[64];
+      snprintf(name, sizeof(name), "bot %d", index);
+      rpc->JoinGame({group->game_id, string_to_allocated_string<64>(String(name, strlen(name)))});
+    } break;
+    case BOT_START_GAME: {
+      rpc->StartGame({group->game_id});
+    } break;
+    case BOT_READY: {
+      rpc->InGameReady({});
+    } break;
+    case BOT_BUZZ: {
+      rpc->InGameBuzz({});
+    } break;
+    case BOT_ANSWER: {
+      // the bots don't know the answers, so most guesses miss and the round plays out through
+      // strikes and steals
+      rpc->InGameAnswer({(i32)(rng() % 4096)});
+    } break;
+    case BOT_CHOOSE_PASS_OR_PLAY: {
+      rpc->InGameChoosePassOrPlay({(rng() & 1) == 0});
+    } break;
+    case BOT_LEAVE_GAME: {
+      rpc->LeaveGame({});
+    } break;
+    }
+    sent_request(bot);
+  }
+
+  void on_message(i32 index, char *msg, int msg_len)
+  {
+    Bot *bot        = bots[index];
+    BotGroup *group = &groups[bot->group];
+    RpcClient *rpc  = &bot->rpc;
+
+    Rpc rpc_type = (Rpc)msg[0];
+    if (rpc_type <= Rpc::InGameChoosePassOrPlay) got_response(bot);
+    if (rpc_type == Rpc::GameStatePing) state_bytes += msg_len;
+    rpc->handle_rpc(msg, msg_len);
+
+    // applied and acknowledged the way the game client does, so the server sends deltas
+    if (auto ping = rpc->get_GameStatePing_msg()) {
+      rpc->GameStateAck({receive_state(&bot->replicated, ping)});
+    }
+
+    if (auto resp = rpc->get_CreateGame_msg()) {
+      if (!resp->game_id) {
+        // the server is out of lobbies, try again later
+        schedule(index, BOT_CREATE_GAME, SECOND);
+        return;
+      }
+      bot->state     = BotState::IN_LOBBY;
+      group->game_id = resp->game_id;
+      group->joined  = 1;
+      group->left    = 0;
+      for (i32 i = 1; i < group->size; i++) {
+        think(group->first_bot + i, BOT_JOIN_GAME);
+      }
+    }
+    if (rpc->get_JoinGame_msg()) {
+      bot->state = BotState::IN_LOBBY;
+      group->joined++;
+      if (group->joined == group->size) {
+        think(group->first_bot, BOT_START_GAME);
+      }
+    }
+    if (auto started = rpc->get_GameStarted_msg()) {
+      bot->state     = BotState::IN_GAME;
+      bot->my_id     = started->your_id;
+      bot->faceoffer = false;
+      think(index, BOT_READY);
+    }
+    if (rpc->get_LeaveGame_msg()) {
+      bot->state = BotState::IDLE;
+      group->left++;
+      if (group->left == group->size) {
+        games++;
+        think(group->first_bot, BOT_CREATE_GAME);
+      }
+    }
+
+    if (bot->state != BotState::IN_GAME) {
+      rpc->clear_msgs();
+      return;
+    }
+
+    // every stage change waits on all players being ready before moving on
+    bool needs_ready = rpc->get_InGameStartRound_msg() || rpc->get_InGamePlayerBuzzed_msg() ||
+                       rpc->get_InGamePrepForPromptForAnswer_msg() ||
+                       rpc->get_InGamePlayerAnswered_msg() || rpc->get_InGameFlipAnswer_msg() ||
+                       rpc->get_InGameEggghhhh_msg() || rpc->get_InGamePlayerChosePassOrPlay_msg() ||
+                       rpc->get_InGameStartPlay_msg() || rpc->get_InGameStartSteal_msg() ||
+                       rpc->get_InGameEndRound_msg();
+
+    if (auto faceoff = rpc->get_InGameStartFaceoff_msg()) {
+      bot->faceoffer =
+          faceoff->faceoffer_0_id == bot->my_id || faceoff->faceoffer_1_id == bot->my_id;
+      needs_ready = true;
+    }
+    if (rpc->get_InGameAskQuestion_msg() && bot->faceoffer) {
+      think(index, BOT_BUZZ);
+    }
+    if (auto prompt = rpc->get_InGamePromptForAnswer_msg()) {
+      if (prompt->user_id == bot->my_id) think(index, BOT_ANSWER);
+    }
+    if (rpc->get_InGamePromptPassOrPlay_msg() && bot->faceoffer) {
+      think(index, BOT_CHOOSE_PASS_OR_PLAY);
+    }
+    if (rpc->get_InGameEndGame_msg()) {
+      bot->state = BotState::LEAVING;
+      think(index, BOT_LEAVE_GAME);
+    }
+
+    if (needs_ready) think(index, BOT_READY);
+    rpc->clear_msgs();
+  }
+};
+
+// seconds of cpu the process has used, user and system combined. negative if it can't be read
+f64 process_cpu_seconds(i64 pid)
+{
+#ifdef _WIN32
+  HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, (DWORD)pid);
+  if (!process) return -1;
+
+  FILETIME created, exited, kernel, user;
+  bool ok = GetProcessTimes(process, &created, &exited, &kernel, &user);
+  CloseHandle(process);
+  if (!ok) return -1;
+
+  auto to_100ns = [](FILETIME t) { return ((u64)t.dwHighDateTime << 32) | t.dwLowDateTime; };
+  return (to_100ns(kernel) + to_100ns(user)) / 1e7;
+#else
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%lld/stat", (long long)pid);
+  FILE *f = fopen(path, "r");
+  if (!f) return -1;
+
+  char buf[1024];
+  size_t len = fread(buf, 1, sizeof(buf) - 1, f);
+  fclose(f);
+  buf[len] = '\0';
+
+  // the command name can contain spaces, so start counting fields after its closing paren
+  char *fields = strrchr(buf, ')');
+  if (!fields) return -1;
+
+  unsigned long long utime = 0, stime = 0;
+  if (sscanf(fields + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime,
+             &stime) != 2) {
+    return -1;
+  }
+  return (f64)(utime + stime) / sysconf(_SC_CLK_TCK);
+#endif
+}
+
+u32 percentile(std::vector<u32> &sorted, f64 p)
+{
+  if (sorted.empty()) return 0;
+  size_t i = (size_t)(p * (sorted.size() - 1));
+  return sorted[i];
+}
+
+BotConfig parse_args(int argc, char *argv[])
+{
+  BotConfig config;
+  for (int i = 1; i < argc; i++) {
+    auto arg = [&](const char *name) { return strcmp(argv[i], name) == 0 && i + 1 < argc; };
+
+    if (arg("--bots")) {
+      config.bots = atoi(argv[++i]);
+    } else if (arg("--players-per-game")) {
+      config.players_per_game = atoi(argv[++i]);
+    } else if (arg("--think-ms") && i + 2 < argc) {
+      config.think_min = atoll(argv[++i]) * MILLISECOND;
+      config.think_max = atoll(argv[++i]) * MILLISECOND;
+    } else if (arg("--duration")) {
+      config.duration = atoll(argv[++i]) * SECOND;
+    } else if (arg("--threads")) {
+      config.threads = atoi(argv[++i]);
+    } else if (arg("--address")) {
+      config.address = argv[++i];
+    } else if (arg("--port")) {
+      config.port = (uint16_t)atoi(argv[++i]);
+    } else if (arg("--server-pid")) {
+      config.server_pid = atoll(argv[++i]);
+    } else {
+      printf("unknown argument %s\n", argv[i]);
+      exit(1);
+    }
+  }
+
+  // a lobby can only start with both families filled and fewer than half the max in each
+  config.players_per_game = std::max(2, std::min(config.players_per_game, MAX_PLAYERS_PER_GAME - 2));
+  config.threads          = std::max(1, std::min(config.threads, config.bots));
+  if (config.bots > MAX_CLIENTS) {
+    printf("warning: the server accepts at most %d clients\n", MAX_CLIENTS);
+  }
+  return config;
+}
+
+int main(int argc, char *argv[])
+{
+  init_net();
+  BotConfig config = parse_args(argc, argv);
+
+  printf("%d bots, %d per game, %d threads, think %llu-%llums, %llus\n", config.bots,
+         config.players_per_game, config.threads,
+         (unsigned long long)(config.think_min / MILLISECOND),
+         (unsigned long long)(config.think_max / MILLISECOND),
+         (unsigned long long)(config.duration / SECOND));
+
+  // whole groups per worker so a lobby never spans threads
+  i32 groups_total = (config.bots + config.players_per_game - 1) / config.players_per_game;
+  std::vector<Worker *> workers;
+  std::vector<std::thread> threads;
+  i32 first_bot = 0;
+  for (i32 t = 0; t < config.threads; t++) {
+    i32 groups    = groups_total / config.threads + (t < groups_total % config.threads ? 1 : 0);
+    i32 bot_count = std::min(groups * config.players_per_game, config.bots - first_bot);
+
+    Worker *worker = new Worker;
+    worker->init(config, bot_count, 0x9e3779b97f4a7c15ull * (t + 1));
+    workers.push_back(worker);
+    first_bot += bot_count;
+  }
+  for (Worker *worker : workers) {
+    threads.emplace_back(&Worker::run, worker);
+  }
+
+  auto start     = std::chrono::steady_clock::now();
+  f64 cpu_start  = config.server_pid ? process_cpu_seconds(config.server_pid) : -1;
+  u64 last_total = 0;
+  for (u64 elapsed = 0; elapsed < config.duration; elapsed += SECOND) {
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    u64 total = 0;
+    for (Worker *worker : workers) total += worker->sent + worker->received;
+    printf("%3llus  %llu msgs/s\n", (unsigned long long)((elapsed + SECOND) / SECOND),
+           (unsigned long long)(total - last_total));
+    last_total = total;
+  }
+
+  for (Worker *worker : workers) worker->stop = true;
+  for (std::thread &thread : threads) thread.join();
+
+  f64 seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+  f64 cpu_end = config.server_pid ? process_cpu_seconds(config.server_pid) : -1;
+
+  std::vector<u32> latencies;
+  u64 sent = 0, received = 0, games = 0, state_bytes = 0;
+  for (Worker *worker : workers) {
+    latencies.insert(latencies.end(), worker->latencies.begin(), worker->latencies.end());
+    sent += worker->sent;
+    received += worker->received;
+    games += worker->games;
+    state_bytes += worker->state_bytes;
+  }
+  std::sort(latencies.begin(), latencies.end());
+
+  printf("\n");
+  printf("games finished  %llu\n", (unsigned long long)games);
+  printf("sent            %llu (%.0f/s)\n", (unsigned long long)sent, sent / seconds);
+  printf("received        %llu (%.0f/s)\n", (unsigned long long)received, received / seconds);
+  printf("state pings     %llu bytes (%.0f/s)\n", (unsigned long long)state_bytes,
+         state_bytes / seconds);
+  printf("rpc latency us  p50 %u  p90 %u  p99 %u  p99.9 %u  max %u  (%zu samples)\n",
+         percentile(latencies, 0.5), percentile(latencies, 0.9), percentile(latencies, 0.99),
+         percentile(latencies, 0.999), latencies.empty() ? 0 : latencies.back(), latencies.size());
+  if (cpu_start >= 0 && cpu_end >= 0) {
+    printf("server cpu      %.1f%% of one core\n", 100 * (cpu_end - cpu_start) / seconds);
+  } else if (config.server_pid) {
+    printf("server cpu      couldn't read process %lld\n", (long long)config.server_pid);
+  }
+
+  deinit_net();
+  return 0;
+}
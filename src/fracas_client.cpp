@@ -24,7 +24,6 @@
 
 Editor editor;
 
-StackAllocator main_memory;
 StackAllocator allocator;
 StackAllocator temp;
 Memory memory{&allocator, &temp};
@@ -39,14 +38,22 @@ bool init_if_not()
 
     init_net();
 
-    main_memory.init(1024ull * 1024 * 1024 * 4);
+    // these only reserve address space, memory is committed as it's used and an arena that runs
+    // out chains on another block of the same size
     allocator.init(1024ull * 1024 * 1024 * 2);  // 2gb
     temp.init(1024 * 1024 * 100);               // 100 mb
 
-    assets_allocator.init(&main_memory, 1024ull * 1024 * 1024 * 1);  // 1 gb
-    assets_temp_allocator.init(&main_memory, 1024ull * 1024 * 1024);   // 1 gb
-    scene_allocator.init(&main_memory, 1024ull * 1024 * 1024 * 1);   // 1 gb
-    scene_temp_allocator.init(&main_memory, 1024ull * 1024 * 50);    // 50 mb
+    assets_allocator.init(1024ull * 1024 * 1024);       // 1 gb
+    assets_temp_allocator.init(1024ull * 1024 * 1024);  // 1 gb
+    scene_allocator.init(1024ull * 1024 * 1024);        // 1 gb
+    scene_temp_allocator.init(1024ull * 1024 * 50);     // 50 mb
+
+    allocator.track("main");
+    temp.track("temp", true);
+    assets_allocator.track("assets");
+    assets_temp_allocator.track("assets temp", true);
+    scene_allocator.track("scene");
+    scene_temp_allocator.track("scene temp", true);
 
     editor.init(memory);
   }
@@ -0,0 +1,269 @@
+// offline question bank compiler. parses the question csvs and writes the flat, versioned file the
+// server maps at startup, see server/question_db.hpp for the layout.
+//
+//   fracas_questions [output path]
+//   fracas_questions --bench [db path]     time answer completion over the whole pool
+//   fracas_questions --bench-sort [copies] time sorting and deduping the answer pool
+
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "server/question_db.hpp"
+#include "util.hpp"
+#include "util/string_sort.hpp"
+
+// completes prefixes of real answers, checking every result against a linear scan of the pool
+// first, then reports per call latency
+int bench_completion(const char *filename)
+{
+  QuestionDb db;
+  if (!db.load(filename)) {
+    printf("failed to load %s\n", filename);
+    return 1;
+  }
+
+  const i32 QUERIES = 200000;
+  const i32 K       = 8;
+
+  // prefixes of 1 to 8 characters, cut from answers picked at random
+  std::mt19937 rng(1234);
+  std::vector<String> prefixes(QUERIES);
+  for (String &prefix : prefixes) {
+    String answer = db.answer(rng() % db.answer_count());
+    prefix        = String(answer.data, std::min(answer.len, 1 + (u32)(rng() % 8)));
+  }
+
+  u32 results[MAX_COMPLETIONS];
+  for (i32 q = 0; q < 2000; q++) {
+    String prefix = prefixes[q];
+
+    std::vector<u32> expected;
+    for (u32 i = 0; i < db.answer_count(); i++) {
+      String answer = db.answer(i);
+      if (answer.len >= prefix.len && memcmp(answer.data, prefix.data, prefix.len) == 0) {
+        expected.push_back(i);
+      }
+    }
+    std::sort(expected.begin(), expected.end(), [&](u32 a, u32 b) { return db.heavier(a, b); });
+    expected.resize(std::min((size_t)K, expected.size()));
+
+    i32 found = db.complete(prefix, results, K);
+    if (found != (i32)expected.size() || !std::equal(expected.begin(), expected.end(), results)) {
+      printf("completion mismatch for \"%.*s\"\n", prefix.len, prefix.data);
+      return 1;
+    }
+  }
+
+  std::vector<u64> times(QUERIES);
+  u64 checksum = 0;
+  auto start   = std::chrono::steady_clock::now();
+  for (i32 q = 0; q < QUERIES; q++) {
+    auto before = std::chrono::steady_clock::now();
+    i32 found   = db.complete(prefixes[q], results, K);
+    auto after  = std::chrono::steady_clock::now();
+
+    times[q] = std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count();
+    checksum += found ? results[0] : 0;
+  }
+  f64 total_ms =
+      std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  std::sort(times.begin(), times.end());
+  auto percentile = [&](f64 p) { return times[std::min((size_t)(p * QUERIES), times.size() - 1)]; };
+  printf("%u answers, %d top-%d completions in %.1fms (checksum %llu)\n", db.answer_count(), QUERIES,
+         K, total_ms, (unsigned long long)checksum);
+  printf("latency ns  p50 %llu  p90 %llu  p99 %llu  p99.9 %llu  max %llu\n",
+         (unsigned long long)percentile(.5), (unsigned long long)percentile(.9),
+         (unsigned long long)percentile(.99), (unsigned long long)percentile(.999),
+         (unsigned long long)times.back());
+
+  db.unload();
+  return 0;
+}
+
+// the top down mergesort the pool used to be sorted with, kept as the baseline
+void reference_mergesort(String *strings, u32 *src, u32 *dst, u32 start, u32 count)
+{
+  if (count == 1) {
+    dst[start] = src[start];
+    return;
+  }
+
+  u32 part1_count = count / 2;
+  u32 part2_count = count - part1_count;
+  reference_mergesort(strings, dst, src, start, part1_count);
+  reference_mergesort(strings, dst, src, start + part1_count, part2_count);
+
+  u32 part1_i = start;
+  u32 part2_i = start + part1_count;
+  for (u32 i = start; i < start + count; i++) {
+    b8 take_part1 = part1_i < start + part1_count;
+    if (take_part1 && part2_i < start + count) {
+      String a = strings[src[part1_i]];
+      String b = strings[src[part2_i]];
+      i32 cmp  = strncmp(a.data, b.data, std::min(a.len, b.len));
+      take_part1 = cmp < 0 || (cmp == 0 && a.len <= b.len);
+    }
+    dst[i] = take_part1 ? src[part1_i++] : src[part2_i++];
+  }
+}
+
+void reference_sort(String *strings, u32 *order, u32 count)
+{
+  if (!count) return;
+  std::vector<u32> scratch(order, order + count);
+  reference_mergesort(strings, scratch.data(), order, 0, count);
+}
+
+// sorts and dedupes the answer pool blown up to a bank of copies times the size, every way there
+// is, checking each against std::sort and printing the best of a few runs
+int bench_sort(i32 copies)
+{
+  QuestionsAndAnswers qa = read_questions();
+  if (!qa.questions.count) return 1;
+
+  // distinct: every answer copies times, each with its own suffix. repeats: every answer copies
+  // times as is. both shuffled
+  std::mt19937 rng(1234);
+  std::vector<std::string> distinct_storage, repeat_storage;
+  for (i32 c = 0; c < copies; c++) {
+    for (u32 i = 0; i < qa.answers.count; i++) {
+      std::string answer(qa.answers[i].data, qa.answers[i].len);
+      distinct_storage.push_back(c ? answer + " " + std::to_string(c) : answer);
+      repeat_storage.push_back(answer);
+    }
+  }
+  std::shuffle(distinct_storage.begin(), distinct_storage.end(), rng);
+  std::shuffle(repeat_storage.begin(), repeat_storage.end(), rng);
+
+  auto views = [](std::vector<std::string> &storage) {
+    std::vector<String> out;
+    for (std::string &str : storage) out.push_back(String(&str[0], (u32)str.size()));
+    return out;
+  };
+  std::vector<String> distinct = views(distinct_storage);
+  std::vector<String> repeats  = views(repeat_storage);
+  u32 count                    = (u32)distinct.size();
+  u32 threads                  = std::thread::hardware_concurrency();
+
+  auto expect_sorted = [](std::vector<String> &strings, u32 *order, u32 n) {
+    std::vector<std::string> expected;
+    for (String &str : strings) expected.push_back(std::string(str.data, str.len));
+    std::sort(expected.begin(), expected.end());
+    expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+
+    if (n != expected.size()) return false;
+    for (u32 i = 0; i < n; i++) {
+      String str = strings[order[i]];
+      if (expected[i].size() != str.len || memcmp(expected[i].data(), str.data, str.len)) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  std::vector<u32> order(count);
+  auto time = [&](const char *name, std::vector<String> &strings, auto &&run) {
+    f64 best = 1e30;
+    u32 n    = 0;
+    for (i32 run_i = 0; run_i < 5; run_i++) {
+      auto start = std::chrono::steady_clock::now();
+      n          = run();
+      best       = std::min(best, std::chrono::duration<f64, std::milli>(
+                                  std::chrono::steady_clock::now() - start)
+                                  .count());
+    }
+    b8 correct = expect_sorted(strings, order.data(), n);
+    printf("  %-28s %8.2fms  %u strings%s\n", name, best, n, correct ? "" : "  WRONG");
+    return correct;
+  };
+  auto identity = [&]() {
+    for (u32 i = 0; i < count; i++) order[i] = i;
+  };
+
+  b8 ok = true;
+  printf("sorting %u distinct answers\n", count);
+  ok &= time("mergesort", distinct, [&]() {
+    identity();
+    reference_sort(distinct.data(), order.data(), count);
+    return count;
+  });
+  ok &= time("multikey quicksort", distinct, [&]() {
+    identity();
+    sort_strings(distinct.data(), order.data(), count);
+    return count;
+  });
+  ok &= time("radix + multikey, threaded", distinct, [&]() {
+    identity();
+    sort_strings(distinct.data(), order.data(), count, threads);
+    return count;
+  });
+
+  printf("deduping and sorting %u answers, %u distinct\n", count, qa.answers.count);
+  ok &= time("hash map + mergesort", repeats, [&]() {
+    HashMap<i32> ids;
+    ids.init(qa.answers.count);
+    u32 unique = 0;
+    for (u32 i = 0; i < count; i++) {
+      if (ids.get_or_emplace(repeats[i], unique) == (i32)unique) order[unique++] = i;
+    }
+    reference_sort(repeats.data(), order.data(), unique);
+    ids.deinit();
+    return unique;
+  });
+  ok &= time("sort, then dedup", repeats, [&]() {
+    return sort_unique_strings(repeats.data(), count, order.data(), nullptr, false, threads);
+  });
+  ok &= time("hash dedup, then sort", repeats, [&]() {
+    return sort_unique_strings(repeats.data(), count, order.data(), nullptr, true, threads);
+  });
+
+  free_questions(&qa);
+  return ok ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    return bench_completion(argc > 2 ? argv[2] : QUESTION_DB_PATH);
+  }
+  if (argc > 1 && strcmp(argv[1], "--bench-sort") == 0) {
+    return bench_sort(argc > 2 ? std::max(1, atoi(argv[2])) : 1);
+  }
+
+  // a mistyped flag would otherwise become the output path
+  if (argc > 2 || (argc > 1 && strncmp(argv[1], "--", 2) == 0)) {
+    printf("unknown argument %s\n", argv[argc > 2 ? 2 : 1]);
+    printf("usage: fracas_questions [output path]\n"
+           "       fracas_questions --bench [db path]\n"
+           "       fracas_questions --bench-sort [copies]\n");
+    return 1;
+  }
+  const char *filename = argc > 1 ? argv[1] : QUESTION_DB_PATH;
+
+  QuestionsAndAnswers qa = read_questions();
+  if (!qa.questions.count) return 1;
+
+  // replaced rather than rewritten in place, so a running server can pick it up safely
+  String compiled = build_question_db(&qa);
+  free_questions(&qa);
+  if (!replace_file(filename, compiled)) return 1;
+
+  // read it back the way the server will, so a bad build is caught here rather than at startup
+  QuestionDb db;
+  if (!db.load(filename)) {
+    printf("failed to load %s after writing it\n", filename);
+    return 1;
+  }
+  printf("wrote %s: %u questions, %u answers, %u bytes\n", filename, db.question_count(),
+         db.answer_count(), compiled.len);
+
+  db.unload();
+  free(compiled.data);
+  return 0;
+}
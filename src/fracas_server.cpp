@@ -2,131 +2,117 @@
 #include <stdio.h>
 #include <chrono>
 #include <map>
+#include <thread>
 
 #include "net/net.cpp"
 
-#include <winsock2.h>
-
 #include "common.hpp"
 #include "game_state.hpp"
 #include "lobby.hpp"
 #include "net/net.hpp"
-
-SOCKET open_socket(uint16_t port)
-{
-  SOCKET s;
-  if ((s = socket(AF_INET, SOCK_STREAM, 0)) == INVALID_SOCKET) {
-    printf("Could not create socket : %d", WSAGetLastError());
-  }
-  u_long mode = 1;
-  ioctlsocket(s, FIONBIO, (unsigned long *)&mode);
-
-  sockaddr_in server;
-  server.sin_family      = AF_INET;
-  server.sin_addr.s_addr = INADDR_ANY;
-  server.sin_port        = htons(port);
-  if (bind(s, (sockaddr *)&server, sizeof(server)) == SOCKET_ERROR) {
-    printf("Bind failed with error code : %d", WSAGetLastError());
-  }
-  listen(s, 3);
-
-  return s;
-}
+#include "net/poller.hpp"
+#include "server/shard.hpp"
 
 int main(int argc, char *argv[])
 {
   init_net();
-  ServerData server_data;
 
-  tmp.init(10 * 1000);
-  // thesaurus     = parse_thesaurus();
-  auto [questions, answers] = read_questions();
-  question_list = questions;
-  answer_list = answers;
+  if (!load_thesaurus(&thesaurus, "./src/server/th_en_US_v2.dat")) {
+    printf("no thesaurus found, typed answers won't match synonyms\n");
+  }
+  QuestionWatcher question_watcher;
+  if (!question_watcher.load()) {
+    printf("could not load the question db\n");
+    return 1;
+  }
+  question_watcher.start();
 
-  // for (i32 i = 0; i < question_list.size; i++) {
-  //   if (question_list[i].text == "Name Something That Might Physically Happen To Your Body When Scared") {
+  // for (i32 i = 0; i < bank->db.question_count(); i++) {
+  //   if (bank->db.question(i).text == "Name Something That Might Physically Happen To Your Body When Scared") {
   //     printf("asdasdads %i\n", i);
   //   }
   // }
 
+  // fracas_server [shard count] [arena stats interval], defaults to one shard per hardware thread
+  // and no stats. with an interval, every tracked arena is printed that many seconds apart
+  i32 shard_count    = argc > 1 ? atoi(argv[1]) : (i32)std::thread::hardware_concurrency();
+  shard_count        = std::max(1, std::min(shard_count, MAX_SHARDS));
+  i32 stats_interval = argc > 2 ? std::max(0, atoi(argv[2])) : 0;
+
+  Shards shards;
+  shards.start(shard_count);
+  printf("Serving on %d shards\n", shard_count);
+
   SOCKET s          = open_socket(6519);
   SOCKET rpc_socket = open_socket(6666);
 
-  RpcServer rpc_server{&server_data};
+  const u64 IGNORED_LISTENER_KEY = 0;
+  const u64 RPC_LISTENER_KEY     = 1;
 
-  auto loop_start_time = std::chrono::high_resolution_clock::now();
-  while (true) {
-    auto now        = std::chrono::high_resolution_clock::now();
-    auto elapsed    = now - loop_start_time;
-    loop_start_time = now;
+  Poller poller;
+  poller.init(2);
+  poller.add(s, IGNORED_LISTENER_KEY, POLL_READ);
+  poller.add(rpc_socket, RPC_LISTENER_KEY, POLL_READ);
 
-    {
-      SOCKET new_socket;
-      sockaddr_in client;
-      int c      = sizeof(sockaddr_in);
-      new_socket = accept(s, (sockaddr *)&client, &c);
-      if (new_socket == INVALID_SOCKET) {
-        int err;
-        if ((err = WSAGetLastError()) != WSAEWOULDBLOCK) {
-          printf("accept failed with error code : %d\n", err);
-        }
-      } else {
-        closesocket(new_socket);
-      }
-    }
+  PollEvent events[MAX_POLL_EVENTS];
 
-    {
-      sockaddr_in client = {};
-      int c              = sizeof(sockaddr_in);
-      SOCKET new_socket  = accept(rpc_socket, (sockaddr *)&client, &c);
-      if (new_socket == INVALID_SOCKET) {
-        int err;
-        if ((err = WSAGetLastError()) != WSAEWOULDBLOCK) {
-          printf("accept failed with error code : %d\n", err);
-        }
-      } else {
-        add_client(&server_data, new_socket);
+  // this thread only accepts, then deals new clients out to the shards in turn
+  i32 next_shard = 0;
+  auto next_stats = std::chrono::steady_clock::now() + std::chrono::seconds(stats_interval);
+  while (true) {
+    i64 timeout_ms = -1;
+    if (stats_interval) {
+      auto now = std::chrono::steady_clock::now();
+      if (now >= next_stats) {
+        print_arena_stats();
+        next_stats = now + std::chrono::seconds(stats_interval);
       }
+      timeout_ms =
+          std::chrono::duration_cast<std::chrono::milliseconds>(next_stats - now).count() + 1;
     }
+    int event_count = poller.wait(events, MAX_POLL_EVENTS, timeout_ms);
 
-    ClientId client_to_delete = 0;  // delete one at a time :shrug:
-    for (auto &it : server_data.clients) {
-      ClientId client_id = it.first;
-      Client *client     = &(it.second);
+    for (int e = 0; e < event_count; e++) {
+      PollEvent event = events[e];
 
-      if (!client->peer.is_connected()) {
-        rpc_server.on_disconnect(client_id);
-        client_to_delete = client_id;
+      // a listener only reports a hangup when it's broken, and it would keep reporting it
+      if (event.events & POLL_HANGUP) {
+        SOCKET listener = event.key == IGNORED_LISTENER_KEY ? s : rpc_socket;
+        printf("Listener on port %d failed, no longer accepting on it\n",
+               event.key == IGNORED_LISTENER_KEY ? 6519 : 6666);
+        poller.remove(listener);
         continue;
       }
 
-      int msg_len;
-      char msg[MAX_MSG_SIZE];
-      while ((msg_len = client->peer.recieve_msg(msg)) > 0) {
-        client->peer.pop_message();
-        rpc_server.handle_rpc(client->client_id, &client->peer, msg, msg_len);
+      if (event.key == IGNORED_LISTENER_KEY) {
+        SOCKET new_socket;
+        while ((new_socket = accept_socket(s)) != INVALID_SOCKET) {
+          close_socket(new_socket);
+        }
+        continue;
       }
-    }
-    if (client_to_delete) {
-      server_data.clients.erase(client_to_delete);
-    }
 
-    for (auto &it : server_data.lobbies) {
-      Lobby *lobby = &it.second;
-      lobby->tick({&rpc_server, lobby}, elapsed.count());
-      if (lobby->stage == LobbyStage::DEAD) {
-        server_data.lobbies.erase(it.first);
+      SOCKET new_socket;
+      while ((new_socket = accept_socket(rpc_socket)) != INVALID_SOCKET) {
+        ClientId client_id = reserve_client_id(&shards.directory);
+        if (!client_id) {
+          close_socket(new_socket);
+          continue;
+        }
+
+        Client client;
+        client.client_id = client_id;
+        client.peer.attach(new_socket);
+        shards.shards[next_shard].hand_off(client);
+        next_shard = (next_shard + 1) % shards.count;
       }
     }
-
-    // Sleep(1000);
-    tmp.reset();
-
   }
 
-  closesocket(s);
+  poller.deinit();
+  close_socket(s);
+  close_socket(rpc_socket);
   deinit_net();
 
   return 0;
-}
\ No newline at end of file
+}
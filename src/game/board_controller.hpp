@@ -101,7 +101,7 @@ struct BoardController {
 
     Font *font                 = assets->get_font(FONT_ANTON, 64);
     int render_target_id       = 1 + index;
-    RenderTarget render_target = assets->render_targets.data[render_target_id].value;
+    RenderTarget render_target = assets->render_targets[render_target_id];
     render_target.bind();
     render_target.clear({0, 0, 0, 0});
     const float text_scale = 2.f;
@@ -3,6 +3,7 @@
 #include "board_controller.hpp"
 #include "../game_state.hpp"
 #include "../net/generated_rpc_client.hpp"
+#include "../net/state_replication.hpp"
 #include "../scene/scene.hpp"
 #include "../spline.hpp"
 
@@ -490,8 +491,7 @@ struct PromptForAnswerSequence : Sequence {
     if (answerer->id == game_data->my_id) {
       scenes.ui_controller->show_answer_textbox(true);
       if (scenes.ui_controller->answer_submitted) {
-        // TODO answering
-        // rpc_client->InGameAnswer({scenes.ui_controller->answer_textbox.text});
+        rpc_client->InGameAnswer({-1, scenes.ui_controller->answer_textbox.text});
         scenes.ui_controller->show_answer_textbox(false);
       }
     } else {
@@ -733,37 +733,37 @@ struct EeeeeggghhhhSequence : Sequence {
 
     // FYI this is relying on the first three entities in the second secene being Xs
     if (game_data->incorrects == 1 || game_data->round_stage == RoundStage::FACEOFF) {
-      scenes.xs->entities.data[1].value.transform.position = {0, 0, x_pop_function(t)};
-      scenes.xs->entities.data[1].value.transform.rotation = {PI / 2, 0, 0};
-      scenes.xs->entities.data[1].value.transform.scale    = {
+      scenes.xs->entities[1].transform.position = {0, 0, x_pop_function(t)};
+      scenes.xs->entities[1].transform.rotation = {PI / 2, 0, 0};
+      scenes.xs->entities[1].transform.scale    = {
           1 + x_pop_function(t) * .1f,
           1 + x_pop_function(t) * .1f,
           1 + x_pop_function(t) * .1f,
       };
 
-      scenes.xs->entities.data[0].value.transform.position.z = 10;
-      scenes.xs->entities.data[2].value.transform.position.z = 10;
+      scenes.xs->entities[0].transform.position.z = 10;
+      scenes.xs->entities[2].transform.position.z = 10;
     } else if (game_data->incorrects == 2) {
-      scenes.xs->entities.data[0].value.transform.position = {-.5f, 0, 0};
-      scenes.xs->entities.data[0].value.transform.rotation = {PI / 2, 0, 0};
-      scenes.xs->entities.data[1].value.transform.position = {.5f, 0, x_pop_function(t)};
-      scenes.xs->entities.data[1].value.transform.rotation = {PI / 2, 0, 0};
-      scenes.xs->entities.data[1].value.transform.scale    = {
+      scenes.xs->entities[0].transform.position = {-.5f, 0, 0};
+      scenes.xs->entities[0].transform.rotation = {PI / 2, 0, 0};
+      scenes.xs->entities[1].transform.position = {.5f, 0, x_pop_function(t)};
+      scenes.xs->entities[1].transform.rotation = {PI / 2, 0, 0};
+      scenes.xs->entities[1].transform.scale    = {
           1 + x_pop_function(t) * .1f,
           1 + x_pop_function(t) * .1f,
           1 + x_pop_function(t) * .1f,
       };
 
-      scenes.xs->entities.data[2].value.transform.position.z = 10;
+      scenes.xs->entities[2].transform.position.z = 10;
     } else {
-      scenes.xs->entities.data[0].value.transform.position = {-1, 0, 0};
-      scenes.xs->entities.data[0].value.transform.rotation = {PI / 2, 0, 0};
-      scenes.xs->entities.data[1].value.transform.position = {0, 0, 0};
-      scenes.xs->entities.data[1].value.transform.rotation = {PI / 2, 0, 0};
-
-      scenes.xs->entities.data[2].value.transform.position = {1, 0, x_pop_function(t)};
-      scenes.xs->entities.data[2].value.transform.rotation = {PI / 2, 0, 0};
-      scenes.xs->entities.data[2].value.transform.scale    = {
+      scenes.xs->entities[0].transform.position = {-1, 0, 0};
+      scenes.xs->entities[0].transform.rotation = {PI / 2, 0, 0};
+      scenes.xs->entities[1].transform.position = {0, 0, 0};
+      scenes.xs->entities[1].transform.rotation = {PI / 2, 0, 0};
+
+      scenes.xs->entities[2].transform.position = {1, 0, x_pop_function(t)};
+      scenes.xs->entities[2].transform.rotation = {PI / 2, 0, 0};
+      scenes.xs->entities[2].transform.scale    = {
           1 + x_pop_function(t) * .1f,
           1 + x_pop_function(t) * .1f,
           1 + x_pop_function(t) * .1f,
@@ -771,7 +771,7 @@ struct EeeeeggghhhhSequence : Sequence {
     }
 
     // moving light pizzazzzz
-    scenes.xs->entities.data[7].value.transform.position.x = 1.8f - t;
+    scenes.xs->entities[7].transform.position.x = 1.8f - t;
 
     yield_wait(4.f);
 
@@ -810,9 +810,8 @@ struct EeeeeggghhhhSequence : Sequence {
             glm::normalize(initial_rot + ((target_rot - initial_rot) * actual_t));
         glm::vec3 actual_rot_euler = glm::eulerAngles(actual_rot);
 
-        scenes.xs->entities.data[i].value.transform.position = {actual_pos.x, actual_pos.y,
-                                                                actual_pos.z};
-        scenes.xs->entities.data[i].value.transform.rotation = {
+        scenes.xs->entities[i].transform.position = {actual_pos.x, actual_pos.y, actual_pos.z};
+        scenes.xs->entities[i].transform.rotation = {
             actual_rot_euler.x, actual_rot_euler.y, actual_rot_euler.z};
       }
 
@@ -956,6 +955,7 @@ struct ScriptData {
   bool sent_ready = false;
 
   ClientGameData game_data;
+  StateHistory replicated;  // roster snapshots pings can be deltas against
 
   void reset(Scenes scenes);
   bool handle_rpcs(Scenes scenes, RpcClient *rpc_client);
@@ -1033,11 +1033,19 @@ bool ScriptData::handle_rpcs(Scenes scenes, RpcClient *rpc_client)
     printf("get_StartGame_msg\n");
     reset(scenes);
   } else if (auto msg = rpc_client->get_GameStatePing_msg()) {
-    game_data.my_id = msg->my_id;
-
-    game_data.players.clear();
-    for (auto p : msg->players) {
-      game_data.players.append({p.user_id, p.name, p.family});
+    // a delta against a snapshot we no longer have is dropped, acking 0 gets a full one instead
+    u32 snapshot = receive_state(&replicated, msg);
+    rpc_client->GameStateAck({snapshot});
+
+    if (snapshot) {
+      ReplicatedState *state = replicated.latest();
+      game_data.my_id        = msg->my_id;
+      game_data.scores[0]    = state->scores[0];
+      game_data.scores[1]    = state->scores[1];
+      game_data.players.clear();
+      for (auto p : state->players) {
+        game_data.players.append({p.user_id, p.name, p.family});
+      }
     }
   } else if (auto msg = rpc_client->get_InGameStartRound_msg()) {
     printf("get_InGameStartRound_msg\n");
@@ -21,9 +21,9 @@ struct KeyedAnimationTrack {
   };
 
   EntityId entity_id;
-  DynamicArray<Key> keys;
-
-  KeyedAnimationTrack() : keys(&assets_allocator) {}
+  // most tracks only key a few frames. past that keys go on the heap, not in assets_allocator:
+  // editing grows them a little at a time, and each outgrown buffer would stay behind in the arena
+  DynamicArray<Key, 4> keys;
 
   u32 add_key(Transform transform, i32 frame, Key::InterpolationType interpolation_type)
   {
@@ -133,7 +133,7 @@ struct KeyedAnimation : Asset {
 
     KeyedAnimationTrack track;
     track.entity_id = entity_id;
-    tracks.push_back(track);
+    tracks.push_back(std::move(track));
   }
 
   Transform eval(u32 track_i, f32 t)
@@ -1,17 +1,20 @@
 #pragma once
 
-#include <unordered_map>
-
 #include "common.hpp"
 #include "game_state.hpp"
 #include "net/generated_rpc_server.hpp"
 #include "net/net.hpp"
+#include "net/state_replication.hpp"
+#include "server/answer_matcher.hpp"
 #include "server/answer_parser.hpp"
+#include "server/directory.hpp"
+#include "server/lobby_browser.hpp"
+#include "server/question_bank.hpp"
+#include "server/question_db.hpp"
+#include "server/timer_wheel.hpp"
 
-StackAllocator tmp;
+thread_local StackAllocator tmp;
 HashMap<Entry> thesaurus;
-DynamicArray<Question> question_list;
-DynamicArray<String> answer_list;
 
 String to_lower(String in)
 {
@@ -33,9 +36,58 @@ void error(String msg) { printf("%.*s\n", msg.len, msg.data); }
 
 const uint64_t second = 1000000000;
 
+// pings only carry changes now, so they can go out often. an unacknowledged one is resent after a
+// second
+const u32 PINGS_PER_SECOND = 4;
+
+// everything here is sized up front by init(), the tables never allocate afterwards
 struct ServerData {
-  std::unordered_map<GameId, Lobby> lobbies;
-  std::unordered_map<ClientId, Client> clients;
+  SlotMap<Lobby> lobbies;  // keyed by GameId >> SHARD_BITS
+  SlotMap<Client> clients;
+  HandleAllocator lobby_ids;
+  TimerWheel timers;
+
+  LobbyDirectory *directory = nullptr;
+  i32 shard_index           = 0;
+
+  // lobby slots whose listing needs publishing
+  Array<u32, MAX_GAMES> changed_listings;
+  bool listing_queued[MAX_GAMES] = {};
+
+  // every shard's open lobbies, and this shard's clients browsing them
+  LobbyBrowser browser;
+  Array<ClientId, MAX_CLIENTS> lobby_subscribers;
+  u32 pushed_revision = 0;
+  LobbiesChangedMessage lobby_changes;
+
+  void init(LobbyDirectory *directory, i32 shard_index)
+  {
+    this->directory   = directory;
+    this->shard_index = shard_index;
+
+    lobby_ids.init(MAX_GAMES, GAME_HANDLE_BITS);
+    lobbies.init(MAX_GAMES, lobby_ids.index_bits);
+    clients.init(MAX_CLIENTS, directory->client_ids.index_bits);
+    // a waiter and a ping per lobby
+    timers.init(MAX_GAMES * 2);
+  }
+
+  Lobby *get_lobby(GameId game_id)
+  {
+    if (game_id <= 0 || shard_of(game_id) != shard_index) return nullptr;
+    return lobbies.get(game_id >> SHARD_BITS);
+  }
+
+  Client *get_client(ClientId client_id) { return clients.get(client_id); }
+
+  // call for anything a lobby listing shows: created, joined, left, swapped, started or removed
+  void listing_changed(GameId game_id)
+  {
+    u32 slot = lobby_ids.index_of(game_id >> SHARD_BITS);
+    if (listing_queued[slot]) return;
+    listing_queued[slot] = true;
+    changed_listings.append(slot);
+  }
 };
 
 struct GameProperties {
@@ -55,25 +107,64 @@ struct Lobby {
   LobbyStage stage = LobbyStage::NOT_STARTED;
   GameState game   = {};
 
+  // the current question's answers, compiled for matching typed guesses
+  QuestionMatcher matcher;
+
+  // the snapshot the current round's question came from, held until the next round starts
+  QuestionBank *bank = nullptr;
+
+  // waiters run once when their timer fires, unless the stage moves on first
   typedef void (Lobby::*Stage)(Broadcaster);
-  typedef void (Lobby::*Waiter)(Broadcaster, uint64_t);
-  Stage next_stage         = nullptr;
-  Waiter waiter            = nullptr;
-  uint64_t waiter_deadline = 0;
-  uint64_t waiter_elapsed  = 0;
+  typedef void (Lobby::*Waiter)(Broadcaster);
+  Stage next_stage = nullptr;
+  Waiter waiter    = nullptr;
+
+  // what each player has of the roster, so pings only carry what changed
+  struct Replica {
+    ClientId id;
+    u32 acked     = 0;  // newest snapshot the client has confirmed
+    u32 sent      = 0;  // newest snapshot sent to it
+    u32 sent_ping = 0;
+  };
+  StateHistory history;
+  Array<Replica, MAX_PLAYERS_PER_GAME> replicas;
+  u32 pings = 0;
 
-  u64 ping_elapsed = 0;
+  TimerWheel *timers   = nullptr;
+  GameId id            = 0;
+  TimerId waiter_timer = 0;
+  TimerId ping_timer   = 0;
 
   bool ready_to_delete = false;
 
   Lobby() = default;
   Lobby(GameProperties properties) { this->properties = properties; }
 
-  void set_waiter(Waiter waiter, uint64_t deadline)
+  enum TimerKind : u32 {
+    TIMER_WAITER,
+    TIMER_PING,
+  };
+
+  void start_timers(TimerWheel *timers, GameId id)
   {
-    this->waiter    = waiter;
-    waiter_deadline = deadline;
-    waiter_elapsed  = 0;
+    this->timers = timers;
+    this->id     = id;
+    ping_timer   = timers->schedule(second / PINGS_PER_SECOND, id, TIMER_PING);
+  }
+
+  void stop_timers()
+  {
+    timers->cancel(waiter_timer);
+    timers->cancel(ping_timer);
+    waiter_timer = ping_timer = 0;
+    waiter                    = nullptr;
+  }
+
+  void set_waiter(Waiter waiter, uint64_t timeout)
+  {
+    timers->cancel(waiter_timer);
+    this->waiter = waiter;
+    waiter_timer = timers->schedule(timeout, id, TIMER_WAITER);
   }
 
   void set_next_stage(Stage stage)
@@ -104,6 +195,9 @@ struct Lobby {
       next_family = 1;
     }
     game.players.append({client_id, name, next_family});
+
+    // starts from nothing acknowledged, so the first ping it gets is a full snapshot
+    replicas.append({client_id});
   }
 
   void remove_player(ClientId client_id, Broadcaster broadcaster)
@@ -113,6 +207,10 @@ struct Lobby {
         game.players.shift_delete(i);
       }
     }
+    for (int i = 0; i < replicas.len; i++) {
+      if (replicas[i].id == client_id) replicas.shift_delete(i--);
+    }
+    broadcaster.rpc_server->server_data->listing_changed(id);
 
     if (properties.owner == client_id) {
       end_game(broadcaster);
@@ -142,11 +240,13 @@ struct Lobby {
     // game = GameState(); TODO this resets players which are now stored in GameState. Either remove
     // them from GameState or make a GameState::reset function
     stage = LobbyStage::IN_GAME;
+    broadcaster.rpc_server->server_data->listing_changed(id);
 
     for (int i = 0; i < game.players.len; i++) {
-      Peer *peer = &broadcaster.rpc_server->server_data->clients.at(game.players[i].id).peer;
+      Client *client = broadcaster.rpc_server->server_data->get_client(game.players[i].id);
+      if (!client) continue;
       ((RpcServer *)broadcaster.rpc_server)
-          ->GameStarted(peer, GameStartedMessage{game_id, game.players[i].id});
+          ->GameStarted(&client->peer, GameStartedMessage{game_id, game.players[i].id});
     }
 
     set_next_stage(&Lobby::stage_start_round);
@@ -158,6 +258,7 @@ struct Lobby {
   {
     stage            = LobbyStage::ENDED;
     game.round_stage = RoundStage::END;
+    broadcaster.rpc_server->server_data->listing_changed(id);
 
     InGameEndGameMessage msg;
     msg.game_winner = game.scores[0] > game.scores[1] ? 0 : 1;
@@ -183,8 +284,12 @@ struct Lobby {
 
     game.last_answer_index = -1;
 
-    i32 q_index = 3420;  // rand() % question_list.size;
-    Question q  = question_list[q_index];
+    QuestionBank *previous = bank;
+    bank                   = question_banks.acquire();
+    question_banks.release(previous);
+
+    i32 q_index = 3420 % bank->db.question_count();  // rand() % bank->db.question_count();
+    Question q  = bank->db.question(q_index);
 
     game.question = q.text;
 
@@ -192,6 +297,7 @@ struct Lobby {
     for (i32 i = 0; i < q.answers.len; i++) {
       game.answers.append({false, q.answers[i].score, q.answers[i].index});
     }
+    matcher.init(&q, &bank->db, &thesaurus);
 
     // game.question = string_to_allocated_string<128>("name a color bitch bitch stupid bitch?");
     // game.answers.append({false, 98, "RED"});
@@ -270,7 +376,8 @@ struct Lobby {
 
       InGameFlipAnswerMessage msg;
       msg.answer_rank = answer_rank;
-      msg.answer = string_to_allocated_string<64>(answer_list[game.answers[answer_rank].index]);
+      msg.answer =
+          string_to_allocated_string<64>(bank->db.answer(game.answers[answer_rank].index));
       msg.score  = score;
       msg.round_score = game.this_round_points;
       broadcaster.broadcast(&RpcServer::InGameFlipAnswer, msg);
@@ -375,126 +482,285 @@ struct Lobby {
 
   void stage_end_game(Broadcaster broadcaster) { end_game(broadcaster); }
 
-  void waiter_buzz(Broadcaster broadcaster, uint64_t elapsed_micros)
+  void waiter_buzz(Broadcaster broadcaster)
   {
-    waiter_elapsed += elapsed_micros;
-    if (waiter_elapsed >= waiter_deadline) {
-      game.incorrects += 1;
-      broadcaster.broadcast(&RpcServer::InGameEggghhhh, InGameEggghhhhMessage{game.incorrects});
-      set_next_stage(&Lobby::stage_end_round);
-    }
-
-    printf("buzz_waiter - time_elapsed: %llu\n", waiter_elapsed);
+    printf("waiter_buzz - timeout\n");
+    game.incorrects += 1;
+    broadcaster.broadcast(&RpcServer::InGameEggghhhh, InGameEggghhhhMessage{game.incorrects});
+    set_next_stage(&Lobby::stage_end_round);
   }
-  void waiter_pass_or_play(Broadcaster broadcaster, uint64_t elapsed_micros)
+  void waiter_pass_or_play(Broadcaster broadcaster)
   {
-    waiter_elapsed += elapsed_micros;
-    if (waiter_elapsed >= waiter_deadline) {
-      // default to PLAY
-      game.playing_family = game.faceoff_winning_family;
-      broadcaster.broadcast(&RpcServer::InGamePlayerChosePassOrPlay,
-                            InGameChoosePassOrPlayMessage{true});
-      set_next_stage(&Lobby::stage_start_play);
-    }
-    printf("waiter_pass_or_play - time_elapsed: %llu\n", waiter_elapsed);
-  }
-  void waiter_answer(Broadcaster broadcaster, uint64_t elapsed_micros)
+    printf("waiter_pass_or_play - timeout\n");
+    // default to PLAY
+    game.playing_family = game.faceoff_winning_family;
+    broadcaster.broadcast(&RpcServer::InGamePlayerChosePassOrPlay,
+                          InGameChoosePassOrPlayMessage{true});
+    set_next_stage(&Lobby::stage_start_play);
+  }
+  void waiter_answer(Broadcaster broadcaster)
   {
-    waiter_elapsed += elapsed_micros;
-    if (waiter_elapsed >= waiter_deadline) {
-      game.last_answer_index           = -1;
-      AllocatedString<64> empty_answer = string_to_allocated_string<64>("...");
-      broadcaster.broadcast(&RpcServer::InGamePlayerAnswered, InGameAnswerMessage{-1});
+    printf("waiter_answer - timeout\n");
+    game.last_answer_index           = -1;
+    AllocatedString<64> empty_answer = string_to_allocated_string<64>("...");
+    broadcaster.broadcast(&RpcServer::InGamePlayerAnswered, InGameAnswerMessage{-1});
 
-      set_next_stage(&Lobby::stage_respond_to_answer);
-    }
-    printf("waiter_answer - time_e lapsed: %llu\n", waiter_elapsed);
+    set_next_stage(&Lobby::stage_respond_to_answer);
   }
-  void waiter_all_ready(Broadcaster broadcaster, uint64_t elapsed_micros)
+  void waiter_all_ready(Broadcaster broadcaster)
   {
-    waiter_elapsed += elapsed_micros;
-    if (waiter_elapsed >= waiter_deadline) {
-      printf("waiter_all_ready - timeout\n");
-      do_next_stage(broadcaster);
-    }
-    // printf("waiter_all_ready - time_elapsed: %llu\n", waiter_elapsed);
+    printf("waiter_all_ready - timeout\n");
+    do_next_stage(broadcaster);
   }
-  void waiter_end_game(Broadcaster broadcaster, uint64_t elapsed_micros)
+  void waiter_end_game(Broadcaster broadcaster)
   {
-    waiter_elapsed += elapsed_micros;
-    if (waiter_elapsed >= waiter_deadline) {
-      ready_to_delete = true;
-    }
-    // printf("waiter_end_game - time_elapsed: %llu\n", waiter_elapsed);
+    ready_to_delete = true;
+    stage           = LobbyStage::DEAD;
   }
 
-  void tick(Broadcaster broadcaster, uint64_t elapsed_time)
+  void on_timer(Broadcaster broadcaster, u32 kind)
   {
-    if (waiter) {
-      (this->*waiter)(broadcaster, elapsed_time);
+    if (kind == TIMER_WAITER) {
+      Waiter fired = waiter;
+      waiter       = nullptr;
+      waiter_timer = 0;
+      if (fired) (this->*fired)(broadcaster);
+    } else if (kind == TIMER_PING) {
+      ping_timer = timers->schedule(second / PINGS_PER_SECOND, id, TIMER_PING);
+      ping(broadcaster);
     }
+  }
 
-    ping_elapsed += elapsed_time;
-    if (ping_elapsed > 1 * second) {
-      ping_elapsed = 0;
+  void ping(Broadcaster broadcaster)
+  {
+    pings++;
 
-      GameStatePingMessage msg;
-      for (int i = 0; i < game.players.len; i++) {
-        msg.players.push_back(
-            {game.players[i].id, game.players[i].name, game.players[i].family == 1});
-      }
-      for (int i = 0; i < game.players.len; i++) {
-        Peer *peer = &broadcaster.rpc_server->server_data->clients.at(game.players[i].id).peer;
-        msg.my_id  = game.players[i].id;
-        ((RpcServer *)broadcaster.rpc_server)->GameStatePing(peer, msg);
+    ReplicatedState state;
+    for (int i = 0; i < game.players.len; i++) {
+      state.players.append({game.players[i].id, game.players[i].name, game.players[i].family == 1});
+    }
+    state.scores[0]         = game.scores[0];
+    state.scores[1]         = game.scores[1];
+    ReplicatedState *latest = history.update(&state);
+
+    GameStatePingMessage msg;
+    for (Replica &replica : replicas) {
+      if (replica.acked == latest->snapshot) continue;
+      if (replica.sent == latest->snapshot && pings - replica.sent_ping < PINGS_PER_SECOND) continue;
+
+      Client *client = broadcaster.rpc_server->server_data->get_client(replica.id);
+      if (!client) continue;
+
+      // against what the client last acknowledged, or everything if that's gone from the history
+      diff_state(history.find(replica.acked), latest, &msg);
+      msg.my_id = replica.id;
+      ((RpcServer *)broadcaster.rpc_server)->GameStatePing(&client->peer, msg);
+      replica.sent      = latest->snapshot;
+      replica.sent_ping = pings;
+    }
+  }
+
+  // 0 asks for a full snapshot, the client couldn't apply the last delta
+  void acknowledge(ClientId client_id, u32 snapshot)
+  {
+    for (Replica &replica : replicas) {
+      if (replica.id != client_id) continue;
+      if (!snapshot) {
+        replica.acked = replica.sent = 0;
+      } else if (snapshot > replica.acked && history.find(snapshot)) {
+        replica.acked = snapshot;
       }
     }
   }
 };
 
-template <typename FN, typename MSG>
-void Broadcaster::broadcast(FN fn, MSG msg)
+template <typename MSG>
+void Broadcaster::broadcast(void (RpcServer::*fn)(Broadcaster, MSG), MSG msg)
 {
-  for (int i = 0; i < lobby->game.players.len; i++) {
-    ClientId client_id = lobby->game.players[i].id;
+  (((RpcServer *)rpc_server)->*fn)(*this, msg);
+}
 
-    if (rpc_server->server_data->clients.count(client_id)) {
-      (((RpcServer *)rpc_server)->*fn)(&rpc_server->server_data->clients.at(client_id).peer, msg);
+void Broadcaster::send(MessageBuilder *msg)
+{
+  SendBuffer *buf = msg->finish();
+  for (int i = 0; i < lobby->game.players.len; i++) {
+    Client *client = rpc_server->server_data->get_client(lobby->game.players[i].id);
+    if (client) {
+      client->peer.queue(buf);
+      client->peer.flush();
     }
   }
+  send_buffers.release(buf);
 }
 
-ClientId add_client(ServerData *server_data, SOCKET s)
+// reserves a ClientId for a new connection, 0 if the server is full. safe to call from any thread
+ClientId reserve_client_id(LobbyDirectory *directory)
 {
-  static ClientId next_client_id = 1;
-  next_client_id++;
+  std::lock_guard<std::mutex> lock(directory->client_ids_mutex);
 
-  if (server_data->clients.size() > MAX_CLIENTS) {
+  ClientId client_id = directory->client_ids.alloc();
+  if (!client_id) {
     // TODO send error message SERVER_FULL
     error("too many connections");
-    return 0;
   }
+  return client_id;
+}
 
-  Client client;
-  client.peer.s    = s;
-  client.client_id = next_client_id;
+Client *add_client(ServerData *server_data, Client client)
+{
+  return server_data->clients.insert(client.client_id, client);
+}
 
-  server_data->clients[next_client_id] = client;
-  return next_client_id;
+// the ClientId is released for reuse, so only call this once the connection is gone for good
+void remove_client(ServerData *server_data, ClientId client_id)
+{
+  server_data->clients.remove(client_id);
+
+  LobbyDirectory *directory = server_data->directory;
+  std::lock_guard<std::mutex> lock(directory->client_ids_mutex);
+  directory->client_ids.release(client_id);
 }
 
 GameId add_game(ServerData *server_data, GameProperties properties)
 {
-  static GameId next_game_id = 1;
-  next_game_id++;
+  LobbyDirectory *directory = server_data->directory;
+  if (directory->game_count.fetch_add(1) >= MAX_GAMES) {
+    directory->game_count--;
+    return 0;
+  }
 
-  if (server_data->lobbies.size() > MAX_GAMES) {
+  u32 handle = server_data->lobby_ids.alloc();
+  if (!handle) {
+    directory->game_count--;
     return 0;
   }
 
-  server_data->lobbies[next_game_id] = Lobby(properties);
-  server_data->lobbies[next_game_id].add_player(properties.owner, properties.owner_name);
-  return next_game_id;
+  // the owning shard lives in the low bits so any thread can route to this lobby
+  GameId game_id = (handle << SHARD_BITS) | server_data->shard_index;
+
+  Lobby *lobby = server_data->lobbies.insert(handle, Lobby(properties));
+  lobby->add_player(properties.owner, properties.owner_name);
+  lobby->start_timers(&server_data->timers, game_id);
+  server_data->listing_changed(game_id);
+  return game_id;
+}
+
+void remove_game(ServerData *server_data, GameId game_id)
+{
+  Lobby *lobby = server_data->get_lobby(game_id);
+  if (!lobby) return;
+
+  lobby->stop_timers();
+  question_banks.release(lobby->bank);
+  server_data->listing_changed(game_id);
+  server_data->lobbies.remove(game_id >> SHARD_BITS);
+  server_data->lobby_ids.release(game_id >> SHARD_BITS);
+  server_data->directory->game_count--;
+}
+
+// rewrites this shard's changed listings in the directory for other threads to read, each at a new
+// directory revision. a removed lobby is published too, so browsers can drop it
+void publish_listings(ServerData *server_data)
+{
+  LobbyDirectory *directory = server_data->directory;
+  ShardListings *out        = &directory->shards[server_data->shard_index];
+
+  std::lock_guard<std::mutex> lock(directory->publish_mutex);
+  u32 revision = directory->revision.load(std::memory_order_relaxed);
+
+  out->begin_publish();
+  for (u32 slot : server_data->changed_listings) {
+    Lobby *lobby          = server_data->lobbies.get(server_data->lobby_ids.handle_at(slot));
+    LobbyListing *listing = &out->listings[slot];
+
+    if (lobby) {
+      listing->id             = lobby->id;
+      listing->name           = lobby->properties.name;
+      listing->owner          = lobby->properties.owner_name;
+      listing->is_self_hosted = lobby->properties.is_self_hosted;
+      listing->not_started    = lobby->stage == LobbyStage::NOT_STARTED;
+      listing->num_players    = lobby->game.num_players();
+      listing->removed        = false;
+      out->players[slot]      = lobby->game.players;
+    } else {
+      listing->removed = true;
+      out->players[slot].clear();
+    }
+    listing->revision = ++revision;
+    out->slots        = std::max(out->slots, (i32)slot + 1);
+
+    server_data->listing_queued[slot] = false;
+  }
+  out->end_publish();
+  directory->revision.store(revision, std::memory_order_release);
+
+  server_data->changed_listings.clear();
+}
+
+// what changed in the lobby browser since base, serialized. the caller holds the one reference
+SendBuffer *lobby_changes_since(ServerData *server_data, u32 base)
+{
+  server_data->browser.diff(base, &server_data->lobby_changes);
+
+  MessageBuilder out;
+  append(&out, (char)Rpc::LobbiesChanged);
+  append(&out, server_data->lobby_changes);
+  return out.finish();
+}
+
+void send_lobby_changes(ServerData *server_data, Peer *peer, u32 base)
+{
+  SendBuffer *buf = lobby_changes_since(server_data, base);
+  peer->queue(buf);
+  peer->flush();
+  send_buffers.release(buf);
+}
+
+// sends every browsing client what changed since it was last sent anything, once the browser has
+// moved on. clients that were last sent the same revision share one serialized diff
+void push_lobby_changes(ServerData *server_data)
+{
+  LobbyBrowser *browser = &server_data->browser;
+  browser->update(server_data->directory);
+  if (browser->revision == server_data->pushed_revision) return;
+  server_data->pushed_revision = browser->revision;
+
+  struct Diff {
+    u32 base        = 0;
+    SendBuffer *buf = nullptr;
+  };
+  Array<Diff, 8> diffs;
+
+  Array<ClientId, MAX_CLIENTS> *subscribers = &server_data->lobby_subscribers;
+  for (i32 i = 0; i < subscribers->len; i++) {
+    Client *client = server_data->get_client((*subscribers)[i]);
+    if (!client || !client->browsing) {
+      subscribers->swap_delete(i--);
+      continue;
+    }
+    if (client->browsed_revision == browser->revision) continue;
+
+    Diff *diff = nullptr;
+    for (Diff &it : diffs) {
+      if (it.base == client->browsed_revision) diff = &it;
+    }
+    if (diff) {
+      client->peer.queue(diff->buf);
+      client->peer.flush();
+    } else if (diffs.len < diffs.MAX_LEN) {
+      SendBuffer *buf = lobby_changes_since(server_data, client->browsed_revision);
+      diffs.append({client->browsed_revision, buf});
+      client->peer.queue(buf);
+      client->peer.flush();
+    } else {
+      send_lobby_changes(server_data, &client->peer, client->browsed_revision);
+    }
+    client->browsed_revision = browser->revision;
+  }
+
+  for (Diff &diff : diffs) {
+    send_buffers.release(diff.buf);
+  }
 }
 
 template <size_t N>
@@ -522,55 +788,96 @@ AllocatedString<N> sanitize_name(AllocatedString<N> name)
 
 void BaseRpcServer::on_disconnect(ClientId client_id)
 {
-  Client *client = &server_data->clients[client_id];
-  if (client->game_id && server_data->lobbies.count(client->game_id)) {
-    Lobby *lobby = &server_data->lobbies[client->game_id];
+  Client *client = server_data->get_client(client_id);
+  if (!client) return;
+
+  Lobby *lobby = server_data->get_lobby(client->game_id);
+  if (lobby) {
     lobby->remove_player(client_id, {this, lobby});
+    if (lobby->game.players.len == 0) remove_game(server_data, client->game_id);
   }
 }
 
 void RpcServer::HandleListGames(ClientId client_id, ListGamesRequest *req, ListGamesResponse *resp)
 {
-  for (auto it : server_data->lobbies) {
-    GameId game_id = it.first;
-    Lobby *lobby   = &it.second;
-
-    if (lobby->stage == LobbyStage::NOT_STARTED) {
-      GameMetadata game_msg;
-      game_msg.id             = game_id;
-      game_msg.name           = lobby->properties.name;
-      game_msg.owner          = server_data->clients[lobby->properties.owner].username;
-      game_msg.num_players    = lobby->game.num_players();
-      game_msg.is_self_hosted = lobby->properties.is_self_hosted;
-      resp->games.push_back(game_msg);
-    }
+  // lobbies on every shard, including this one, come from the published listings
+  server_data->browser.update(server_data->directory);
+  server_data->browser.page(req->offset, req->limit ? req->limit : resp->games.MAX_LEN, resp);
+}
+
+void RpcServer::HandleSubscribeLobbies(ClientId client_id, SubscribeLobbiesRequest *req)
+{
+  Client *client = server_data->get_client(client_id);
+  if (client->game_id) {
+    return;  // client is in a game
+  }
+
+  if (!client->browsing) server_data->lobby_subscribers.append(client_id);
+  client->browsing = true;
+
+  // catches the client up now, from then on it's pushed changes as they're published
+  server_data->browser.update(server_data->directory);
+  send_lobby_changes(server_data, &client->peer, req->revision);
+  client->browsed_revision = server_data->browser.revision;
+}
+
+void RpcServer::HandleUnsubscribeLobbies(ClientId client_id, Empty *req)
+{
+  Client *client   = server_data->get_client(client_id);
+  client->browsing = false;
+
+  Array<ClientId, MAX_CLIENTS> *subscribers = &server_data->lobby_subscribers;
+  for (i32 i = 0; i < subscribers->len; i++) {
+    if ((*subscribers)[i] == client_id) subscribers->swap_delete(i--);
   }
 }
 
 void RpcServer::HandleGetGame(ClientId client_id, GetGameRequest *req, GetGameResponse *resp)
 {
-  if (server_data->lobbies.count(req->game_id) == 0) {
+  LobbyDirectory *directory = server_data->directory;
+  i32 shard                 = shard_of(req->game_id);
+  if (shard != server_data->shard_index && shard < directory->shard_count) {
+    LobbyListing listing;
+    Array<PlayerData, MAX_PLAYERS_PER_GAME> players;
+    if (!directory->shards[shard].copy_lobby(req->game_id, &listing, &players)) {
+      // TODO send NOT_FOUND
+      error("game not found");
+      return;
+    }
+
+    resp->game.id             = listing.id;
+    resp->game.name           = listing.name;
+    resp->game.owner          = listing.owner;
+    resp->game.num_players    = listing.num_players;
+    resp->game.is_self_hosted = listing.is_self_hosted;
+    for (int i = 0; i < players.len; i++) {
+      resp->players.append({players[i].id, players[i].name, players[i].family == 1});
+    }
+    return;
+  }
+
+  Lobby *lobby = server_data->get_lobby(req->game_id);
+  if (!lobby) {
     // TODO send NOT_FOUND
     error("game not found");
     return;
   }
 
-  Lobby *lobby              = &server_data->lobbies[req->game_id];
   resp->game.id             = req->game_id;
   resp->game.name           = lobby->properties.name;
-  resp->game.owner          = server_data->clients[lobby->properties.owner].username;
+  resp->game.owner          = lobby->properties.owner_name;
   resp->game.num_players    = lobby->game.num_players();
   resp->game.is_self_hosted = lobby->properties.is_self_hosted;
   for (int i = 0; i < lobby->game.players.len; i++) {
-    resp->players.push_back({lobby->game.players[i].id, lobby->game.players[i].name,
-                             lobby->game.players[i].family == 1});
+    resp->players.append({lobby->game.players[i].id, lobby->game.players[i].name,
+                          lobby->game.players[i].family == 1});
   }
 }
 
 void RpcServer::HandleCreateGame(ClientId client_id, CreateGameRequest *req,
                                  CreateGameResponse *resp)
 {
-  Client *client = &server_data->clients[client_id];
+  Client *client = server_data->get_client(client_id);
   if (client->game_id) {
     return;  // client is already in a game
   }
@@ -600,21 +907,24 @@ void RpcServer::HandleCreateGame(ClientId client_id, CreateGameRequest *req,
   GameId game_id = add_game(server_data, game_properties);
   if (!game_id) {
     // TODO send error message TOO_MANY_GAMES
+    error("too many games");
+    return;
   }
 
-  Lobby *lobby    = &server_data->lobbies[game_id];
-  resp->game_id   = game_id;
-  resp->owner_id  = client->client_id;
-  client->game_id = game_id;
+  resp->game_id    = game_id;
+  resp->owner_id   = client->client_id;
+  client->game_id  = game_id;
+  client->browsing = false;
 }
 
 void RpcServer::HandleJoinGame(ClientId client_id, JoinGameRequest *req, JoinGameResponse *resp)
 {
-  Client *client = &server_data->clients[client_id];
+  Client *client = server_data->get_client(client_id);
   if (client->game_id) {
     return;  // client is already in a game
   }
-  if (server_data->lobbies.count(req->game_id) == 0) {
+  Lobby *lobby = server_data->get_lobby(req->game_id);
+  if (!lobby) {
     // TODO send error, game NOT_FOUND
     return;
   }
@@ -625,23 +935,24 @@ void RpcServer::HandleJoinGame(ClientId client_id, JoinGameRequest *req, JoinGam
     return;  // TODO invalid name
   }
 
-  Lobby *lobby = &server_data->lobbies[req->game_id];
   lobby->add_player(client_id, player_name);
-  client->game_id = req->game_id;
+  server_data->listing_changed(req->game_id);
+  client->game_id  = req->game_id;
+  client->browsing = false;
 }
 
 void RpcServer::HandleSwapTeam(ClientId client_id, SwapTeamRequest *req, Empty *resp)
 {
-  Client *client = &server_data->clients[client_id];
+  Client *client = server_data->get_client(client_id);
   if (client->game_id != req->game_id) {
     return;  // client is not in the requested game
   }
-  if (server_data->lobbies.count(req->game_id) == 0) {
+  Lobby *lobby = server_data->get_lobby(req->game_id);
+  if (!lobby) {
     // TODO send error, game NOT_FOUND
     return;
   }
 
-  Lobby *lobby = &server_data->lobbies[req->game_id];
   if (lobby->properties.owner != client_id) {
     return;  // TODO client doesn't own this game
   }
@@ -657,23 +968,26 @@ void RpcServer::HandleSwapTeam(ClientId client_id, SwapTeamRequest *req, Empty *
       lobby->game.players[i].family = 1 - lobby->game.players[i].family;
     }
   }
+  server_data->listing_changed(req->game_id);
 }
 
 void RpcServer::HandleLeaveGame(ClientId client_id, LeaveGameRequest *req, LeaveGameResponse *resp)
 {
   printf("HandleLeaveGame - player: %i\n", client_id);
 
-  Client *client = &server_data->clients[client_id];
+  Client *client = server_data->get_client(client_id);
   if (!client->game_id) {
     return;  // client is not in a game
   }
-  if (server_data->lobbies.count(client->game_id) == 0) {
+  Lobby *lobby = server_data->get_lobby(client->game_id);
+  if (!lobby) {
     // TODO send error INTERNAL_ERROR
     return;
   }
 
-  Lobby *lobby = &server_data->lobbies[client->game_id];
   lobby->remove_player(client->client_id, {this, lobby});
+  // nobody is left to see the end screen, so free the slot now rather than after the end game wait
+  if (lobby->game.players.len == 0) remove_game(server_data, client->game_id);
   client->game_id = 0;
 }
 
@@ -681,12 +995,12 @@ void RpcServer::HandleStartGame(ClientId client_id, StartGameRequest *req, Start
 {
   printf("HandleStartGame - player: %i, game: %i\n", client_id, req->game_id);
 
-  Client *client = &server_data->clients[client_id];
-  if (server_data->lobbies.count(client->game_id) == 0) {
+  Client *client = server_data->get_client(client_id);
+  Lobby *lobby = server_data->get_lobby(client->game_id);
+  if (!lobby || client->game_id != req->game_id) {
     // TODO send error INTERNAL_ERROR
     return;
   }
-  Lobby *lobby = &server_data->lobbies[req->game_id];
   if (lobby->properties.owner != client_id) {
     return;  // TODO client doesn't own this game
   }
@@ -703,13 +1017,13 @@ void RpcServer::HandleInGameReady(ClientId client_id, Empty *req, Empty *resp)
 {
   printf("HandleInGameReady - player: %i\n", client_id);
 
-  Client *client = &server_data->clients[client_id];
-  if (server_data->lobbies.count(client->game_id) == 0) {
+  Client *client = server_data->get_client(client_id);
+  Lobby *lobby = server_data->get_lobby(client->game_id);
+  if (!lobby) {
     // TODO send error PERMISSION_DENIED
     return;
   }
 
-  Lobby *lobby = &server_data->lobbies[client->game_id];
   if (lobby->waiter != &Lobby::waiter_all_ready) {
     return;
   }
@@ -726,13 +1040,13 @@ void RpcServer::HandleInGameBuzz(ClientId client_id, Empty *req, Empty *resp)
 {
   printf("HandleInGameBuzz - player: %i\n", client_id);
 
-  Client *client = &server_data->clients[client_id];
-  if (server_data->lobbies.count(client->game_id) == 0) {
+  Client *client = server_data->get_client(client_id);
+  Lobby *lobby = server_data->get_lobby(client->game_id);
+  if (!lobby) {
     // TODO send error PERMISSION_DENIED
     return;
   }
 
-  Lobby *lobby = &server_data->lobbies[client->game_id];
   if (lobby->waiter != &Lobby::waiter_buzz) {
     return;
   }
@@ -757,13 +1071,13 @@ void RpcServer::HandleInGameAnswer(ClientId client_id, InGameAnswerMessage *req,
   // printf("HandleInGameAnswer - player: %i, answer: %.*s\n", client_id, req->answer.len,
   //        req->answer.data);
 
-  Client *client = &server_data->clients[client_id];
-  if (server_data->lobbies.count(client->game_id) == 0) {
+  Client *client = server_data->get_client(client_id);
+  Lobby *lobby = server_data->get_lobby(client->game_id);
+  if (!lobby) {
     // TODO send error PERMISSION_DENIED
     return;
   }
 
-  Lobby *lobby = &server_data->lobbies[client->game_id];
   if (lobby->waiter != &Lobby::waiter_answer) {
     return;
   }
@@ -772,10 +1086,17 @@ void RpcServer::HandleInGameAnswer(ClientId client_id, InGameAnswerMessage *req,
     return;
   }
 
+  // typed answers are matched here, the rest of the round only deals in answer indices
+  i32 answer_index = req->answer_index;
+  if (req->answer.len) {
+    i32 rank     = lobby->matcher.match(req->answer);
+    answer_index = rank == -1 ? -1 : lobby->game.answers[rank].index;
+  }
+
   Broadcaster{this, lobby}.broadcast(&RpcServer::InGamePlayerAnswered,
-                                     InGameAnswerMessage{req->answer_index});
+                                     InGameAnswerMessage{answer_index, req->answer});
 
-  lobby->game.last_answer_index     = req->answer_index;
+  lobby->game.last_answer_index     = answer_index;
   lobby->game.last_answer_client_id = client_id;
 
   lobby->set_next_stage(&Lobby::stage_respond_to_answer);
@@ -786,13 +1107,13 @@ void RpcServer::HandleInGameChoosePassOrPlay(ClientId client_id, InGameChoosePas
 {
   printf("HandleInGameChoosePassOrPlay - player: %i, play?: %i\n", client_id, req->play);
 
-  Client *client = &server_data->clients[client_id];
-  if (server_data->lobbies.count(client->game_id) == 0) {
+  Client *client = server_data->get_client(client_id);
+  Lobby *lobby = server_data->get_lobby(client->game_id);
+  if (!lobby) {
     // TODO send error PERMISSION_DENIED
     return;
   }
 
-  Lobby *lobby = &server_data->lobbies[client->game_id];
   if (lobby->waiter != &Lobby::waiter_pass_or_play) {
     return;
   }
@@ -811,4 +1132,13 @@ void RpcServer::HandleInGameChoosePassOrPlay(ClientId client_id, InGameChoosePas
   }
 
   lobby->set_next_stage(&Lobby::stage_start_play);
-}
\ No newline at end of file
+}
+
+void RpcServer::HandleGameStateAck(ClientId client_id, GameStateAckMessage *req)
+{
+  Client *client = server_data->get_client(client_id);
+  Lobby *lobby   = server_data->get_lobby(client->game_id);
+  if (!lobby) return;
+
+  lobby->acknowledge(client_id, req->snapshot);
+}
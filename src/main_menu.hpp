@@ -539,6 +539,11 @@ struct JoinGamePage : MenuPage {
   Font *font;
   RpcClient *rpc_client;
 
+  // the open lobbies, sorted by id. while subscribed the server pushes what changed since revision
+  std::vector<List::Item> games;
+  u32 revision    = 0;
+  bool subscribed = false;
+
   JoinGamePage(Assets *assets, RpcClient *rpc_client, Memory mem)
   {
     font             = assets->get_font(FONT_ROBOTO_CONDENSED_REGULAR, 128);
@@ -570,10 +575,50 @@ struct JoinGamePage : MenuPage {
     username_textbox.rect.height = 70.f;
   }
 
+  void subscribe(u32 from)
+  {
+    rpc_client->SubscribeLobbies({from});
+    subscribed = true;
+  }
+
+  void unsubscribe()
+  {
+    rpc_client->UnsubscribeLobbies({});
+    subscribed = false;
+  }
+
+  void apply_changes(LobbiesChangedMessage *msg)
+  {
+    // a change was missed, start over from everything
+    if (msg->base && msg->base != revision) {
+      subscribe(0);
+      return;
+    }
+
+    if (!msg->base) games.clear();
+    for (RemovedGame &removed : msg->removed) {
+      games.erase(std::remove_if(games.begin(), games.end(),
+                                 [&](List::Item &game) { return game.id == removed.id; }),
+                  games.end());
+    }
+    for (GameMetadata &changed : msg->changed) {
+      auto it = std::lower_bound(games.begin(), games.end(), changed.id,
+                                 [](List::Item &game, int32_t id) { return game.id < id; });
+      if (it != games.end() && it->id == changed.id) {
+        it->name = changed.name;
+      } else {
+        games.insert(it, {changed.id, changed.name});
+      }
+    }
+    revision = msg->revision;
+    game_list.refresh(games);
+  }
+
   void update_and_draw(RenderTarget target, InputState *input, MainMenu *menu,
                        ClientGameData *game_data) override
   {
     if (back_button.update_and_draw(target, input, font)) {
+      unsubscribe();
       menu->current = menu->main;
     }
 
@@ -581,17 +626,9 @@ struct JoinGamePage : MenuPage {
     draw_centered_text(*font, target, "Select Game", title_background, .1f, 10, 1);
 
     draw_rect(target, game_list_panel, {0.f, 1.f, 0.f, .4f});
-    {
-      ListGamesRequest req;
-      rpc_client->ListGames(req);
-
-      if (auto resp = rpc_client->get_ListGames_msg()) {
-        std::vector<List::Item> game_list_items;
-        for (auto g : resp->games) {
-          game_list_items.push_back({g.id, g.name});
-        }
-        game_list.refresh(game_list_items);
-      }
+    if (!subscribed) subscribe(revision);
+    if (auto msg = rpc_client->get_LobbiesChanged_msg()) {
+      apply_changes(msg);
     }
     game_list.update_and_draw(target, input, font);
 
@@ -602,6 +639,7 @@ struct JoinGamePage : MenuPage {
       username_textbox.update_and_draw(target, input, font);
 
       if (join_button.update_and_draw(target, input, font)) {
+        unsubscribe();
         rpc_client->JoinGame({game_list.get_selected_id(), username_textbox.text});
         ((LobbyPage *)menu->lobby)->set_game(game_list.get_selected_id(), 0);
         menu->current = menu->lobby;
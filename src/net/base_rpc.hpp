@@ -1,7 +1,7 @@
 #pragma once
 
 #define NOMINMAX
-#include "net_windows.hpp"
+#include "peer.hpp"
 
 struct ServerData;
 struct BaseRpcServer {
@@ -28,10 +28,13 @@ struct BaseRpcClient {
 };
 
 struct Lobby;
+struct RpcServer;
 struct Broadcaster {
   BaseRpcServer *rpc_server;
   Lobby *lobby;
 
-  template <typename FN, typename MSG>
-  void broadcast(FN, MSG);
+  template <typename MSG>
+  void broadcast(void (RpcServer::*)(Broadcaster, MSG), MSG);
+  // queues a single serialized copy of msg on every player in the lobby
+  void send(MessageBuilder *msg);
 };
\ No newline at end of file
@@ -1,7 +1,26 @@
 
 #pragma once
-#include "net_windows.hpp"
-#include <vector>
+#include "peer.hpp"
+
+// hash of messages.rpc. a client's first frame is RPC_HELLO carrying the schema it was built
+// from, and the server drops clients whose schema doesn't match its own
+const uint32_t RPC_SCHEMA_VERSION = 0x273F3388;
+const char RPC_HELLO = 0;
+
+void append_hello(MessageBuilder *msg)
+{
+    append(msg, RPC_HELLO);
+    append(msg, RPC_SCHEMA_VERSION);
+}
+bool read_hello(char *data, int msg_len)
+{
+    MessageReader in(data, msg_len);
+    char rpc;
+    uint32_t version;
+    read(&in, &rpc);
+    read(&in, &version);
+    return !in.overran() && rpc == RPC_HELLO && version == RPC_SCHEMA_VERSION;
+}
 
 enum struct Message : char
 {
@@ -9,6 +28,9 @@ enum struct Message : char
 	GameMetadata,
 	ListGamesRequest,
 	ListGamesResponse,
+	SubscribeLobbiesRequest,
+	RemovedGame,
+	LobbiesChangedMessage,
 	Player,
 	GetGameRequest,
 	GetGameResponse,
@@ -26,7 +48,9 @@ enum struct Message : char
 	InGameAnswerMessage,
 	InGameChoosePassOrPlayMessage,
 	InGameStartRoundMessage,
+	RemovedPlayer,
 	GameStatePingMessage,
+	GameStateAckMessage,
 	InGameStartFaceoffMessage,
 	InGameAskQuestionMessage,
 	InGamePlayerBuzzedMessage,
@@ -44,41 +68,22 @@ enum struct Message : char
 struct Empty 
 {
 
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = 0;
 };
+
 void append(MessageBuilder *msg, Empty &in)
 {
+    msg->reserve(Empty::MAX_SIZE);
 
 }
-uint32_t read(MessageReader *msg, Empty *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, Empty *out)
 {
-    uint32_t len = 0;
-
 
-    return len;
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<Empty> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<Empty> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		Empty elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct GameMetadata 
 {
@@ -87,1144 +92,917 @@ struct GameMetadata
     AllocatedString<64> owner = {};
     bool is_self_hosted = false;
     int32_t num_players = {};
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32 + varint_size(64) + 64 + varint_size(64) + 64 + 1 + MAX_VARINT32;
 };
+static_assert(GameMetadata::MAX_SIZE <= MAX_MSG_SIZE, "GameMetadata is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 + varint_size(64) + 64 + varint_size(64) + 64 + 1 + MAX_VARINT32 <= MAX_READ_OVERRUN, "reading GameMetadata can run too far past the end");
 void append(MessageBuilder *msg, GameMetadata &in)
 {
+    msg->reserve(GameMetadata::MAX_SIZE);
     append(msg, in.id);
     append(msg, in.name);
     append(msg, in.owner);
     append(msg, in.is_self_hosted);
     append(msg, in.num_players);
 }
-uint32_t read(MessageReader *msg, GameMetadata *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, GameMetadata *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->id);
-    len += read(msg, &out->name);
-    len += read(msg, &out->owner);
-    len += read(msg, &out->is_self_hosted);
-    len += read(msg, &out->num_players);
-    return len;
+    read(msg, &out->id);
+    read(msg, &out->name);
+    read(msg, &out->owner);
+    read(msg, &out->is_self_hosted);
+    read(msg, &out->num_players);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<GameMetadata> &in)
+
+// lists are inline arrays with their capacity set in messages.rpc, so messages never allocate.
+// they carry as many elements as are sure to fit in MAX_MSG_SIZE with room_after still left for
+// the rest of their message. the count is written last, as a two byte varint, once that's known.
+// its two bytes were reserved by the message. reserving can move the buffer, so the count is found
+// again by its offset
+template <size_t N>
+void append(MessageBuilder *msg, Array<GameMetadata, N> &in, uint32_t room_after)
 {
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
+    static_assert(N < 0x4000, "list count has to fit in two varint bytes");
+    uint32_t count_offset = msg->data - msg->buf->data;
+    msg->data += 2;
+
+    uint16_t count = 0;
+    for (; count < in.len && msg->remaining() >= GameMetadata::MAX_SIZE + room_after; count++)
     {
-        append(msg, it);
+        msg->reserve(GameMetadata::MAX_SIZE + room_after);
+        append(msg, in.arr[count]);
     }
-};
-uint32_t read(MessageReader *msg, std::vector<GameMetadata> *out)
+    char *count_at = msg->buf->data + count_offset;
+    count_at[0]    = (count & 0x7F) | 0x80;
+    count_at[1]    = count >> 7;
+}
+template <size_t N>
+bool read(MessageReader *msg, Array<GameMetadata, N> *out)
 {
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
+    uint16_t count;
+    read(msg, &count);
+    if (count > N) msg->fail();
+    for (uint16_t i = 0; i < count && !msg->overran(); i++)
     {
-		GameMetadata elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
+        read(msg, &out->arr[out->len++]);
+    }
+    return !msg->overran();
+}
 
 struct ListGamesRequest 
 {
+    uint32_t offset = {};
+    uint32_t limit = {};
 
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32 + MAX_VARINT32;
 };
+static_assert(ListGamesRequest::MAX_SIZE <= MAX_MSG_SIZE, "ListGamesRequest is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 + MAX_VARINT32 <= MAX_READ_OVERRUN, "reading ListGamesRequest can run too far past the end");
 void append(MessageBuilder *msg, ListGamesRequest &in)
 {
-
+    msg->reserve(ListGamesRequest::MAX_SIZE);
+    append(msg, in.offset);
+    append(msg, in.limit);
 }
-uint32_t read(MessageReader *msg, ListGamesRequest *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, ListGamesRequest *out)
 {
-    uint32_t len = 0;
-
-
-    return len;
+    read(msg, &out->offset);
+    read(msg, &out->limit);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<ListGamesRequest> &in)
+
+struct ListGamesResponse 
 {
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
+    uint32_t revision = {};
+    uint32_t total = {};
+    Array<GameMetadata, 32> games = {};
+
+    // the most append() can write, lists are cut short to fit MAX_MSG_SIZE
+    static const uint32_t MAX_SIZE = std::min<uint32_t>(MAX_MSG_SIZE, MAX_VARINT32 + MAX_VARINT32 + 2 + 32 * GameMetadata::MAX_SIZE);
 };
-uint32_t read(MessageReader *msg, std::vector<ListGamesRequest> *out)
+static_assert(ListGamesResponse::MAX_SIZE <= MAX_MSG_SIZE, "ListGamesResponse is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 + MAX_VARINT32 + 2 + GameMetadata::MAX_SIZE <= MAX_READ_OVERRUN, "reading ListGamesResponse can run too far past the end");
+void append(MessageBuilder *msg, ListGamesResponse &in)
 {
-	uint32_t len = 0;
+    msg->reserve(MAX_VARINT32 + MAX_VARINT32 + 2);
+    append(msg, in.revision);
+    append(msg, in.total);
+    append(msg, in.games, 0);
+}
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, ListGamesResponse *out)
+{
+    read(msg, &out->revision);
+    read(msg, &out->total);
+    read(msg, &out->games);
+    return !msg->overran();
+}
 
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		ListGamesRequest elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
+struct SubscribeLobbiesRequest 
+{
+    uint32_t revision = {};
 
-	return len;
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32;
 };
+static_assert(SubscribeLobbiesRequest::MAX_SIZE <= MAX_MSG_SIZE, "SubscribeLobbiesRequest is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 <= MAX_READ_OVERRUN, "reading SubscribeLobbiesRequest can run too far past the end");
+void append(MessageBuilder *msg, SubscribeLobbiesRequest &in)
+{
+    msg->reserve(SubscribeLobbiesRequest::MAX_SIZE);
+    append(msg, in.revision);
+}
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, SubscribeLobbiesRequest *out)
+{
+    read(msg, &out->revision);
+    return !msg->overran();
+}
 
-struct ListGamesResponse 
+struct RemovedGame 
 {
-    std::vector<GameMetadata> games = {};
+    int32_t id = {};
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32;
 };
-void append(MessageBuilder *msg, ListGamesResponse &in)
+static_assert(RemovedGame::MAX_SIZE <= MAX_MSG_SIZE, "RemovedGame is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 <= MAX_READ_OVERRUN, "reading RemovedGame can run too far past the end");
+void append(MessageBuilder *msg, RemovedGame &in)
 {
-    append(msg, in.games);
+    msg->reserve(RemovedGame::MAX_SIZE);
+    append(msg, in.id);
 }
-uint32_t read(MessageReader *msg, ListGamesResponse *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, RemovedGame *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->games);
-    return len;
+    read(msg, &out->id);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<ListGamesResponse> &in)
+
+// lists are inline arrays with their capacity set in messages.rpc, so messages never allocate.
+// they carry as many elements as are sure to fit in MAX_MSG_SIZE with room_after still left for
+// the rest of their message. the count is written last, as a two byte varint, once that's known.
+// its two bytes were reserved by the message. reserving can move the buffer, so the count is found
+// again by its offset
+template <size_t N>
+void append(MessageBuilder *msg, Array<RemovedGame, N> &in, uint32_t room_after)
 {
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
+    static_assert(N < 0x4000, "list count has to fit in two varint bytes");
+    uint32_t count_offset = msg->data - msg->buf->data;
+    msg->data += 2;
+
+    uint16_t count = 0;
+    for (; count < in.len && msg->remaining() >= RemovedGame::MAX_SIZE + room_after; count++)
     {
-        append(msg, it);
+        msg->reserve(RemovedGame::MAX_SIZE + room_after);
+        append(msg, in.arr[count]);
     }
-};
-uint32_t read(MessageReader *msg, std::vector<ListGamesResponse> *out)
+    char *count_at = msg->buf->data + count_offset;
+    count_at[0]    = (count & 0x7F) | 0x80;
+    count_at[1]    = count >> 7;
+}
+template <size_t N>
+bool read(MessageReader *msg, Array<RemovedGame, N> *out)
 {
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
+    uint16_t count;
+    read(msg, &count);
+    if (count > N) msg->fail();
+    for (uint16_t i = 0; i < count && !msg->overran(); i++)
     {
-		ListGamesResponse elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
+        read(msg, &out->arr[out->len++]);
+    }
+    return !msg->overran();
+}
+
+struct LobbiesChangedMessage 
+{
+    uint32_t base = {};
+    uint32_t revision = {};
+    Array<GameMetadata, 128> changed = {};
+    Array<RemovedGame, 128> removed = {};
 
-	return len;
+    // the most append() can write, lists are cut short to fit MAX_MSG_SIZE
+    static const uint32_t MAX_SIZE = std::min<uint32_t>(MAX_MSG_SIZE, MAX_VARINT32 + MAX_VARINT32 + 2 + 128 * GameMetadata::MAX_SIZE + 2 + 128 * RemovedGame::MAX_SIZE);
 };
+static_assert(LobbiesChangedMessage::MAX_SIZE <= MAX_MSG_SIZE, "LobbiesChangedMessage is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 + MAX_VARINT32 + 2 + GameMetadata::MAX_SIZE + 2 + RemovedGame::MAX_SIZE <= MAX_READ_OVERRUN, "reading LobbiesChangedMessage can run too far past the end");
+void append(MessageBuilder *msg, LobbiesChangedMessage &in)
+{
+    msg->reserve(MAX_VARINT32 + MAX_VARINT32 + 2 + 2);
+    append(msg, in.base);
+    append(msg, in.revision);
+    append(msg, in.changed, 2);
+    append(msg, in.removed, 0);
+}
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, LobbiesChangedMessage *out)
+{
+    read(msg, &out->base);
+    read(msg, &out->revision);
+    read(msg, &out->changed);
+    read(msg, &out->removed);
+    return !msg->overran();
+}
 
 struct Player 
 {
     int32_t user_id = {};
     AllocatedString<64> name = {};
     int32_t family = {};
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32 + varint_size(64) + 64 + MAX_VARINT32;
 };
+static_assert(Player::MAX_SIZE <= MAX_MSG_SIZE, "Player is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 + varint_size(64) + 64 + MAX_VARINT32 <= MAX_READ_OVERRUN, "reading Player can run too far past the end");
 void append(MessageBuilder *msg, Player &in)
 {
+    msg->reserve(Player::MAX_SIZE);
     append(msg, in.user_id);
     append(msg, in.name);
     append(msg, in.family);
 }
-uint32_t read(MessageReader *msg, Player *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, Player *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->user_id);
-    len += read(msg, &out->name);
-    len += read(msg, &out->family);
-    return len;
+    read(msg, &out->user_id);
+    read(msg, &out->name);
+    read(msg, &out->family);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<Player> &in)
+
+// lists are inline arrays with their capacity set in messages.rpc, so messages never allocate.
+// they carry as many elements as are sure to fit in MAX_MSG_SIZE with room_after still left for
+// the rest of their message. the count is written last, as a two byte varint, once that's known.
+// its two bytes were reserved by the message. reserving can move the buffer, so the count is found
+// again by its offset
+template <size_t N>
+void append(MessageBuilder *msg, Array<Player, N> &in, uint32_t room_after)
 {
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
+    static_assert(N < 0x4000, "list count has to fit in two varint bytes");
+    uint32_t count_offset = msg->data - msg->buf->data;
+    msg->data += 2;
+
+    uint16_t count = 0;
+    for (; count < in.len && msg->remaining() >= Player::MAX_SIZE + room_after; count++)
     {
-        append(msg, it);
+        msg->reserve(Player::MAX_SIZE + room_after);
+        append(msg, in.arr[count]);
     }
-};
-uint32_t read(MessageReader *msg, std::vector<Player> *out)
+    char *count_at = msg->buf->data + count_offset;
+    count_at[0]    = (count & 0x7F) | 0x80;
+    count_at[1]    = count >> 7;
+}
+template <size_t N>
+bool read(MessageReader *msg, Array<Player, N> *out)
 {
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
+    uint16_t count;
+    read(msg, &count);
+    if (count > N) msg->fail();
+    for (uint16_t i = 0; i < count && !msg->overran(); i++)
     {
-		Player elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
+        read(msg, &out->arr[out->len++]);
+    }
+    return !msg->overran();
+}
 
 struct GetGameRequest 
 {
     int32_t game_id = {};
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32;
 };
+static_assert(GetGameRequest::MAX_SIZE <= MAX_MSG_SIZE, "GetGameRequest is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 <= MAX_READ_OVERRUN, "reading GetGameRequest can run too far past the end");
 void append(MessageBuilder *msg, GetGameRequest &in)
 {
+    msg->reserve(GetGameRequest::MAX_SIZE);
     append(msg, in.game_id);
 }
-uint32_t read(MessageReader *msg, GetGameRequest *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, GetGameRequest *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->game_id);
-    return len;
+    read(msg, &out->game_id);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<GetGameRequest> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<GetGameRequest> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		GetGameRequest elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct GetGameResponse 
 {
     GameMetadata game = {};
-    std::vector<Player> players = {};
+    Array<Player, 12> players = {};
+
+    // the most append() can write, lists are cut short to fit MAX_MSG_SIZE
+    static const uint32_t MAX_SIZE = std::min<uint32_t>(MAX_MSG_SIZE, GameMetadata::MAX_SIZE + 2 + 12 * Player::MAX_SIZE);
 };
+static_assert(GetGameResponse::MAX_SIZE <= MAX_MSG_SIZE, "GetGameResponse is over MAX_MSG_SIZE");
+static_assert(GameMetadata::MAX_SIZE + 2 + Player::MAX_SIZE <= MAX_READ_OVERRUN, "reading GetGameResponse can run too far past the end");
 void append(MessageBuilder *msg, GetGameResponse &in)
 {
+    msg->reserve(GameMetadata::MAX_SIZE + 2);
     append(msg, in.game);
-    append(msg, in.players);
+    append(msg, in.players, 0);
 }
-uint32_t read(MessageReader *msg, GetGameResponse *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, GetGameResponse *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->game);
-    len += read(msg, &out->players);
-    return len;
+    read(msg, &out->game);
+    read(msg, &out->players);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<GetGameResponse> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<GetGameResponse> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		GetGameResponse elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct CreateGameRequest 
 {
     AllocatedString<64> name = {};
     AllocatedString<64> owner_name = {};
     bool is_self_hosted = false;
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = varint_size(64) + 64 + varint_size(64) + 64 + 1;
 };
+static_assert(CreateGameRequest::MAX_SIZE <= MAX_MSG_SIZE, "CreateGameRequest is over MAX_MSG_SIZE");
+static_assert(varint_size(64) + 64 + varint_size(64) + 64 + 1 <= MAX_READ_OVERRUN, "reading CreateGameRequest can run too far past the end");
 void append(MessageBuilder *msg, CreateGameRequest &in)
 {
+    msg->reserve(CreateGameRequest::MAX_SIZE);
     append(msg, in.name);
     append(msg, in.owner_name);
     append(msg, in.is_self_hosted);
 }
-uint32_t read(MessageReader *msg, CreateGameRequest *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, CreateGameRequest *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->name);
-    len += read(msg, &out->owner_name);
-    len += read(msg, &out->is_self_hosted);
-    return len;
+    read(msg, &out->name);
+    read(msg, &out->owner_name);
+    read(msg, &out->is_self_hosted);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<CreateGameRequest> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<CreateGameRequest> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		CreateGameRequest elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct CreateGameResponse 
 {
     int32_t game_id = {};
     int32_t owner_id = {};
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32 + MAX_VARINT32;
 };
+static_assert(CreateGameResponse::MAX_SIZE <= MAX_MSG_SIZE, "CreateGameResponse is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 + MAX_VARINT32 <= MAX_READ_OVERRUN, "reading CreateGameResponse can run too far past the end");
 void append(MessageBuilder *msg, CreateGameResponse &in)
 {
+    msg->reserve(CreateGameResponse::MAX_SIZE);
     append(msg, in.game_id);
     append(msg, in.owner_id);
 }
-uint32_t read(MessageReader *msg, CreateGameResponse *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, CreateGameResponse *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->game_id);
-    len += read(msg, &out->owner_id);
-    return len;
+    read(msg, &out->game_id);
+    read(msg, &out->owner_id);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<CreateGameResponse> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<CreateGameResponse> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		CreateGameResponse elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct JoinGameRequest 
 {
     int32_t game_id = {};
     AllocatedString<64> player_name = {};
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32 + varint_size(64) + 64;
 };
+static_assert(JoinGameRequest::MAX_SIZE <= MAX_MSG_SIZE, "JoinGameRequest is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 + varint_size(64) + 64 <= MAX_READ_OVERRUN, "reading JoinGameRequest can run too far past the end");
 void append(MessageBuilder *msg, JoinGameRequest &in)
 {
+    msg->reserve(JoinGameRequest::MAX_SIZE);
     append(msg, in.game_id);
     append(msg, in.player_name);
 }
-uint32_t read(MessageReader *msg, JoinGameRequest *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, JoinGameRequest *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->game_id);
-    len += read(msg, &out->player_name);
-    return len;
+    read(msg, &out->game_id);
+    read(msg, &out->player_name);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<JoinGameRequest> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<JoinGameRequest> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		JoinGameRequest elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct JoinGameResponse 
 {
 
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = 0;
 };
+
 void append(MessageBuilder *msg, JoinGameResponse &in)
 {
+    msg->reserve(JoinGameResponse::MAX_SIZE);
 
 }
-uint32_t read(MessageReader *msg, JoinGameResponse *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, JoinGameResponse *out)
 {
-    uint32_t len = 0;
-
 
-    return len;
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<JoinGameResponse> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<JoinGameResponse> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		JoinGameResponse elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct SwapTeamRequest 
 {
     int32_t game_id = {};
     int32_t user_id = {};
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32 + MAX_VARINT32;
 };
+static_assert(SwapTeamRequest::MAX_SIZE <= MAX_MSG_SIZE, "SwapTeamRequest is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 + MAX_VARINT32 <= MAX_READ_OVERRUN, "reading SwapTeamRequest can run too far past the end");
 void append(MessageBuilder *msg, SwapTeamRequest &in)
 {
+    msg->reserve(SwapTeamRequest::MAX_SIZE);
     append(msg, in.game_id);
     append(msg, in.user_id);
 }
-uint32_t read(MessageReader *msg, SwapTeamRequest *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, SwapTeamRequest *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->game_id);
-    len += read(msg, &out->user_id);
-    return len;
+    read(msg, &out->game_id);
+    read(msg, &out->user_id);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<SwapTeamRequest> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<SwapTeamRequest> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		SwapTeamRequest elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct LeaveGameRequest 
 {
 
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = 0;
 };
+
 void append(MessageBuilder *msg, LeaveGameRequest &in)
 {
+    msg->reserve(LeaveGameRequest::MAX_SIZE);
 
 }
-uint32_t read(MessageReader *msg, LeaveGameRequest *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, LeaveGameRequest *out)
 {
-    uint32_t len = 0;
 
-
-    return len;
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<LeaveGameRequest> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<LeaveGameRequest> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		LeaveGameRequest elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct LeaveGameResponse 
 {
 
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = 0;
 };
+
 void append(MessageBuilder *msg, LeaveGameResponse &in)
 {
+    msg->reserve(LeaveGameResponse::MAX_SIZE);
 
 }
-uint32_t read(MessageReader *msg, LeaveGameResponse *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, LeaveGameResponse *out)
 {
-    uint32_t len = 0;
 
-
-    return len;
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<LeaveGameResponse> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<LeaveGameResponse> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		LeaveGameResponse elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct StartGameRequest 
 {
     int32_t game_id = {};
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32;
 };
+static_assert(StartGameRequest::MAX_SIZE <= MAX_MSG_SIZE, "StartGameRequest is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 <= MAX_READ_OVERRUN, "reading StartGameRequest can run too far past the end");
 void append(MessageBuilder *msg, StartGameRequest &in)
 {
+    msg->reserve(StartGameRequest::MAX_SIZE);
     append(msg, in.game_id);
 }
-uint32_t read(MessageReader *msg, StartGameRequest *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, StartGameRequest *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->game_id);
-    return len;
+    read(msg, &out->game_id);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<StartGameRequest> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<StartGameRequest> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		StartGameRequest elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct StartGameResponse 
 {
 
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = 0;
 };
+
 void append(MessageBuilder *msg, StartGameResponse &in)
 {
+    msg->reserve(StartGameResponse::MAX_SIZE);
 
 }
-uint32_t read(MessageReader *msg, StartGameResponse *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, StartGameResponse *out)
 {
-    uint32_t len = 0;
-
 
-    return len;
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<StartGameResponse> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<StartGameResponse> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		StartGameResponse elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct GameStartedMessage 
 {
     int32_t game_id = {};
     int32_t your_id = {};
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32 + MAX_VARINT32;
 };
+static_assert(GameStartedMessage::MAX_SIZE <= MAX_MSG_SIZE, "GameStartedMessage is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 + MAX_VARINT32 <= MAX_READ_OVERRUN, "reading GameStartedMessage can run too far past the end");
 void append(MessageBuilder *msg, GameStartedMessage &in)
 {
+    msg->reserve(GameStartedMessage::MAX_SIZE);
     append(msg, in.game_id);
     append(msg, in.your_id);
 }
-uint32_t read(MessageReader *msg, GameStartedMessage *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, GameStartedMessage *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->game_id);
-    len += read(msg, &out->your_id);
-    return len;
+    read(msg, &out->game_id);
+    read(msg, &out->your_id);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<GameStartedMessage> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<GameStartedMessage> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		GameStartedMessage elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct PlayerLeftMessage 
 {
     int32_t user_id = {};
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32;
 };
+static_assert(PlayerLeftMessage::MAX_SIZE <= MAX_MSG_SIZE, "PlayerLeftMessage is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 <= MAX_READ_OVERRUN, "reading PlayerLeftMessage can run too far past the end");
 void append(MessageBuilder *msg, PlayerLeftMessage &in)
 {
+    msg->reserve(PlayerLeftMessage::MAX_SIZE);
     append(msg, in.user_id);
 }
-uint32_t read(MessageReader *msg, PlayerLeftMessage *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, PlayerLeftMessage *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->user_id);
-    return len;
+    read(msg, &out->user_id);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<PlayerLeftMessage> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<PlayerLeftMessage> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		PlayerLeftMessage elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct InGameAnswerMessage 
 {
     int32_t answer_index = {};
+    AllocatedString<64> answer = {};
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32 + varint_size(64) + 64;
 };
+static_assert(InGameAnswerMessage::MAX_SIZE <= MAX_MSG_SIZE, "InGameAnswerMessage is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 + varint_size(64) + 64 <= MAX_READ_OVERRUN, "reading InGameAnswerMessage can run too far past the end");
 void append(MessageBuilder *msg, InGameAnswerMessage &in)
 {
+    msg->reserve(InGameAnswerMessage::MAX_SIZE);
     append(msg, in.answer_index);
+    append(msg, in.answer);
 }
-uint32_t read(MessageReader *msg, InGameAnswerMessage *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, InGameAnswerMessage *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->answer_index);
-    return len;
+    read(msg, &out->answer_index);
+    read(msg, &out->answer);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<InGameAnswerMessage> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<InGameAnswerMessage> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		InGameAnswerMessage elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct InGameChoosePassOrPlayMessage 
 {
     bool play = false;
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = 1;
 };
+static_assert(InGameChoosePassOrPlayMessage::MAX_SIZE <= MAX_MSG_SIZE, "InGameChoosePassOrPlayMessage is over MAX_MSG_SIZE");
+static_assert(1 <= MAX_READ_OVERRUN, "reading InGameChoosePassOrPlayMessage can run too far past the end");
 void append(MessageBuilder *msg, InGameChoosePassOrPlayMessage &in)
 {
+    msg->reserve(InGameChoosePassOrPlayMessage::MAX_SIZE);
     append(msg, in.play);
 }
-uint32_t read(MessageReader *msg, InGameChoosePassOrPlayMessage *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, InGameChoosePassOrPlayMessage *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->play);
-    return len;
+    read(msg, &out->play);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<InGameChoosePassOrPlayMessage> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<InGameChoosePassOrPlayMessage> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		InGameChoosePassOrPlayMessage elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct InGameStartRoundMessage 
 {
     int32_t round = {};
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32;
 };
+static_assert(InGameStartRoundMessage::MAX_SIZE <= MAX_MSG_SIZE, "InGameStartRoundMessage is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 <= MAX_READ_OVERRUN, "reading InGameStartRoundMessage can run too far past the end");
 void append(MessageBuilder *msg, InGameStartRoundMessage &in)
 {
+    msg->reserve(InGameStartRoundMessage::MAX_SIZE);
     append(msg, in.round);
 }
-uint32_t read(MessageReader *msg, InGameStartRoundMessage *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, InGameStartRoundMessage *out)
+{
+    read(msg, &out->round);
+    return !msg->overran();
+}
+
+struct RemovedPlayer 
 {
-    uint32_t len = 0;
+    int32_t user_id = {};
 
-    len += read(msg, &out->round);
-    return len;
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32;
+};
+static_assert(RemovedPlayer::MAX_SIZE <= MAX_MSG_SIZE, "RemovedPlayer is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 <= MAX_READ_OVERRUN, "reading RemovedPlayer can run too far past the end");
+void append(MessageBuilder *msg, RemovedPlayer &in)
+{
+    msg->reserve(RemovedPlayer::MAX_SIZE);
+    append(msg, in.user_id);
 }
-void append(MessageBuilder *msg, std::vector<InGameStartRoundMessage> &in)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, RemovedPlayer *out)
 {
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
+    read(msg, &out->user_id);
+    return !msg->overran();
+}
+
+// lists are inline arrays with their capacity set in messages.rpc, so messages never allocate.
+// they carry as many elements as are sure to fit in MAX_MSG_SIZE with room_after still left for
+// the rest of their message. the count is written last, as a two byte varint, once that's known.
+// its two bytes were reserved by the message. reserving can move the buffer, so the count is found
+// again by its offset
+template <size_t N>
+void append(MessageBuilder *msg, Array<RemovedPlayer, N> &in, uint32_t room_after)
+{
+    static_assert(N < 0x4000, "list count has to fit in two varint bytes");
+    uint32_t count_offset = msg->data - msg->buf->data;
+    msg->data += 2;
+
+    uint16_t count = 0;
+    for (; count < in.len && msg->remaining() >= RemovedPlayer::MAX_SIZE + room_after; count++)
     {
-        append(msg, it);
+        msg->reserve(RemovedPlayer::MAX_SIZE + room_after);
+        append(msg, in.arr[count]);
     }
-};
-uint32_t read(MessageReader *msg, std::vector<InGameStartRoundMessage> *out)
+    char *count_at = msg->buf->data + count_offset;
+    count_at[0]    = (count & 0x7F) | 0x80;
+    count_at[1]    = count >> 7;
+}
+template <size_t N>
+bool read(MessageReader *msg, Array<RemovedPlayer, N> *out)
 {
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
+    uint16_t count;
+    read(msg, &count);
+    if (count > N) msg->fail();
+    for (uint16_t i = 0; i < count && !msg->overran(); i++)
     {
-		InGameStartRoundMessage elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
+        read(msg, &out->arr[out->len++]);
+    }
+    return !msg->overran();
+}
 
 struct GameStatePingMessage 
 {
     int32_t my_id = {};
-    std::vector<Player> players = {};
+    uint32_t snapshot = {};
+    uint32_t base = {};
+    Array<Player, 12> players = {};
+    Array<RemovedPlayer, 12> removed = {};
+    int32_t family0_score = {};
+    int32_t family1_score = {};
+
+    // the most append() can write, lists are cut short to fit MAX_MSG_SIZE
+    static const uint32_t MAX_SIZE = std::min<uint32_t>(MAX_MSG_SIZE, MAX_VARINT32 + MAX_VARINT32 + MAX_VARINT32 + 2 + 12 * Player::MAX_SIZE + 2 + 12 * RemovedPlayer::MAX_SIZE + MAX_VARINT32 + MAX_VARINT32);
 };
+static_assert(GameStatePingMessage::MAX_SIZE <= MAX_MSG_SIZE, "GameStatePingMessage is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 + MAX_VARINT32 + MAX_VARINT32 + 2 + Player::MAX_SIZE + 2 + RemovedPlayer::MAX_SIZE + MAX_VARINT32 + MAX_VARINT32 <= MAX_READ_OVERRUN, "reading GameStatePingMessage can run too far past the end");
 void append(MessageBuilder *msg, GameStatePingMessage &in)
 {
+    msg->reserve(MAX_VARINT32 + MAX_VARINT32 + MAX_VARINT32 + 2 + 2 + MAX_VARINT32 + MAX_VARINT32);
     append(msg, in.my_id);
-    append(msg, in.players);
+    append(msg, in.snapshot);
+    append(msg, in.base);
+    append(msg, in.players, 2 + MAX_VARINT32 + MAX_VARINT32);
+    append(msg, in.removed, MAX_VARINT32 + MAX_VARINT32);
+    append(msg, in.family0_score);
+    append(msg, in.family1_score);
 }
-uint32_t read(MessageReader *msg, GameStatePingMessage *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, GameStatePingMessage *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->my_id);
-    len += read(msg, &out->players);
-    return len;
+    read(msg, &out->my_id);
+    read(msg, &out->snapshot);
+    read(msg, &out->base);
+    read(msg, &out->players);
+    read(msg, &out->removed);
+    read(msg, &out->family0_score);
+    read(msg, &out->family1_score);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<GameStatePingMessage> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<GameStatePingMessage> *out)
-{
-	uint32_t len = 0;
 
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		GameStatePingMessage elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
+struct GameStateAckMessage 
+{
+    uint32_t snapshot = {};
 
-	return len;
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32;
 };
+static_assert(GameStateAckMessage::MAX_SIZE <= MAX_MSG_SIZE, "GameStateAckMessage is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 <= MAX_READ_OVERRUN, "reading GameStateAckMessage can run too far past the end");
+void append(MessageBuilder *msg, GameStateAckMessage &in)
+{
+    msg->reserve(GameStateAckMessage::MAX_SIZE);
+    append(msg, in.snapshot);
+}
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, GameStateAckMessage *out)
+{
+    read(msg, &out->snapshot);
+    return !msg->overran();
+}
 
 struct InGameStartFaceoffMessage 
 {
     int32_t faceoffer_0_id = {};
     int32_t faceoffer_1_id = {};
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32 + MAX_VARINT32;
 };
+static_assert(InGameStartFaceoffMessage::MAX_SIZE <= MAX_MSG_SIZE, "InGameStartFaceoffMessage is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 + MAX_VARINT32 <= MAX_READ_OVERRUN, "reading InGameStartFaceoffMessage can run too far past the end");
 void append(MessageBuilder *msg, InGameStartFaceoffMessage &in)
 {
+    msg->reserve(InGameStartFaceoffMessage::MAX_SIZE);
     append(msg, in.faceoffer_0_id);
     append(msg, in.faceoffer_1_id);
 }
-uint32_t read(MessageReader *msg, InGameStartFaceoffMessage *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, InGameStartFaceoffMessage *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->faceoffer_0_id);
-    len += read(msg, &out->faceoffer_1_id);
-    return len;
+    read(msg, &out->faceoffer_0_id);
+    read(msg, &out->faceoffer_1_id);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<InGameStartFaceoffMessage> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<InGameStartFaceoffMessage> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		InGameStartFaceoffMessage elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct InGameAskQuestionMessage 
 {
     AllocatedString<128> question = {};
     int32_t num_answers = {};
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = varint_size(128) + 128 + MAX_VARINT32;
 };
+static_assert(InGameAskQuestionMessage::MAX_SIZE <= MAX_MSG_SIZE, "InGameAskQuestionMessage is over MAX_MSG_SIZE");
+static_assert(varint_size(128) + 128 + MAX_VARINT32 <= MAX_READ_OVERRUN, "reading InGameAskQuestionMessage can run too far past the end");
 void append(MessageBuilder *msg, InGameAskQuestionMessage &in)
 {
+    msg->reserve(InGameAskQuestionMessage::MAX_SIZE);
     append(msg, in.question);
     append(msg, in.num_answers);
 }
-uint32_t read(MessageReader *msg, InGameAskQuestionMessage *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, InGameAskQuestionMessage *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->question);
-    len += read(msg, &out->num_answers);
-    return len;
+    read(msg, &out->question);
+    read(msg, &out->num_answers);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<InGameAskQuestionMessage> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<InGameAskQuestionMessage> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		InGameAskQuestionMessage elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct InGamePlayerBuzzedMessage 
 {
     int32_t user_id = {};
     int32_t buzzing_family = {};
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32 + MAX_VARINT32;
 };
+static_assert(InGamePlayerBuzzedMessage::MAX_SIZE <= MAX_MSG_SIZE, "InGamePlayerBuzzedMessage is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 + MAX_VARINT32 <= MAX_READ_OVERRUN, "reading InGamePlayerBuzzedMessage can run too far past the end");
 void append(MessageBuilder *msg, InGamePlayerBuzzedMessage &in)
 {
+    msg->reserve(InGamePlayerBuzzedMessage::MAX_SIZE);
     append(msg, in.user_id);
     append(msg, in.buzzing_family);
 }
-uint32_t read(MessageReader *msg, InGamePlayerBuzzedMessage *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, InGamePlayerBuzzedMessage *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->user_id);
-    len += read(msg, &out->buzzing_family);
-    return len;
+    read(msg, &out->user_id);
+    read(msg, &out->buzzing_family);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<InGamePlayerBuzzedMessage> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<InGamePlayerBuzzedMessage> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		InGamePlayerBuzzedMessage elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct InGamePrepForPromptForAnswerMessage 
 {
     int32_t family = {};
     int32_t player_position = {};
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32 + MAX_VARINT32;
 };
+static_assert(InGamePrepForPromptForAnswerMessage::MAX_SIZE <= MAX_MSG_SIZE, "InGamePrepForPromptForAnswerMessage is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 + MAX_VARINT32 <= MAX_READ_OVERRUN, "reading InGamePrepForPromptForAnswerMessage can run too far past the end");
 void append(MessageBuilder *msg, InGamePrepForPromptForAnswerMessage &in)
 {
+    msg->reserve(InGamePrepForPromptForAnswerMessage::MAX_SIZE);
     append(msg, in.family);
     append(msg, in.player_position);
 }
-uint32_t read(MessageReader *msg, InGamePrepForPromptForAnswerMessage *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, InGamePrepForPromptForAnswerMessage *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->family);
-    len += read(msg, &out->player_position);
-    return len;
+    read(msg, &out->family);
+    read(msg, &out->player_position);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<InGamePrepForPromptForAnswerMessage> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<InGamePrepForPromptForAnswerMessage> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		InGamePrepForPromptForAnswerMessage elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct InGamePromptForAnswerMessage 
 {
     int32_t user_id = {};
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32;
 };
+static_assert(InGamePromptForAnswerMessage::MAX_SIZE <= MAX_MSG_SIZE, "InGamePromptForAnswerMessage is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 <= MAX_READ_OVERRUN, "reading InGamePromptForAnswerMessage can run too far past the end");
 void append(MessageBuilder *msg, InGamePromptForAnswerMessage &in)
 {
+    msg->reserve(InGamePromptForAnswerMessage::MAX_SIZE);
     append(msg, in.user_id);
 }
-uint32_t read(MessageReader *msg, InGamePromptForAnswerMessage *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, InGamePromptForAnswerMessage *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->user_id);
-    return len;
+    read(msg, &out->user_id);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<InGamePromptForAnswerMessage> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<InGamePromptForAnswerMessage> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		InGamePromptForAnswerMessage elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct InGameStartPlayMessage 
 {
     int32_t family = {};
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32;
 };
+static_assert(InGameStartPlayMessage::MAX_SIZE <= MAX_MSG_SIZE, "InGameStartPlayMessage is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 <= MAX_READ_OVERRUN, "reading InGameStartPlayMessage can run too far past the end");
 void append(MessageBuilder *msg, InGameStartPlayMessage &in)
 {
+    msg->reserve(InGameStartPlayMessage::MAX_SIZE);
     append(msg, in.family);
 }
-uint32_t read(MessageReader *msg, InGameStartPlayMessage *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, InGameStartPlayMessage *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->family);
-    return len;
+    read(msg, &out->family);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<InGameStartPlayMessage> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<InGameStartPlayMessage> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		InGameStartPlayMessage elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct InGameStartStealMessage 
 {
     int32_t family = {};
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32;
 };
+static_assert(InGameStartStealMessage::MAX_SIZE <= MAX_MSG_SIZE, "InGameStartStealMessage is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 <= MAX_READ_OVERRUN, "reading InGameStartStealMessage can run too far past the end");
 void append(MessageBuilder *msg, InGameStartStealMessage &in)
 {
+    msg->reserve(InGameStartStealMessage::MAX_SIZE);
     append(msg, in.family);
 }
-uint32_t read(MessageReader *msg, InGameStartStealMessage *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, InGameStartStealMessage *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->family);
-    return len;
+    read(msg, &out->family);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<InGameStartStealMessage> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<InGameStartStealMessage> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		InGameStartStealMessage elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct InGameFlipAnswerMessage 
 {
@@ -1232,175 +1010,105 @@ struct InGameFlipAnswerMessage
     AllocatedString<64> answer = {};
     int32_t score = {};
     int32_t round_score = {};
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32 + varint_size(64) + 64 + MAX_VARINT32 + MAX_VARINT32;
 };
+static_assert(InGameFlipAnswerMessage::MAX_SIZE <= MAX_MSG_SIZE, "InGameFlipAnswerMessage is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 + varint_size(64) + 64 + MAX_VARINT32 + MAX_VARINT32 <= MAX_READ_OVERRUN, "reading InGameFlipAnswerMessage can run too far past the end");
 void append(MessageBuilder *msg, InGameFlipAnswerMessage &in)
 {
+    msg->reserve(InGameFlipAnswerMessage::MAX_SIZE);
     append(msg, in.answer_rank);
     append(msg, in.answer);
     append(msg, in.score);
     append(msg, in.round_score);
 }
-uint32_t read(MessageReader *msg, InGameFlipAnswerMessage *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, InGameFlipAnswerMessage *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->answer_rank);
-    len += read(msg, &out->answer);
-    len += read(msg, &out->score);
-    len += read(msg, &out->round_score);
-    return len;
+    read(msg, &out->answer_rank);
+    read(msg, &out->answer);
+    read(msg, &out->score);
+    read(msg, &out->round_score);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<InGameFlipAnswerMessage> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<InGameFlipAnswerMessage> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		InGameFlipAnswerMessage elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct InGameEggghhhhMessage 
 {
     int32_t n_incorrects = {};
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32;
 };
+static_assert(InGameEggghhhhMessage::MAX_SIZE <= MAX_MSG_SIZE, "InGameEggghhhhMessage is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 <= MAX_READ_OVERRUN, "reading InGameEggghhhhMessage can run too far past the end");
 void append(MessageBuilder *msg, InGameEggghhhhMessage &in)
 {
+    msg->reserve(InGameEggghhhhMessage::MAX_SIZE);
     append(msg, in.n_incorrects);
 }
-uint32_t read(MessageReader *msg, InGameEggghhhhMessage *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, InGameEggghhhhMessage *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->n_incorrects);
-    return len;
+    read(msg, &out->n_incorrects);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<InGameEggghhhhMessage> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<InGameEggghhhhMessage> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		InGameEggghhhhMessage elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct InGameEndRoundMessage 
 {
     int32_t round_winner = {};
     int32_t family0_score = {};
     int32_t family1_score = {};
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32 + MAX_VARINT32 + MAX_VARINT32;
 };
+static_assert(InGameEndRoundMessage::MAX_SIZE <= MAX_MSG_SIZE, "InGameEndRoundMessage is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 + MAX_VARINT32 + MAX_VARINT32 <= MAX_READ_OVERRUN, "reading InGameEndRoundMessage can run too far past the end");
 void append(MessageBuilder *msg, InGameEndRoundMessage &in)
 {
+    msg->reserve(InGameEndRoundMessage::MAX_SIZE);
     append(msg, in.round_winner);
     append(msg, in.family0_score);
     append(msg, in.family1_score);
 }
-uint32_t read(MessageReader *msg, InGameEndRoundMessage *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, InGameEndRoundMessage *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->round_winner);
-    len += read(msg, &out->family0_score);
-    len += read(msg, &out->family1_score);
-    return len;
+    read(msg, &out->round_winner);
+    read(msg, &out->family0_score);
+    read(msg, &out->family1_score);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<InGameEndRoundMessage> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<InGameEndRoundMessage> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		InGameEndRoundMessage elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 struct InGameEndGameMessage 
 {
     int32_t game_winner = {};
+
+    // the most append() can write
+    static const uint32_t MAX_SIZE = MAX_VARINT32;
 };
+static_assert(InGameEndGameMessage::MAX_SIZE <= MAX_MSG_SIZE, "InGameEndGameMessage is over MAX_MSG_SIZE");
+static_assert(MAX_VARINT32 <= MAX_READ_OVERRUN, "reading InGameEndGameMessage can run too far past the end");
 void append(MessageBuilder *msg, InGameEndGameMessage &in)
 {
+    msg->reserve(InGameEndGameMessage::MAX_SIZE);
     append(msg, in.game_winner);
 }
-uint32_t read(MessageReader *msg, InGameEndGameMessage *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, InGameEndGameMessage *out)
 {
-    uint32_t len = 0;
-
-    len += read(msg, &out->game_winner);
-    return len;
+    read(msg, &out->game_winner);
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<InGameEndGameMessage> &in)
-{
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
-    {
-        append(msg, it);
-    }
-};
-uint32_t read(MessageReader *msg, std::vector<InGameEndGameMessage> *out)
-{
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
-    {
-		InGameEndGameMessage elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
 
 
 enum struct Rpc : char
 {
 	ListGames = 1,
+	SubscribeLobbies,
+	UnsubscribeLobbies,
 	GetGame,
 	CreateGame,
 	JoinGame,
@@ -1411,6 +1119,8 @@ enum struct Rpc : char
 	InGameAnswer,
 	InGameBuzz,
 	InGameChoosePassOrPlay,
+	GameStateAck,
+	LobbiesChanged,
 	GameStarted,
 	PlayerLeft,
 	GameStatePing,
@@ -5,7 +5,19 @@
 
 struct RpcClient : public BaseRpcClient
 {
-    using BaseRpcClient::BaseRpcClient;
+    RpcClient() = default;
+    RpcClient(const char *address, uint16_t port) : BaseRpcClient(address, port) { hello(); }
+    void connect(const char *address, uint16_t port)
+    {
+        BaseRpcClient::connect(address, port);
+        hello();
+    }
+    void hello()
+    {
+        MessageBuilder out;
+        append_hello(&out);
+        out.send(&peer);
+    }
     bool handle_rpc(char*, int);
 
     bool msg_received();
@@ -14,6 +26,10 @@ struct RpcClient : public BaseRpcClient
 
     void ListGames(ListGamesRequest);
 
+    void SubscribeLobbies(SubscribeLobbiesRequest);
+
+    void UnsubscribeLobbies(Empty);
+
     void GetGame(GetGameRequest);
 
     void CreateGame(CreateGameRequest);
@@ -34,6 +50,8 @@ struct RpcClient : public BaseRpcClient
 
     void InGameChoosePassOrPlay(InGameChoosePassOrPlayMessage);
 
+    void GameStateAck(GameStateAckMessage);
+
 
 
     ListGamesResponse *get_ListGames_msg();
@@ -80,6 +98,10 @@ struct RpcClient : public BaseRpcClient
     bool got_InGameChoosePassOrPlay_msg = false;
     Empty InGameChoosePassOrPlay_msg;
 
+    LobbiesChangedMessage *get_LobbiesChanged_msg();
+    bool got_LobbiesChanged_msg = false;
+    LobbiesChangedMessage LobbiesChanged_msg;
+
     GameStartedMessage *get_GameStarted_msg();
     bool got_GameStarted_msg = false;
     GameStartedMessage GameStarted_msg;
@@ -164,203 +186,210 @@ bool RpcClient::handle_rpc(char *data, int msg_len)
         case Rpc::ListGames:
         {
             ListGames_msg = {};
-            read(&in, &ListGames_msg);
+            if (!read(&in, &ListGames_msg)) return false;
             got_ListGames_msg = true;
         }
         break;
         case Rpc::GetGame:
         {
             GetGame_msg = {};
-            read(&in, &GetGame_msg);
+            if (!read(&in, &GetGame_msg)) return false;
             got_GetGame_msg = true;
         }
         break;
         case Rpc::CreateGame:
         {
             CreateGame_msg = {};
-            read(&in, &CreateGame_msg);
+            if (!read(&in, &CreateGame_msg)) return false;
             got_CreateGame_msg = true;
         }
         break;
         case Rpc::JoinGame:
         {
             JoinGame_msg = {};
-            read(&in, &JoinGame_msg);
+            if (!read(&in, &JoinGame_msg)) return false;
             got_JoinGame_msg = true;
         }
         break;
         case Rpc::SwapTeam:
         {
             SwapTeam_msg = {};
-            read(&in, &SwapTeam_msg);
+            if (!read(&in, &SwapTeam_msg)) return false;
             got_SwapTeam_msg = true;
         }
         break;
         case Rpc::LeaveGame:
         {
             LeaveGame_msg = {};
-            read(&in, &LeaveGame_msg);
+            if (!read(&in, &LeaveGame_msg)) return false;
             got_LeaveGame_msg = true;
         }
         break;
         case Rpc::StartGame:
         {
             StartGame_msg = {};
-            read(&in, &StartGame_msg);
+            if (!read(&in, &StartGame_msg)) return false;
             got_StartGame_msg = true;
         }
         break;
         case Rpc::InGameReady:
         {
             InGameReady_msg = {};
-            read(&in, &InGameReady_msg);
+            if (!read(&in, &InGameReady_msg)) return false;
             got_InGameReady_msg = true;
         }
         break;
         case Rpc::InGameAnswer:
         {
             InGameAnswer_msg = {};
-            read(&in, &InGameAnswer_msg);
+            if (!read(&in, &InGameAnswer_msg)) return false;
             got_InGameAnswer_msg = true;
         }
         break;
         case Rpc::InGameBuzz:
         {
             InGameBuzz_msg = {};
-            read(&in, &InGameBuzz_msg);
+            if (!read(&in, &InGameBuzz_msg)) return false;
             got_InGameBuzz_msg = true;
         }
         break;
         case Rpc::InGameChoosePassOrPlay:
         {
             InGameChoosePassOrPlay_msg = {};
-            read(&in, &InGameChoosePassOrPlay_msg);
+            if (!read(&in, &InGameChoosePassOrPlay_msg)) return false;
             got_InGameChoosePassOrPlay_msg = true;
         }
         break;
+        case Rpc::LobbiesChanged:
+        {
+            LobbiesChanged_msg = {};
+            if (!read(&in, &LobbiesChanged_msg)) return false;
+            got_LobbiesChanged_msg = true;
+        }
+        break;
         case Rpc::GameStarted:
         {
             GameStarted_msg = {};
-            read(&in, &GameStarted_msg);
+            if (!read(&in, &GameStarted_msg)) return false;
             got_GameStarted_msg = true;
         }
         break;
         case Rpc::PlayerLeft:
         {
             PlayerLeft_msg = {};
-            read(&in, &PlayerLeft_msg);
+            if (!read(&in, &PlayerLeft_msg)) return false;
             got_PlayerLeft_msg = true;
         }
         break;
         case Rpc::GameStatePing:
         {
             GameStatePing_msg = {};
-            read(&in, &GameStatePing_msg);
+            if (!read(&in, &GameStatePing_msg)) return false;
             got_GameStatePing_msg = true;
         }
         break;
         case Rpc::InGameStartRound:
         {
             InGameStartRound_msg = {};
-            read(&in, &InGameStartRound_msg);
+            if (!read(&in, &InGameStartRound_msg)) return false;
             got_InGameStartRound_msg = true;
         }
         break;
         case Rpc::InGameStartFaceoff:
         {
             InGameStartFaceoff_msg = {};
-            read(&in, &InGameStartFaceoff_msg);
+            if (!read(&in, &InGameStartFaceoff_msg)) return false;
             got_InGameStartFaceoff_msg = true;
         }
         break;
         case Rpc::InGameAskQuestion:
         {
             InGameAskQuestion_msg = {};
-            read(&in, &InGameAskQuestion_msg);
+            if (!read(&in, &InGameAskQuestion_msg)) return false;
             got_InGameAskQuestion_msg = true;
         }
         break;
         case Rpc::InGamePromptPassOrPlay:
         {
             InGamePromptPassOrPlay_msg = {};
-            read(&in, &InGamePromptPassOrPlay_msg);
+            if (!read(&in, &InGamePromptPassOrPlay_msg)) return false;
             got_InGamePromptPassOrPlay_msg = true;
         }
         break;
         case Rpc::InGamePlayerBuzzed:
         {
             InGamePlayerBuzzed_msg = {};
-            read(&in, &InGamePlayerBuzzed_msg);
+            if (!read(&in, &InGamePlayerBuzzed_msg)) return false;
             got_InGamePlayerBuzzed_msg = true;
         }
         break;
         case Rpc::InGamePrepForPromptForAnswer:
         {
             InGamePrepForPromptForAnswer_msg = {};
-            read(&in, &InGamePrepForPromptForAnswer_msg);
+            if (!read(&in, &InGamePrepForPromptForAnswer_msg)) return false;
             got_InGamePrepForPromptForAnswer_msg = true;
         }
         break;
         case Rpc::InGamePromptForAnswer:
         {
             InGamePromptForAnswer_msg = {};
-            read(&in, &InGamePromptForAnswer_msg);
+            if (!read(&in, &InGamePromptForAnswer_msg)) return false;
             got_InGamePromptForAnswer_msg = true;
         }
         break;
         case Rpc::InGameStartPlay:
         {
             InGameStartPlay_msg = {};
-            read(&in, &InGameStartPlay_msg);
+            if (!read(&in, &InGameStartPlay_msg)) return false;
             got_InGameStartPlay_msg = true;
         }
         break;
         case Rpc::InGameStartSteal:
         {
             InGameStartSteal_msg = {};
-            read(&in, &InGameStartSteal_msg);
+            if (!read(&in, &InGameStartSteal_msg)) return false;
             got_InGameStartSteal_msg = true;
         }
         break;
         case Rpc::InGamePlayerChosePassOrPlay:
         {
             InGamePlayerChosePassOrPlay_msg = {};
-            read(&in, &InGamePlayerChosePassOrPlay_msg);
+            if (!read(&in, &InGamePlayerChosePassOrPlay_msg)) return false;
             got_InGamePlayerChosePassOrPlay_msg = true;
         }
         break;
         case Rpc::InGamePlayerAnswered:
         {
             InGamePlayerAnswered_msg = {};
-            read(&in, &InGamePlayerAnswered_msg);
+            if (!read(&in, &InGamePlayerAnswered_msg)) return false;
             got_InGamePlayerAnswered_msg = true;
         }
         break;
         case Rpc::InGameFlipAnswer:
         {
             InGameFlipAnswer_msg = {};
-            read(&in, &InGameFlipAnswer_msg);
+            if (!read(&in, &InGameFlipAnswer_msg)) return false;
             got_InGameFlipAnswer_msg = true;
         }
         break;
         case Rpc::InGameEggghhhh:
         {
             InGameEggghhhh_msg = {};
-            read(&in, &InGameEggghhhh_msg);
+            if (!read(&in, &InGameEggghhhh_msg)) return false;
             got_InGameEggghhhh_msg = true;
         }
         break;
         case Rpc::InGameEndRound:
         {
             InGameEndRound_msg = {};
-            read(&in, &InGameEndRound_msg);
+            if (!read(&in, &InGameEndRound_msg)) return false;
             got_InGameEndRound_msg = true;
         }
         break;
         case Rpc::InGameEndGame:
         {
             InGameEndGame_msg = {};
-            read(&in, &InGameEndGame_msg);
+            if (!read(&in, &InGameEndGame_msg)) return false;
             got_InGameEndGame_msg = true;
         }
         break;
@@ -395,6 +424,8 @@ bool RpcClient::msg_received() {
 
     if (got_InGameChoosePassOrPlay_msg) return true;
 
+    if (got_LobbiesChanged_msg) return true;
+
     if (got_GameStarted_msg) return true;
 
     if (got_PlayerLeft_msg) return true;
@@ -459,6 +490,8 @@ void RpcClient::clear_msgs() {
 
     got_InGameChoosePassOrPlay_msg = false;
 
+    got_LobbiesChanged_msg = false;
+
     got_GameStarted_msg = false;
 
     got_PlayerLeft_msg = false;
@@ -505,6 +538,20 @@ void RpcClient::ListGames(ListGamesRequest req)
     append(&out, req); out.send(&peer);
 }
 
+void RpcClient::SubscribeLobbies(SubscribeLobbiesRequest req)
+{
+    MessageBuilder out;
+    append(&out, (char) Rpc::SubscribeLobbies);
+    append(&out, req); out.send(&peer);
+}
+
+void RpcClient::UnsubscribeLobbies(Empty req)
+{
+    MessageBuilder out;
+    append(&out, (char) Rpc::UnsubscribeLobbies);
+    append(&out, req); out.send(&peer);
+}
+
 void RpcClient::GetGame(GetGameRequest req)
 {
     MessageBuilder out;
@@ -575,6 +622,13 @@ void RpcClient::InGameChoosePassOrPlay(InGameChoosePassOrPlayMessage req)
     append(&out, req); out.send(&peer);
 }
 
+void RpcClient::GameStateAck(GameStateAckMessage req)
+{
+    MessageBuilder out;
+    append(&out, (char) Rpc::GameStateAck);
+    append(&out, req); out.send(&peer);
+}
+
 
 
 ListGamesResponse *RpcClient::get_ListGames_msg()
@@ -654,6 +708,13 @@ Empty *RpcClient::get_InGameChoosePassOrPlay_msg()
     return msg;
 }
 
+LobbiesChangedMessage *RpcClient::get_LobbiesChanged_msg()
+{
+    auto msg = got_LobbiesChanged_msg ? &LobbiesChanged_msg : nullptr;
+    got_LobbiesChanged_msg = false;
+    return msg;
+}
+
 GameStartedMessage *RpcClient::get_GameStarted_msg()
 {
     auto msg = got_GameStarted_msg ? &GameStarted_msg : nullptr;
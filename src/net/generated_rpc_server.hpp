@@ -1,15 +1,19 @@
 
 #pragma once
 
+#include <new>
+
 #include "base_rpc.hpp"
 #include "generated_messages.hpp"
 
 struct RpcServer : public BaseRpcServer
 {
     using BaseRpcServer::BaseRpcServer;
-    void handle_rpc(ClientId, Peer*, char*, int);
+    bool handle_rpc(ClientId, Peer*, char*, int);
 
     void HandleListGames(ClientId client_id, ListGamesRequest*, ListGamesResponse*);
+    void HandleSubscribeLobbies(ClientId client_id, SubscribeLobbiesRequest*);
+    void HandleUnsubscribeLobbies(ClientId client_id, Empty*);
     void HandleGetGame(ClientId client_id, GetGameRequest*, GetGameResponse*);
     void HandleCreateGame(ClientId client_id, CreateGameRequest*, CreateGameResponse*);
     void HandleJoinGame(ClientId client_id, JoinGameRequest*, JoinGameResponse*);
@@ -20,70 +24,128 @@ struct RpcServer : public BaseRpcServer
     void HandleInGameAnswer(ClientId client_id, InGameAnswerMessage*, Empty*);
     void HandleInGameBuzz(ClientId client_id, Empty*, Empty*);
     void HandleInGameChoosePassOrPlay(ClientId client_id, InGameChoosePassOrPlayMessage*, Empty*);
+    void HandleGameStateAck(ClientId client_id, GameStateAckMessage*);
+
 
+    void LobbiesChanged(Peer *, LobbiesChangedMessage);
+    void LobbiesChanged(Broadcaster, LobbiesChangedMessage);
 
     void GameStarted(Peer *, GameStartedMessage);
+    void GameStarted(Broadcaster, GameStartedMessage);
 
     void PlayerLeft(Peer *, PlayerLeftMessage);
+    void PlayerLeft(Broadcaster, PlayerLeftMessage);
 
     void GameStatePing(Peer *, GameStatePingMessage);
+    void GameStatePing(Broadcaster, GameStatePingMessage);
 
     void InGameStartRound(Peer *, InGameStartRoundMessage);
+    void InGameStartRound(Broadcaster, InGameStartRoundMessage);
 
     void InGameStartFaceoff(Peer *, InGameStartFaceoffMessage);
+    void InGameStartFaceoff(Broadcaster, InGameStartFaceoffMessage);
 
     void InGameAskQuestion(Peer *, InGameAskQuestionMessage);
+    void InGameAskQuestion(Broadcaster, InGameAskQuestionMessage);
 
     void InGamePromptPassOrPlay(Peer *, Empty);
+    void InGamePromptPassOrPlay(Broadcaster, Empty);
 
     void InGamePlayerBuzzed(Peer *, InGamePlayerBuzzedMessage);
+    void InGamePlayerBuzzed(Broadcaster, InGamePlayerBuzzedMessage);
 
     void InGamePrepForPromptForAnswer(Peer *, InGamePrepForPromptForAnswerMessage);
+    void InGamePrepForPromptForAnswer(Broadcaster, InGamePrepForPromptForAnswerMessage);
 
     void InGamePromptForAnswer(Peer *, InGamePromptForAnswerMessage);
+    void InGamePromptForAnswer(Broadcaster, InGamePromptForAnswerMessage);
 
     void InGameStartPlay(Peer *, InGameStartPlayMessage);
+    void InGameStartPlay(Broadcaster, InGameStartPlayMessage);
 
     void InGameStartSteal(Peer *, InGameStartStealMessage);
+    void InGameStartSteal(Broadcaster, InGameStartStealMessage);
 
     void InGamePlayerChosePassOrPlay(Peer *, InGameChoosePassOrPlayMessage);
+    void InGamePlayerChosePassOrPlay(Broadcaster, InGameChoosePassOrPlayMessage);
 
     void InGamePlayerAnswered(Peer *, InGameAnswerMessage);
+    void InGamePlayerAnswered(Broadcaster, InGameAnswerMessage);
 
     void InGameFlipAnswer(Peer *, InGameFlipAnswerMessage);
+    void InGameFlipAnswer(Broadcaster, InGameFlipAnswerMessage);
 
     void InGameEggghhhh(Peer *, InGameEggghhhhMessage);
+    void InGameEggghhhh(Broadcaster, InGameEggghhhhMessage);
 
     void InGameEndRound(Peer *, InGameEndRoundMessage);
+    void InGameEndRound(Broadcaster, InGameEndRoundMessage);
 
     void InGameEndGame(Peer *, InGameEndGameMessage);
+    void InGameEndGame(Broadcaster, InGameEndGameMessage);
+
 
+    // responses with lists are too big for the stack, they're rebuilt in place here instead
+    ListGamesResponse ListGames_resp;
+    GetGameResponse GetGame_resp;
 };
 
-void RpcServer::handle_rpc(ClientId client_id, Peer *peer, char *data, int msg_len)
+// false if the message was malformed, the peer should be dropped
+bool RpcServer::handle_rpc(ClientId client_id, Peer *peer, char *data, int msg_len)
 {
     Rpc rpc_type;
     data = read_byte(data, (char *)&rpc_type);
     MessageReader in(data, msg_len - 1);
-    MessageBuilder out;
     switch(rpc_type) {
     case Rpc::ListGames:
     {
         ListGamesRequest req;
-        ListGamesResponse resp;
-        read(&in, &req);
+        ListGamesResponse &resp = *new (&ListGames_resp) ListGamesResponse();
+        if (!read(&in, &req))
+        {
+            printf("Dropping peer, malformed ListGames\n");
+            return false;
+        }
         HandleListGames(client_id, &req, &resp);
+        MessageBuilder out;
         append(&out, (char)Rpc::ListGames);
         append(&out, resp);
         out.send(peer);
     }
     break;
+    case Rpc::SubscribeLobbies:
+    {
+        SubscribeLobbiesRequest req;
+        if (!read(&in, &req))
+        {
+            printf("Dropping peer, malformed SubscribeLobbies\n");
+            return false;
+        }
+        HandleSubscribeLobbies(client_id, &req);
+    }
+    break;
+    case Rpc::UnsubscribeLobbies:
+    {
+        Empty req;
+        if (!read(&in, &req))
+        {
+            printf("Dropping peer, malformed UnsubscribeLobbies\n");
+            return false;
+        }
+        HandleUnsubscribeLobbies(client_id, &req);
+    }
+    break;
     case Rpc::GetGame:
     {
         GetGameRequest req;
-        GetGameResponse resp;
-        read(&in, &req);
+        GetGameResponse &resp = *new (&GetGame_resp) GetGameResponse();
+        if (!read(&in, &req))
+        {
+            printf("Dropping peer, malformed GetGame\n");
+            return false;
+        }
         HandleGetGame(client_id, &req, &resp);
+        MessageBuilder out;
         append(&out, (char)Rpc::GetGame);
         append(&out, resp);
         out.send(peer);
@@ -93,8 +155,13 @@ void RpcServer::handle_rpc(ClientId client_id, Peer *peer, char *data, int msg_l
     {
         CreateGameRequest req;
         CreateGameResponse resp;
-        read(&in, &req);
+        if (!read(&in, &req))
+        {
+            printf("Dropping peer, malformed CreateGame\n");
+            return false;
+        }
         HandleCreateGame(client_id, &req, &resp);
+        MessageBuilder out;
         append(&out, (char)Rpc::CreateGame);
         append(&out, resp);
         out.send(peer);
@@ -104,8 +171,13 @@ void RpcServer::handle_rpc(ClientId client_id, Peer *peer, char *data, int msg_l
     {
         JoinGameRequest req;
         JoinGameResponse resp;
-        read(&in, &req);
+        if (!read(&in, &req))
+        {
+            printf("Dropping peer, malformed JoinGame\n");
+            return false;
+        }
         HandleJoinGame(client_id, &req, &resp);
+        MessageBuilder out;
         append(&out, (char)Rpc::JoinGame);
         append(&out, resp);
         out.send(peer);
@@ -115,8 +187,13 @@ void RpcServer::handle_rpc(ClientId client_id, Peer *peer, char *data, int msg_l
     {
         SwapTeamRequest req;
         Empty resp;
-        read(&in, &req);
+        if (!read(&in, &req))
+        {
+            printf("Dropping peer, malformed SwapTeam\n");
+            return false;
+        }
         HandleSwapTeam(client_id, &req, &resp);
+        MessageBuilder out;
         append(&out, (char)Rpc::SwapTeam);
         append(&out, resp);
         out.send(peer);
@@ -126,8 +203,13 @@ void RpcServer::handle_rpc(ClientId client_id, Peer *peer, char *data, int msg_l
     {
         LeaveGameRequest req;
         LeaveGameResponse resp;
-        read(&in, &req);
+        if (!read(&in, &req))
+        {
+            printf("Dropping peer, malformed LeaveGame\n");
+            return false;
+        }
         HandleLeaveGame(client_id, &req, &resp);
+        MessageBuilder out;
         append(&out, (char)Rpc::LeaveGame);
         append(&out, resp);
         out.send(peer);
@@ -137,8 +219,13 @@ void RpcServer::handle_rpc(ClientId client_id, Peer *peer, char *data, int msg_l
     {
         StartGameRequest req;
         StartGameResponse resp;
-        read(&in, &req);
+        if (!read(&in, &req))
+        {
+            printf("Dropping peer, malformed StartGame\n");
+            return false;
+        }
         HandleStartGame(client_id, &req, &resp);
+        MessageBuilder out;
         append(&out, (char)Rpc::StartGame);
         append(&out, resp);
         out.send(peer);
@@ -148,8 +235,13 @@ void RpcServer::handle_rpc(ClientId client_id, Peer *peer, char *data, int msg_l
     {
         Empty req;
         Empty resp;
-        read(&in, &req);
+        if (!read(&in, &req))
+        {
+            printf("Dropping peer, malformed InGameReady\n");
+            return false;
+        }
         HandleInGameReady(client_id, &req, &resp);
+        MessageBuilder out;
         append(&out, (char)Rpc::InGameReady);
         append(&out, resp);
         out.send(peer);
@@ -159,8 +251,13 @@ void RpcServer::handle_rpc(ClientId client_id, Peer *peer, char *data, int msg_l
     {
         InGameAnswerMessage req;
         Empty resp;
-        read(&in, &req);
+        if (!read(&in, &req))
+        {
+            printf("Dropping peer, malformed InGameAnswer\n");
+            return false;
+        }
         HandleInGameAnswer(client_id, &req, &resp);
+        MessageBuilder out;
         append(&out, (char)Rpc::InGameAnswer);
         append(&out, resp);
         out.send(peer);
@@ -170,8 +267,13 @@ void RpcServer::handle_rpc(ClientId client_id, Peer *peer, char *data, int msg_l
     {
         Empty req;
         Empty resp;
-        read(&in, &req);
+        if (!read(&in, &req))
+        {
+            printf("Dropping peer, malformed InGameBuzz\n");
+            return false;
+        }
         HandleInGameBuzz(client_id, &req, &resp);
+        MessageBuilder out;
         append(&out, (char)Rpc::InGameBuzz);
         append(&out, resp);
         out.send(peer);
@@ -181,16 +283,48 @@ void RpcServer::handle_rpc(ClientId client_id, Peer *peer, char *data, int msg_l
     {
         InGameChoosePassOrPlayMessage req;
         Empty resp;
-        read(&in, &req);
+        if (!read(&in, &req))
+        {
+            printf("Dropping peer, malformed InGameChoosePassOrPlay\n");
+            return false;
+        }
         HandleInGameChoosePassOrPlay(client_id, &req, &resp);
+        MessageBuilder out;
         append(&out, (char)Rpc::InGameChoosePassOrPlay);
         append(&out, resp);
         out.send(peer);
     }
     break;
+    case Rpc::GameStateAck:
+    {
+        GameStateAckMessage req;
+        if (!read(&in, &req))
+        {
+            printf("Dropping peer, malformed GameStateAck\n");
+            return false;
+        }
+        HandleGameStateAck(client_id, &req);
+    }
+    break;
     default:
-        assert(false);
+        printf("Dropping peer, unknown rpc %d\n", (int)rpc_type);
+        return false;
     }
+    return true;
+}
+
+
+void RpcServer::LobbiesChanged(Peer *peer, LobbiesChangedMessage req)
+{
+    MessageBuilder out;
+    append(&out, (char) Rpc::LobbiesChanged);
+    append(&out, req); out.send(peer);
+}
+void RpcServer::LobbiesChanged(Broadcaster broadcaster, LobbiesChangedMessage req)
+{
+    MessageBuilder out;
+    append(&out, (char) Rpc::LobbiesChanged);
+    append(&out, req); broadcaster.send(&out);
 }
 
 
@@ -200,6 +334,12 @@ void RpcServer::GameStarted(Peer *peer, GameStartedMessage req)
     append(&out, (char) Rpc::GameStarted);
     append(&out, req); out.send(peer);
 }
+void RpcServer::GameStarted(Broadcaster broadcaster, GameStartedMessage req)
+{
+    MessageBuilder out;
+    append(&out, (char) Rpc::GameStarted);
+    append(&out, req); broadcaster.send(&out);
+}
 
 
 void RpcServer::PlayerLeft(Peer *peer, PlayerLeftMessage req)
@@ -208,6 +348,12 @@ void RpcServer::PlayerLeft(Peer *peer, PlayerLeftMessage req)
     append(&out, (char) Rpc::PlayerLeft);
     append(&out, req); out.send(peer);
 }
+void RpcServer::PlayerLeft(Broadcaster broadcaster, PlayerLeftMessage req)
+{
+    MessageBuilder out;
+    append(&out, (char) Rpc::PlayerLeft);
+    append(&out, req); broadcaster.send(&out);
+}
 
 
 void RpcServer::GameStatePing(Peer *peer, GameStatePingMessage req)
@@ -216,6 +362,12 @@ void RpcServer::GameStatePing(Peer *peer, GameStatePingMessage req)
     append(&out, (char) Rpc::GameStatePing);
     append(&out, req); out.send(peer);
 }
+void RpcServer::GameStatePing(Broadcaster broadcaster, GameStatePingMessage req)
+{
+    MessageBuilder out;
+    append(&out, (char) Rpc::GameStatePing);
+    append(&out, req); broadcaster.send(&out);
+}
 
 
 void RpcServer::InGameStartRound(Peer *peer, InGameStartRoundMessage req)
@@ -224,6 +376,12 @@ void RpcServer::InGameStartRound(Peer *peer, InGameStartRoundMessage req)
     append(&out, (char) Rpc::InGameStartRound);
     append(&out, req); out.send(peer);
 }
+void RpcServer::InGameStartRound(Broadcaster broadcaster, InGameStartRoundMessage req)
+{
+    MessageBuilder out;
+    append(&out, (char) Rpc::InGameStartRound);
+    append(&out, req); broadcaster.send(&out);
+}
 
 
 void RpcServer::InGameStartFaceoff(Peer *peer, InGameStartFaceoffMessage req)
@@ -232,6 +390,12 @@ void RpcServer::InGameStartFaceoff(Peer *peer, InGameStartFaceoffMessage req)
     append(&out, (char) Rpc::InGameStartFaceoff);
     append(&out, req); out.send(peer);
 }
+void RpcServer::InGameStartFaceoff(Broadcaster broadcaster, InGameStartFaceoffMessage req)
+{
+    MessageBuilder out;
+    append(&out, (char) Rpc::InGameStartFaceoff);
+    append(&out, req); broadcaster.send(&out);
+}
 
 
 void RpcServer::InGameAskQuestion(Peer *peer, InGameAskQuestionMessage req)
@@ -240,6 +404,12 @@ void RpcServer::InGameAskQuestion(Peer *peer, InGameAskQuestionMessage req)
     append(&out, (char) Rpc::InGameAskQuestion);
     append(&out, req); out.send(peer);
 }
+void RpcServer::InGameAskQuestion(Broadcaster broadcaster, InGameAskQuestionMessage req)
+{
+    MessageBuilder out;
+    append(&out, (char) Rpc::InGameAskQuestion);
+    append(&out, req); broadcaster.send(&out);
+}
 
 
 void RpcServer::InGamePromptPassOrPlay(Peer *peer, Empty req)
@@ -248,6 +418,12 @@ void RpcServer::InGamePromptPassOrPlay(Peer *peer, Empty req)
     append(&out, (char) Rpc::InGamePromptPassOrPlay);
     append(&out, req); out.send(peer);
 }
+void RpcServer::InGamePromptPassOrPlay(Broadcaster broadcaster, Empty req)
+{
+    MessageBuilder out;
+    append(&out, (char) Rpc::InGamePromptPassOrPlay);
+    append(&out, req); broadcaster.send(&out);
+}
 
 
 void RpcServer::InGamePlayerBuzzed(Peer *peer, InGamePlayerBuzzedMessage req)
@@ -256,6 +432,12 @@ void RpcServer::InGamePlayerBuzzed(Peer *peer, InGamePlayerBuzzedMessage req)
     append(&out, (char) Rpc::InGamePlayerBuzzed);
     append(&out, req); out.send(peer);
 }
+void RpcServer::InGamePlayerBuzzed(Broadcaster broadcaster, InGamePlayerBuzzedMessage req)
+{
+    MessageBuilder out;
+    append(&out, (char) Rpc::InGamePlayerBuzzed);
+    append(&out, req); broadcaster.send(&out);
+}
 
 
 void RpcServer::InGamePrepForPromptForAnswer(Peer *peer, InGamePrepForPromptForAnswerMessage req)
@@ -264,6 +446,12 @@ void RpcServer::InGamePrepForPromptForAnswer(Peer *peer, InGamePrepForPromptForA
     append(&out, (char) Rpc::InGamePrepForPromptForAnswer);
     append(&out, req); out.send(peer);
 }
+void RpcServer::InGamePrepForPromptForAnswer(Broadcaster broadcaster, InGamePrepForPromptForAnswerMessage req)
+{
+    MessageBuilder out;
+    append(&out, (char) Rpc::InGamePrepForPromptForAnswer);
+    append(&out, req); broadcaster.send(&out);
+}
 
 
 void RpcServer::InGamePromptForAnswer(Peer *peer, InGamePromptForAnswerMessage req)
@@ -272,6 +460,12 @@ void RpcServer::InGamePromptForAnswer(Peer *peer, InGamePromptForAnswerMessage r
     append(&out, (char) Rpc::InGamePromptForAnswer);
     append(&out, req); out.send(peer);
 }
+void RpcServer::InGamePromptForAnswer(Broadcaster broadcaster, InGamePromptForAnswerMessage req)
+{
+    MessageBuilder out;
+    append(&out, (char) Rpc::InGamePromptForAnswer);
+    append(&out, req); broadcaster.send(&out);
+}
 
 
 void RpcServer::InGameStartPlay(Peer *peer, InGameStartPlayMessage req)
@@ -280,6 +474,12 @@ void RpcServer::InGameStartPlay(Peer *peer, InGameStartPlayMessage req)
     append(&out, (char) Rpc::InGameStartPlay);
     append(&out, req); out.send(peer);
 }
+void RpcServer::InGameStartPlay(Broadcaster broadcaster, InGameStartPlayMessage req)
+{
+    MessageBuilder out;
+    append(&out, (char) Rpc::InGameStartPlay);
+    append(&out, req); broadcaster.send(&out);
+}
 
 
 void RpcServer::InGameStartSteal(Peer *peer, InGameStartStealMessage req)
@@ -288,6 +488,12 @@ void RpcServer::InGameStartSteal(Peer *peer, InGameStartStealMessage req)
     append(&out, (char) Rpc::InGameStartSteal);
     append(&out, req); out.send(peer);
 }
+void RpcServer::InGameStartSteal(Broadcaster broadcaster, InGameStartStealMessage req)
+{
+    MessageBuilder out;
+    append(&out, (char) Rpc::InGameStartSteal);
+    append(&out, req); broadcaster.send(&out);
+}
 
 
 void RpcServer::InGamePlayerChosePassOrPlay(Peer *peer, InGameChoosePassOrPlayMessage req)
@@ -296,6 +502,12 @@ void RpcServer::InGamePlayerChosePassOrPlay(Peer *peer, InGameChoosePassOrPlayMe
     append(&out, (char) Rpc::InGamePlayerChosePassOrPlay);
     append(&out, req); out.send(peer);
 }
+void RpcServer::InGamePlayerChosePassOrPlay(Broadcaster broadcaster, InGameChoosePassOrPlayMessage req)
+{
+    MessageBuilder out;
+    append(&out, (char) Rpc::InGamePlayerChosePassOrPlay);
+    append(&out, req); broadcaster.send(&out);
+}
 
 
 void RpcServer::InGamePlayerAnswered(Peer *peer, InGameAnswerMessage req)
@@ -304,6 +516,12 @@ void RpcServer::InGamePlayerAnswered(Peer *peer, InGameAnswerMessage req)
     append(&out, (char) Rpc::InGamePlayerAnswered);
     append(&out, req); out.send(peer);
 }
+void RpcServer::InGamePlayerAnswered(Broadcaster broadcaster, InGameAnswerMessage req)
+{
+    MessageBuilder out;
+    append(&out, (char) Rpc::InGamePlayerAnswered);
+    append(&out, req); broadcaster.send(&out);
+}
 
 
 void RpcServer::InGameFlipAnswer(Peer *peer, InGameFlipAnswerMessage req)
@@ -312,6 +530,12 @@ void RpcServer::InGameFlipAnswer(Peer *peer, InGameFlipAnswerMessage req)
     append(&out, (char) Rpc::InGameFlipAnswer);
     append(&out, req); out.send(peer);
 }
+void RpcServer::InGameFlipAnswer(Broadcaster broadcaster, InGameFlipAnswerMessage req)
+{
+    MessageBuilder out;
+    append(&out, (char) Rpc::InGameFlipAnswer);
+    append(&out, req); broadcaster.send(&out);
+}
 
 
 void RpcServer::InGameEggghhhh(Peer *peer, InGameEggghhhhMessage req)
@@ -320,6 +544,12 @@ void RpcServer::InGameEggghhhh(Peer *peer, InGameEggghhhhMessage req)
     append(&out, (char) Rpc::InGameEggghhhh);
     append(&out, req); out.send(peer);
 }
+void RpcServer::InGameEggghhhh(Broadcaster broadcaster, InGameEggghhhhMessage req)
+{
+    MessageBuilder out;
+    append(&out, (char) Rpc::InGameEggghhhh);
+    append(&out, req); broadcaster.send(&out);
+}
 
 
 void RpcServer::InGameEndRound(Peer *peer, InGameEndRoundMessage req)
@@ -328,6 +558,12 @@ void RpcServer::InGameEndRound(Peer *peer, InGameEndRoundMessage req)
     append(&out, (char) Rpc::InGameEndRound);
     append(&out, req); out.send(peer);
 }
+void RpcServer::InGameEndRound(Broadcaster broadcaster, InGameEndRoundMessage req)
+{
+    MessageBuilder out;
+    append(&out, (char) Rpc::InGameEndRound);
+    append(&out, req); broadcaster.send(&out);
+}
 
 
 void RpcServer::InGameEndGame(Peer *peer, InGameEndGameMessage req)
@@ -336,4 +572,10 @@ void RpcServer::InGameEndGame(Peer *peer, InGameEndGameMessage req)
     append(&out, (char) Rpc::InGameEndGame);
     append(&out, req); out.send(peer);
 }
+void RpcServer::InGameEndGame(Broadcaster broadcaster, InGameEndGameMessage req)
+{
+    MessageBuilder out;
+    append(&out, (char) Rpc::InGameEndGame);
+    append(&out, req); broadcaster.send(&out);
+}
 
@@ -1,7 +1,7 @@
 #include <stdint.h>
 
 #include "net.hpp"
-#include "net_windows.hpp"
+#include "peer.hpp"
 
 char *append_byte(char *buf, char val)
 {
@@ -100,208 +100,219 @@ char *read_string_inplace(char *buf, char **val, uint16_t *len)
   return buf + *len;
 }
 
+// the frame length header goes in front of the message once its length is known
 MessageBuilder::MessageBuilder()
 {
-  // skip space for size
-  data = data_buf + sizeof(uint16_t);
+  buf  = send_buffers.acquire();
+  data = buf->data + sizeof(uint16_t);
 }
-MessageBuilder::MessageBuilder(char header_type)
+MessageBuilder::MessageBuilder(char header_type) : MessageBuilder() { append(this, header_type); }
+MessageBuilder::~MessageBuilder()
 {
-  // skip space for size and add header type
-  data = data_buf + sizeof(uint16_t);
-  append(this, header_type);
+  if (buf) send_buffers.release(buf);
+}
+void MessageBuilder::reset()
+{
+  if (!buf) buf = send_buffers.acquire();
+  data = buf->data + sizeof(uint16_t);
 }
-void MessageBuilder::reset() { data = data_buf + sizeof(uint16_t); }
 void MessageBuilder::reset(char header_type)
 {
-  data = data_buf + sizeof(uint16_t);
+  reset();
   append(this, header_type);
 }
-uint16_t MessageBuilder::get_len() { return data - data_buf; }
+void MessageBuilder::grow(uint32_t bytes)
+{
+  uint32_t used  = data - buf->data;
+  SendBuffer *to = send_buffers.acquire(used + bytes);
+  memcpy(to->data, buf->data, used);
+  send_buffers.release(buf);
+  buf  = to;
+  data = to->data + used;
+}
+SendBuffer *MessageBuilder::finish()
+{
+  uint32_t len = get_len();
+  assert(len <= MAX_MSG_SIZE);
+
+  // the common case, a single frame written in place
+  if (len + sizeof(uint16_t) <= MAX_FRAME_SIZE) {
+    append_short(buf->data, len + sizeof(uint16_t));
+    buf->len        = len + sizeof(uint16_t);
+    SendBuffer *out = buf;
+    buf             = nullptr;
+    data            = nullptr;
+    return out;
+  }
+
+  // otherwise it's copied out a frame at a time, each behind its own header
+  const uint32_t PAYLOAD = MAX_FRAME_SIZE - sizeof(uint16_t);
+  uint32_t frames        = (len + PAYLOAD - 1) / PAYLOAD;
+  SendBuffer *out        = send_buffers.acquire(len + frames * sizeof(uint16_t));
+
+  char *from = buf->data + sizeof(uint16_t);
+  char *to   = out->data;
+  for (uint32_t left = len; left;) {
+    uint32_t chunk = std::min(left, PAYLOAD);
+    left -= chunk;
+    to = append_short(to, (chunk + sizeof(uint16_t)) | (left ? FRAME_MORE : 0));
+    memcpy(to, from, chunk);
+    to += chunk;
+    from += chunk;
+  }
+  out->len = to - out->data;
+
+  send_buffers.release(buf);
+  buf  = nullptr;
+  data = nullptr;
+  return out;
+}
 void MessageBuilder::send(Peer *peer)
 {
-  uint16_t len = get_len();
+  SendBuffer *buf = finish();
+  peer->queue(buf);
+  send_buffers.release(buf);
+
+  peer->flush();
+}
+
+thread_local SendBufferPool send_buffers;
+
+SendBuffer *SendBufferPool::acquire(uint32_t capacity)
+{
+  uint32_t size_class = 0;
+  while ((SMALLEST_SEND_BUFFER << (2 * size_class)) < capacity) size_class++;
+  assert(size_class < SEND_BUFFER_CLASSES);
+
+  SendBuffer *&free_list = free_lists[size_class];
+  if (!free_list) {
+    // grow a chunk at a time, buffers are never handed back to the system. a chunk is at least
+    // 64k, so the small classes come many to a malloc
+    uint32_t bytes       = SMALLEST_SEND_BUFFER << (2 * size_class);
+    uint32_t stride      = sizeof(SendBuffer) + bytes;
+    uint32_t chunk_count = std::max(1u, 64 * 1024 / bytes);
+    char *chunk          = (char *)malloc(chunk_count * stride);
+    for (uint32_t i = 0; i < chunk_count; i++) {
+      SendBuffer *buf = (SendBuffer *)(chunk + i * stride);
+      *buf            = {};
+      buf->capacity   = bytes;
+      buf->size_class = size_class;
+      buf->data       = (char *)(buf + 1);
+      buf->next_free  = free_list;
+      free_list       = buf;
+    }
+  }
 
-  uint16_t n_len = htons(len);
-  data_buf[0]    = n_len;
-  data_buf[1]    = n_len >> 8;
+  SendBuffer *buf = free_list;
+  free_list       = buf->next_free;
+  buf->next_free  = nullptr;
+  buf->refs       = 1;
+  buf->len        = 0;
+  return buf;
+}
 
-  peer->send_all(data_buf, len);
+void SendBufferPool::release(SendBuffer *buf)
+{
+  assert(buf->refs > 0);
+  if (--buf->refs == 0) {
+    buf->next_free              = free_lists[buf->size_class];
+    free_lists[buf->size_class] = buf;
+  }
 }
 
 void append(MessageBuilder *msg, char val) { *(msg->data++) = val; }
 
 void append(MessageBuilder *msg, uint8_t val) { *(msg->data++) = val; }
 
-void append(MessageBuilder *msg, bool val)
-{
-  uint8_t n_val  = (uint8_t)val;
-  *(msg->data++) = n_val;
-}
-void append(MessageBuilder *msg, uint16_t val)
-{
-  uint16_t n_val = htons(val);
-  *(msg->data++) = n_val;
-  *(msg->data++) = n_val >> 8;
-}
-void append(MessageBuilder *msg, uint32_t val)
+void append(MessageBuilder *msg, bool val) { *(msg->data++) = (uint8_t)val; }
+
+void append(MessageBuilder *msg, uint64_t val)
 {
-  uint32_t n_val         = htonl(val);
-  *(uint32_t *)msg->data = n_val;
-  msg->data += sizeof(uint32_t);
+  while (val >= 0x80) {
+    *(msg->data++) = (uint8_t)val | 0x80;
+    val >>= 7;
+  }
+  *(msg->data++) = (uint8_t)val;
 }
+void append(MessageBuilder *msg, uint16_t val) { append(msg, (uint64_t)val); }
+void append(MessageBuilder *msg, uint32_t val) { append(msg, (uint64_t)val); }
 void append(MessageBuilder *msg, int32_t val)
 {
-  uint32_t n_val         = htonl(val);
-  *(uint32_t *)msg->data = n_val;
-  msg->data += sizeof(uint32_t);
-}
-void append(MessageBuilder *msg, uint64_t val)
-{
-  uint64_t n_val         = htonll(val);
-  *(uint64_t *)msg->data = n_val;
-  msg->data += sizeof(uint64_t);
+  append(msg, (uint64_t)(((uint32_t)val << 1) ^ (uint32_t)(val >> 31)));
 }
 void append(MessageBuilder *msg, char *str, uint16_t len)
 {
   append(msg, len);
-
   memcpy(msg->data, str, len);
   msg->data += len;
 }
-// void append(MessageBuilder *msg, String str)
-// {
-//     append(msg, str.len);
-
-//     memcpy(msg->data, str.data, str.len);
-//     msg->data += str.len;
-// }
 template <size_t N>
 void append(MessageBuilder *msg, AllocatedString<N> &str)
 {
-  append(msg, str.len);
-  memcpy(msg->data, str.data, str.len);
-  msg->data += str.len;
-}
-
-MessageReader::MessageReader(char *data, uint16_t len)
-{
-  this->data = this->data_buf;
-  this->end  = this->data_buf;
-  if (len <= MAX_MSG_SIZE) {
-    memcpy(this->data_buf, data, len);
-    this->end = this->data_buf + len;
-  }
-}
-void MessageReader::check(char *ptr)
-{
-  if (ptr > end) {
-    // gone past the end of the message
-    assert(false);
-    exit(1);
-  }
+  append(msg, str.data, str.len);
 }
 
-uint32_t read(MessageReader *msg, char *val)
+MessageReader::MessageReader(char *data, uint32_t len)
 {
-  msg->check(msg->data + 1);
-  *val = msg->data[0];
-  msg->data++;
-
-  return 1;
+  this->data = data;
+  this->end  = data + len;
 }
-uint32_t read(MessageReader *msg, uint8_t *val)
-{
-  msg->check(msg->data + 1);
-  *val = msg->data[0];
-  msg->data++;
 
-  return 1;
-}
-uint32_t read(MessageReader *msg, bool *val)
+// max_bytes can encode more than the type holds, anything over max fails the read rather than
+// being truncated into some other length or index
+uint64_t read_varint(MessageReader *msg, uint32_t max_bytes, uint64_t max)
 {
-  msg->check(msg->data + 1);
-  *val = msg->data[0];
-  msg->data++;
+  uint8_t byte = *(msg->data++);
+  if (byte < 0x80) return byte;
 
-  return 1;
+  uint64_t val = byte & 0x7F;
+  for (uint32_t i = 1; i < max_bytes; i++) {
+    byte = *(msg->data++);
+    val |= (uint64_t)(byte & 0x7F) << (7 * i);
+    if (byte >= 0x80) continue;
+    if (val > max) break;
+    return val;
+  }
+  msg->fail();
+  return 0;
 }
-uint32_t read(MessageReader *msg, uint16_t *val)
-{
-  msg->check(msg->data + 2);
-  uint16_t n_val = *(uint16_t *)msg->data;
-  *val           = ntohs(n_val);
-  msg->data += 2;
 
-  return 2;
-}
-uint32_t read(MessageReader *msg, uint32_t *val)
+void read(MessageReader *msg, char *val) { *val = *(msg->data++); }
+void read(MessageReader *msg, uint8_t *val) { *val = *(msg->data++); }
+void read(MessageReader *msg, bool *val) { *val = *(msg->data++) != 0; }
+void read(MessageReader *msg, uint16_t *val) { *val = read_varint(msg, 3, UINT16_MAX); }
+void read(MessageReader *msg, uint32_t *val) { *val = read_varint(msg, MAX_VARINT32, UINT32_MAX); }
+void read(MessageReader *msg, int32_t *val)
 {
-  msg->check(msg->data + 4);
-  uint32_t n_val = *(uint32_t *)msg->data;
-  *val           = ntohl(n_val);
-  msg->data += 4;
-
-  return 4;
+  uint32_t zigzag = read_varint(msg, MAX_VARINT32, UINT32_MAX);
+  *val            = (int32_t)((zigzag >> 1) ^ (0 - (zigzag & 1)));
 }
-uint32_t read(MessageReader *msg, int32_t *val)
-{
-  msg->check(msg->data + 4);
-  uint32_t n_val = *(uint32_t *)msg->data;
-  *val           = ntohl(n_val);
-  msg->data += 4;
-
-  return 4;
-}
-uint32_t read(MessageReader *msg, uint64_t *val)
-{
-  msg->check(msg->data + 8);
-  uint64_t n_val = *(uint64_t *)msg->data;
-  *val           = ntohll(n_val);
-  msg->data += 8;
-
-  return 8;
-}
-uint32_t read(MessageReader *msg, char *output_buf, uint16_t *len)
+void read(MessageReader *msg, uint64_t *val) { *val = read_varint(msg, MAX_VARINT64, UINT64_MAX); }
+void read(MessageReader *msg, char *output_buf, uint16_t *len, uint16_t max_len)
 {
   read(msg, len);
-
-  msg->check(msg->data + *len);
+  if (*len > max_len) {
+    *len = 0;
+    msg->fail();
+    return;
+  }
   memcpy(output_buf, msg->data, *len);
   msg->data += *len;
-
-  return *len;
 }
-// uint32_t read(MessageReader *msg, String *output)
-// {
-//     read(msg, &output->len);
-
-//     msg->check(msg->data + output->len);
-//     output->data = msg->data;
-//     msg->data += output->len;
-
-//     return output->len;
-// }
 template <size_t N>
-uint32_t read(MessageReader *msg, AllocatedString<N> *output)
+void read(MessageReader *msg, AllocatedString<N> *output)
 {
-  read(msg, &output->len);
-
-  msg->check(msg->data + output->len);
-  memcpy(output->data, msg->data, output->len);
-  msg->data += output->len;
-
-  return output->len;
+  read(msg, output->data, &output->len, N);
 }
-uint32_t read_string_inplace(MessageReader *msg, char **val, uint16_t *len)
+void read_string_inplace(MessageReader *msg, char **val, uint16_t *len)
 {
   read(msg, len);
-
-  msg->check(msg->data + *len);
+  if (msg->data + *len > msg->end) {
+    *len = 0;
+    msg->fail();
+  }
   *val = msg->data;
   msg->data += *len;
-
-  return *len;
 }
 
 struct Client {
@@ -311,6 +322,12 @@ struct Client {
   GameId game_id     = 0;
 
   bool ready = false;
+  // set once the client's first frame showed it was built from the same rpc schema as us
+  bool greeted = false;
+
+  // set while the client is on the lobby browser, it's pushed lobby changes since browsed_revision
+  bool browsing        = false;
+  u32 browsed_revision = 0;
 
   AllocatedString<32> username;
   void set_username(String str)
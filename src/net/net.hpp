@@ -3,7 +3,13 @@
 #include "../common.hpp"
 #include "../util.hpp"
 
-const uint16_t MAX_MSG_SIZE = 1024;
+// messages go out in frames of at most MAX_FRAME_SIZE, each starting with its u16 length. a
+// message that doesn't fit in one is split across several, every frame but its last has FRAME_MORE
+// set in the length, and the receiver stitches them back together. MAX_MSG_SIZE bounds the whole
+// message, rpc byte included
+const uint32_t MAX_FRAME_SIZE = 1024;
+const uint16_t FRAME_MORE     = 0x8000;
+const uint32_t MAX_MSG_SIZE   = 32 * 1024;
 
 struct Peer;
 struct Client;
@@ -73,16 +79,77 @@ char *read_string(char *buf, String *output);
 // returns pointer to string within buf, no copying;
 char *read_string_inplace(char *buf, char **val, uint16_t *len);
 
-struct MessageBuilder {
-  char data_buf[MAX_MSG_SIZE];
+// one serialized, framed message waiting to go out, or a chunked one being stitched back together
+// on the way in. refcounted so a broadcast can queue the same buffer on every peer in a lobby.
+// buffers come in size classes, each 4x the last, with their bytes right after the header
+const uint32_t SEND_BUFFER_CLASSES  = 5;
+const uint32_t SMALLEST_SEND_BUFFER = 256;
+
+struct SendBuffer {
+  SendBuffer *next_free = nullptr;
+  uint32_t refs         = 0;
+  uint32_t len          = 0;
+  uint32_t capacity     = 0;
+  uint32_t size_class   = 0;
+  char *data            = nullptr;
+};
+
+struct SendBufferPool {
+  SendBuffer *free_lists[SEND_BUFFER_CLASSES] = {};
+
+  // the smallest buffer holding at least capacity bytes. starts with one reference, held by the
+  // caller
+  SendBuffer *acquire(uint32_t capacity = 0);
+  void release(SendBuffer *buf);
+};
+extern thread_local SendBufferPool send_buffers;
+
+struct IoSlice {
   char *data;
+  uint32_t len;
+};
+const int MAX_IO_SLICES = 64;
+
+// message fields are packed back to back with no padding. integers are little-endian base 128
+// varints, signed ones zigzagged first so small negatives stay small, bools and chars are a byte
+// and strings are a varint length followed by their bytes.
+const uint32_t MAX_VARINT32 = 5;
+const uint32_t MAX_VARINT64 = 10;
+
+constexpr uint32_t varint_size(uint64_t max)
+{
+  return max < 0x80 ? 1 : 1 + varint_size(max >> 7);
+}
+
+// generated reads don't check every field against the end of the message. they may run up to this
+// far past it before noticing, so anything read from has to have that much readable slack
+const uint32_t MAX_READ_OVERRUN = MAX_FRAME_SIZE;
+
+// writes straight into a pooled buffer, starting in the smallest class and moving up as appends
+// reserve room, so a small message is framed in place and sent without a copy. appends don't check
+// for room themselves, the generated message appends reserve their worst case up front
+struct MessageBuilder {
+  SendBuffer *buf = nullptr;
+  char *data      = nullptr;
 
   MessageBuilder();
   MessageBuilder(char header_type);
+  MessageBuilder(const MessageBuilder &) = delete;
+  ~MessageBuilder();
   void reset();
   void reset(char header_type);
 
-  uint16_t get_len();
+  // length of the message so far, rpc byte included
+  uint32_t get_len() { return data - buf->data - sizeof(uint16_t); }
+  uint32_t remaining() { return MAX_MSG_SIZE - get_len(); }
+  void reserve(uint32_t bytes)
+  {
+    if (data + bytes > buf->data + buf->capacity) grow(bytes);
+  }
+  void grow(uint32_t bytes);
+  // frames the message, splitting it if it has to be. the builder is empty afterwards and the
+  // caller holds the one reference to the result
+  SendBuffer *finish();
   void send(Peer *peer);
 };
 void append(MessageBuilder *msg, char val);
@@ -93,30 +160,31 @@ void append(MessageBuilder *msg, uint32_t val);
 void append(MessageBuilder *msg, int32_t val);
 void append(MessageBuilder *msg, uint64_t val);
 void append(MessageBuilder *msg, char *str, uint16_t len);
-// void append(MessageBuilder *msg, String str);
 template <size_t N>
 void append(MessageBuilder *msg, AllocatedString<N> &str);
 
+// reads in place from a message view, nothing is copied. a read that runs past the end leaves
+// data past end, see overran()
 struct MessageReader {
-  char data_buf[MAX_MSG_SIZE];
   char *data;
-
   char *end;
 
-  MessageReader(char *data, uint16_t len);
-  void check(char *ptr);
+  MessageReader(char *data, uint32_t len);
+  bool overran() { return data > end; }
+  // makes any later overran() true, for reads that find garbage before the end
+  void fail() { data = end + 1; }
 };
 
-uint32_t read(MessageReader *msg, char *val);
-uint32_t read(MessageReader *msg, uint8_t *val);
-uint32_t read(MessageReader *msg, bool *val);
-uint32_t read(MessageReader *msg, uint16_t *val);
-uint32_t read(MessageReader *msg, uint32_t *val);
-uint32_t read(MessageReader *msg, int32_t *val);
-uint32_t read(MessageReader *msg, uint64_t *val);
-uint32_t read(MessageReader *msg, char *output_buf, uint16_t *len);
-// uint32_t read(MessageReader *msg, String *output);
+void read(MessageReader *msg, char *val);
+void read(MessageReader *msg, uint8_t *val);
+void read(MessageReader *msg, bool *val);
+void read(MessageReader *msg, uint16_t *val);
+void read(MessageReader *msg, uint32_t *val);
+void read(MessageReader *msg, int32_t *val);
+void read(MessageReader *msg, uint64_t *val);
+// output_buf has to hold max_len bytes, anything longer fails the read
+void read(MessageReader *msg, char *output_buf, uint16_t *len, uint16_t max_len);
 template <size_t N>
-uint32_t read(MessageReader *msg, AllocatedString<N> *str);
+void read(MessageReader *msg, AllocatedString<N> *str);
 // returns pointer to string within buf, no copying
-uint32_t read_string_inplace(MessageReader *msg, char **val, uint16_t *len);
+void read_string_inplace(MessageReader *msg, char **val, uint16_t *len);
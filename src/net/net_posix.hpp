@@ -0,0 +1,182 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <endian.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "net.hpp"
+
+typedef int SOCKET;
+const SOCKET INVALID_SOCKET = -1;
+const int SOCKET_ERROR      = -1;
+
+inline uint64_t htonll(uint64_t val) { return htobe64(val); }
+inline uint64_t ntohll(uint64_t val) { return be64toh(val); }
+
+void init_net()
+{
+  // a client vanishing mid-send should be a failed send, not a dead server
+  signal(SIGPIPE, SIG_IGN);
+}
+
+void deinit_net() {}
+
+void close_socket(SOCKET s) { ::close(s); }
+
+// wakes up anything polling the socket with a hangup, without releasing the fd yet
+void shutdown_socket(SOCKET s) { shutdown(s, SHUT_RDWR); }
+
+void set_blocking(SOCKET s, bool blocking)
+{
+  int flags = fcntl(s, F_GETFL, 0);
+  flags     = blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+  fcntl(s, F_SETFL, flags);
+}
+
+void set_nodelay(SOCKET s)
+{
+  int flag = 1;
+  setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+
+// non-blocking listener
+SOCKET open_socket(uint16_t port)
+{
+  SOCKET s;
+  if ((s = socket(AF_INET, SOCK_STREAM, 0)) == INVALID_SOCKET) {
+    printf("Could not create socket : %d", errno);
+  }
+  int reuse = 1;
+  setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  set_blocking(s, false);
+
+  sockaddr_in server     = {};
+  server.sin_family      = AF_INET;
+  server.sin_addr.s_addr = INADDR_ANY;
+  server.sin_port        = htons(port);
+  if (bind(s, (sockaddr *)&server, sizeof(server)) == SOCKET_ERROR) {
+    printf("Bind failed with error code : %d", errno);
+  }
+  listen(s, SOMAXCONN);
+
+  return s;
+}
+
+SOCKET connect_socket(const char *address, uint16_t port, bool blocking)
+{
+  SOCKET s;
+  if ((s = socket(AF_INET, SOCK_STREAM, 0)) == INVALID_SOCKET) {
+    printf("Could not create socket : %d", errno);
+    assert(false);
+  }
+
+  sockaddr_in server_address = {};
+  server_address.sin_family  = AF_INET;
+  inet_pton(AF_INET, address, &server_address.sin_addr);
+  server_address.sin_port = htons(port);
+  if (connect(s, (sockaddr *)&server_address, sizeof(server_address)) != 0) {
+    printf("Could not connect to server : %d", errno);
+    assert(false);
+  }
+
+  set_nodelay(s);
+  set_blocking(s, blocking);
+  return s;
+}
+
+// a connected pair of non-blocking sockets. writing a byte to one end wakes a thread polling the
+// other
+bool open_wakeup_pair(SOCKET *read_end, SOCKET *write_end)
+{
+  SOCKET pair[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+    printf("socketpair failed with error code : %d\n", errno);
+    return false;
+  }
+  set_blocking(pair[0], false);
+  set_blocking(pair[1], false);
+
+  *read_end  = pair[0];
+  *write_end = pair[1];
+  return true;
+}
+
+// returns INVALID_SOCKET once there are no more pending connections
+SOCKET accept_socket(SOCKET listener)
+{
+  sockaddr_in client = {};
+  socklen_t c        = sizeof(sockaddr_in);
+  SOCKET new_socket  = accept(listener, (sockaddr *)&client, &c);
+  if (new_socket == INVALID_SOCKET) {
+    if (errno != EWOULDBLOCK && errno != EAGAIN) {
+      printf("accept failed with error code : %d\n", errno);
+    }
+    return INVALID_SOCKET;
+  }
+
+  // unlike winsock, accepted sockets don't inherit O_NONBLOCK
+  set_blocking(new_socket, false);
+  set_nodelay(new_socket);
+  return new_socket;
+}
+
+// returns bytes received, 0 if nothing is available, SOCKET_RESULT_DISCONNECTED on failure
+const int SOCKET_RESULT_DISCONNECTED = -1;
+int recv_some(SOCKET s, char *dst, int len)
+{
+  ssize_t received = recv(s, dst, len, 0);
+  if (received == 0) return SOCKET_RESULT_DISCONNECTED;
+  if (received < 0) {
+    if (errno == EWOULDBLOCK || errno == EAGAIN || errno == EINTR) return 0;
+
+    printf("Failure trying to recieve data : %d\n", errno);
+    // anything else is for good, and the poller would keep reporting the socket
+    return SOCKET_RESULT_DISCONNECTED;
+  }
+  return (int)received;
+}
+
+// returns bytes sent, 0 if the socket would block, SOCKET_RESULT_DISCONNECTED on failure
+int send_some(SOCKET s, char *src, int len)
+{
+  ssize_t sent = send(s, src, len, MSG_NOSIGNAL);
+  if (sent < 0) {
+    if (errno == EWOULDBLOCK || errno == EAGAIN || errno == EINTR) return 0;
+
+    printf("Failure trying to send data, error : %d\n", errno);
+    return SOCKET_RESULT_DISCONNECTED;
+  }
+  return (int)sent;
+}
+
+// gathers all slices into a single vectored send. same return values as send_some
+int send_many(SOCKET s, IoSlice *slices, int count)
+{
+  iovec bufs[MAX_IO_SLICES];
+  count = std::min(count, MAX_IO_SLICES);
+  for (int i = 0; i < count; i++) {
+    bufs[i].iov_base = slices[i].data;
+    bufs[i].iov_len  = slices[i].len;
+  }
+
+  msghdr msg     = {};
+  msg.msg_iov    = bufs;
+  msg.msg_iovlen = count;
+
+  // sendmsg rather than writev so MSG_NOSIGNAL applies
+  ssize_t sent = sendmsg(s, &msg, MSG_NOSIGNAL);
+  if (sent < 0) {
+    if (errno == EWOULDBLOCK || errno == EAGAIN || errno == EINTR) return 0;
+
+    printf("Failure trying to send data, error : %d\n", errno);
+    return SOCKET_RESULT_DISCONNECTED;
+  }
+  return (int)sent;
+}
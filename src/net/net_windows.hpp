@@ -20,91 +20,180 @@ void init_net()
 
 void deinit_net() { WSACleanup(); }
 
-struct Peer {
-  SOCKET s;
+void close_socket(SOCKET s) { closesocket(s); }
 
-  char msg_buf[MAX_MSG_SIZE * 2];
-  uint32_t received_so_far = 0;
+// wakes up anything polling the socket with a hangup, without releasing the handle yet
+void shutdown_socket(SOCKET s) { shutdown(s, SD_BOTH); }
 
-  void open(const char *address, uint16_t port, bool blocking)
-  {
-    if ((s = socket(AF_INET, SOCK_STREAM, 0)) == INVALID_SOCKET) {
-      printf("Could not create socket : %d", WSAGetLastError());
-      assert(false);
-    }
+void set_blocking(SOCKET s, bool blocking)
+{
+  u_long mode = blocking ? 0 : 1;
+  ioctlsocket(s, FIONBIO, (unsigned long *)&mode);
+}
 
-    sockaddr_in server_address;
-    server_address.sin_family = AF_INET;
-    inet_pton(AF_INET, address, &server_address.sin_addr.S_un.S_addr);
-    server_address.sin_port = htons(port);
-    if (connect(s, (sockaddr *)&server_address, sizeof(server_address)) != 0) {
-      printf("Could not connect to server : %d", WSAGetLastError());
-      assert(false);
-    }
+void set_nodelay(SOCKET s)
+{
+  BOOL flag = TRUE;
+  setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (char *)&flag, sizeof(flag));
+}
 
-    u_long mode = blocking ? 0 : 1;
-    ioctlsocket(s, FIONBIO, (unsigned long *)&mode);
+// non-blocking listener. SO_REUSEADDR is left off here since on winsock it lets another process
+// steal the port rather than just skipping TIME_WAIT
+SOCKET open_socket(uint16_t port)
+{
+  SOCKET s;
+  if ((s = socket(AF_INET, SOCK_STREAM, 0)) == INVALID_SOCKET) {
+    printf("Could not create socket : %d", WSAGetLastError());
   }
+  set_blocking(s, false);
+
+  sockaddr_in server;
+  server.sin_family      = AF_INET;
+  server.sin_addr.s_addr = INADDR_ANY;
+  server.sin_port        = htons(port);
+  if (bind(s, (sockaddr *)&server, sizeof(server)) == SOCKET_ERROR) {
+    printf("Bind failed with error code : %d", WSAGetLastError());
+  }
+  listen(s, SOMAXCONN);
 
-  void close() { closesocket(s); }
+  return s;
+}
 
-  bool is_connected() { return s != 0; }
+SOCKET connect_socket(const char *address, uint16_t port, bool blocking)
+{
+  SOCKET s;
+  if ((s = socket(AF_INET, SOCK_STREAM, 0)) == INVALID_SOCKET) {
+    printf("Could not create socket : %d", WSAGetLastError());
+    assert(false);
+  }
 
-  void pop_message()
-  {
-    uint16_t len;
-    char *data = read_short(msg_buf, &len);
-    received_so_far -= len;
-    memcpy(msg_buf, &msg_buf[len], received_so_far);
+  sockaddr_in server_address;
+  server_address.sin_family = AF_INET;
+  inet_pton(AF_INET, address, &server_address.sin_addr.S_un.S_addr);
+  server_address.sin_port = htons(port);
+  if (connect(s, (sockaddr *)&server_address, sizeof(server_address)) != 0) {
+    printf("Could not connect to server : %d", WSAGetLastError());
+    assert(false);
   }
 
-  int recieve_msg(char *dst)
-  {
-    if (received_so_far >= 2) {
-      uint16_t expected_len;
-      char *data = read_short(msg_buf, &expected_len);
+  set_nodelay(s);
+  set_blocking(s, blocking);
+  return s;
+}
 
-      if (received_so_far >= expected_len) {
-        memcpy(dst, data, expected_len - 2);
-        return expected_len - 2;
-      }
+// returns INVALID_SOCKET once there are no more pending connections
+SOCKET accept_socket(SOCKET listener)
+{
+  sockaddr_in client = {};
+  int c              = sizeof(sockaddr_in);
+  SOCKET new_socket  = accept(listener, (sockaddr *)&client, &c);
+  if (new_socket == INVALID_SOCKET) {
+    int err;
+    if ((err = WSAGetLastError()) != WSAEWOULDBLOCK) {
+      printf("accept failed with error code : %d\n", err);
     }
+    return INVALID_SOCKET;
+  }
 
-    int received_this_time =
-        recv(s, msg_buf + received_so_far, (MAX_MSG_SIZE * 2) - received_so_far, 0);
-    if (received_this_time == 0) {
-      s = 0;
-      return -1;
-    }
-    if (received_this_time == SOCKET_ERROR) {
-      int err = WSAGetLastError();
-      if (err != WSAEWOULDBLOCK) {
-        printf("Failure trying to recieve data : %d\n", err);
-
-        if (err == WSAECONNRESET || err == WSAECONNRESET) {
-          s = 0;
-        }
-        return -1;
-      }
-      return -1;
-    }
+  // accepted sockets inherit non-blocking mode from the listener on winsock
+  set_nodelay(new_socket);
+  return new_socket;
+}
 
-    received_so_far += received_this_time;
+// a connected pair of non-blocking sockets. writing a byte to one end wakes a thread polling the
+// other. winsock has no socketpair so this goes through a loopback listener
+bool open_wakeup_pair(SOCKET *read_end, SOCKET *write_end)
+{
+  SOCKET listener = socket(AF_INET, SOCK_STREAM, 0);
+  if (listener == INVALID_SOCKET) {
+    printf("Could not create socket : %d", WSAGetLastError());
+    return false;
+  }
 
-    return -1;
+  sockaddr_in address     = {};
+  address.sin_family      = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port        = 0;
+  int address_len         = sizeof(address);
+  if (bind(listener, (sockaddr *)&address, sizeof(address)) == SOCKET_ERROR ||
+      getsockname(listener, (sockaddr *)&address, &address_len) == SOCKET_ERROR ||
+      listen(listener, 1) == SOCKET_ERROR) {
+    printf("Could not open wakeup listener : %d", WSAGetLastError());
+    closesocket(listener);
+    return false;
   }
 
-  void send_all(char *msg, uint16_t len)
-  {
-    int sent = 0;
-    while (sent < len) {
-      int sent_this_time;
-      if ((sent_this_time = send(s, msg + sent, len - sent, 0)) == SOCKET_ERROR) {
-        printf("Failure trying to send data, error : %d, already sent: %d, remaining: %d\n",
-               WSAGetLastError(), sent, len - sent);
-        break;
-      }
-      sent += sent_this_time;
-    }
+  SOCKET writer = socket(AF_INET, SOCK_STREAM, 0);
+  if (writer == INVALID_SOCKET ||
+      connect(writer, (sockaddr *)&address, sizeof(address)) == SOCKET_ERROR) {
+    printf("Could not connect wakeup socket : %d", WSAGetLastError());
+    closesocket(listener);
+    return false;
+  }
+  SOCKET reader = accept(listener, nullptr, nullptr);
+  closesocket(listener);
+  if (reader == INVALID_SOCKET) {
+    printf("Could not accept wakeup socket : %d", WSAGetLastError());
+    closesocket(writer);
+    return false;
+  }
+
+  set_nodelay(writer);
+  set_blocking(reader, false);
+  set_blocking(writer, false);
+  *read_end  = reader;
+  *write_end = writer;
+  return true;
+}
+
+// returns bytes received, 0 if nothing is available, SOCKET_RESULT_DISCONNECTED on failure
+const int SOCKET_RESULT_DISCONNECTED = -1;
+int recv_some(SOCKET s, char *dst, int len)
+{
+  int received = recv(s, dst, len, 0);
+  if (received == 0) return SOCKET_RESULT_DISCONNECTED;
+  if (received == SOCKET_ERROR) {
+    int err = WSAGetLastError();
+    if (err == WSAEWOULDBLOCK) return 0;
+
+    printf("Failure trying to recieve data : %d\n", err);
+    // anything else is for good, and the poller would keep reporting the socket
+    return SOCKET_RESULT_DISCONNECTED;
+  }
+  return received;
+}
+
+// returns bytes sent, 0 if the socket would block, SOCKET_RESULT_DISCONNECTED on failure
+int send_some(SOCKET s, char *src, int len)
+{
+  int sent = send(s, src, len, 0);
+  if (sent == SOCKET_ERROR) {
+    int err = WSAGetLastError();
+    if (err == WSAEWOULDBLOCK) return 0;
+
+    printf("Failure trying to send data, error : %d\n", err);
+    return SOCKET_RESULT_DISCONNECTED;
   }
-};
\ No newline at end of file
+  return sent;
+}
+
+// gathers all slices into one send. same return values as send_some
+int send_many(SOCKET s, IoSlice *slices, int count)
+{
+  WSABUF bufs[MAX_IO_SLICES];
+  count = std::min(count, MAX_IO_SLICES);
+  for (int i = 0; i < count; i++) {
+    bufs[i].buf = slices[i].data;
+    bufs[i].len = slices[i].len;
+  }
+
+  DWORD sent = 0;
+  if (WSASend(s, bufs, count, &sent, 0, nullptr, nullptr) == SOCKET_ERROR) {
+    int err = WSAGetLastError();
+    if (err == WSAEWOULDBLOCK) return 0;
+
+    printf("Failure trying to send data, error : %d\n", err);
+    return SOCKET_RESULT_DISCONNECTED;
+  }
+  return (int)sent;
+}
@@ -0,0 +1,299 @@
+#pragma once
+
+#include "net.hpp"
+#include "poller.hpp"
+
+// received bytes live in a ring of RECV_RING_SIZE with MAX_FRAME_SIZE of slack past the end.
+// single frame messages are handed out as views straight into the ring; the rare one that
+// straddles the end gets its wrapped bytes mirrored into the slack so the view is still contiguous.
+// a further MAX_READ_OVERRUN past that lets message reads run off the end of the last message
+// safely. chunked messages are copied out frame by frame into a pooled buffer as they arrive, so
+// the ring never has to hold more than a frame of one.
+const uint32_t RECV_RING_SIZE = MAX_FRAME_SIZE * 4;
+static_assert((RECV_RING_SIZE & (RECV_RING_SIZE - 1)) == 0, "ring size must be a power of 2");
+
+// outgoing messages queue up as SendBuffer references and get written with one gathered send per
+// flush. a peer that lets SEND_QUEUE_SIZE messages back up is dropped rather than allowed to stall
+// the server.
+const uint32_t SEND_QUEUE_SIZE = 64;
+static_assert((SEND_QUEUE_SIZE & (SEND_QUEUE_SIZE - 1)) == 0, "queue size must be a power of 2");
+
+struct Peer {
+  SOCKET s       = 0;
+  bool connected = false;
+
+  char recv_ring[RECV_RING_SIZE + MAX_FRAME_SIZE + MAX_READ_OVERRUN];
+  // free-running counters, wrapped with RECV_RING_SIZE - 1 on access
+  uint32_t recv_head   = 0;
+  uint32_t recv_tail   = 0;
+  uint16_t current_len = 0;
+
+  // the chunked message being put back together, complete once its last frame is in
+  SendBuffer *assembly   = nullptr;
+  bool assembly_complete = false;
+
+  SendBuffer *send_queue[SEND_QUEUE_SIZE];
+  uint32_t send_head   = 0;
+  uint32_t send_tail   = 0;
+  uint32_t send_offset = 0;  // bytes of the front buffer already sent
+
+  // when set, write interest is toggled on the poller whenever sends back up or drain
+  Poller *poller      = nullptr;
+  u64 poll_key        = 0;
+  bool wants_writable = false;
+
+  void open(const char *address, uint16_t port, bool blocking)
+  {
+    s         = connect_socket(address, port, blocking);
+    connected = true;
+  }
+
+  void attach(SOCKET socket)
+  {
+    s         = socket;
+    connected = true;
+  }
+
+  void watch(Poller *poller, u64 poll_key)
+  {
+    this->poller   = poller;
+    this->poll_key = poll_key;
+  }
+
+  void close()
+  {
+    clear_assembly();
+    clear_send_queue();
+    close_socket(s);
+    connected = false;
+  }
+
+  // marks the peer dead. the socket is only shut down so the owner still gets a hangup event and
+  // can clean up
+  void disconnect()
+  {
+    if (!connected) return;
+
+    clear_assembly();
+    clear_send_queue();
+    shutdown_socket(s);
+    connected = false;
+  }
+
+  bool is_connected() { return connected; }
+
+  // releases the message last returned by recieve_msg
+  void pop_message()
+  {
+    if (assembly_complete) {
+      clear_assembly();
+    } else {
+      recv_head += current_len;
+    }
+    current_len = 0;
+  }
+
+  // leaves the message last returned by recieve_msg in the buffer so it is handed out again
+  void rewind_message() { current_len = 0; }
+
+  void clear_assembly()
+  {
+    if (assembly) send_buffers.release(assembly);
+    assembly          = nullptr;
+    assembly_complete = false;
+  }
+
+  // copies the frame at the head of the ring onto the chunked message and pops it
+  bool assemble_frame(uint32_t frame_len, bool last)
+  {
+    const uint32_t mask = RECV_RING_SIZE - 1;
+    uint32_t payload    = frame_len - 2;
+
+    uint32_t have = assembly ? assembly->len : 0;
+    if (have + payload > MAX_MSG_SIZE) {
+      printf("Dropping peer, chunked message is over %u bytes\n", MAX_MSG_SIZE);
+      disconnect();
+      return false;
+    }
+    // room for the overrun too, the message is read in place like any other
+    uint32_t needed = have + payload + MAX_READ_OVERRUN;
+    if (!assembly || needed > assembly->capacity) {
+      SendBuffer *grown = send_buffers.acquire(std::max(needed, MAX_FRAME_SIZE * 4));
+      if (assembly) {
+        memcpy(grown->data, assembly->data, have);
+        send_buffers.release(assembly);
+      }
+      grown->len = have;
+      assembly   = grown;
+    }
+
+    uint32_t start = (recv_head + 2) & mask;
+    uint32_t first = std::min(payload, RECV_RING_SIZE - start);
+    memcpy(assembly->data + have, recv_ring + start, first);
+    memcpy(assembly->data + have + first, recv_ring, payload - first);
+    assembly->len += payload;
+    assembly_complete = last;
+
+    recv_head += frame_len;
+    return true;
+  }
+
+  // returns the length of the next complete message and points msg at it, or -1 if there isn't
+  // one yet. the view stays valid until pop_message()
+  int buffered_msg(char **msg)
+  {
+    const uint32_t mask = RECV_RING_SIZE - 1;
+
+    while (!assembly_complete) {
+      uint32_t used = recv_tail - recv_head;
+      if (used < 2) return -1;
+
+      uint32_t start    = recv_head & mask;
+      char len_bytes[2] = {recv_ring[start], recv_ring[(recv_head + 1) & mask]};
+      uint16_t header;
+      read_short(len_bytes, &header);
+      uint16_t expected_len = header & ~FRAME_MORE;
+      bool more             = header & FRAME_MORE;
+
+      if (expected_len < 2 || expected_len > MAX_FRAME_SIZE) {
+        printf("Dropping peer, bad message length : %d\n", expected_len);
+        disconnect();
+        return -1;
+      }
+      if (used < expected_len) return -1;
+
+      if (more || assembly) {
+        if (!assemble_frame(expected_len, !more)) return -1;
+        continue;
+      }
+
+      if (start + expected_len > RECV_RING_SIZE) {
+        uint32_t wrapped = start + expected_len - RECV_RING_SIZE;
+        memcpy(recv_ring + RECV_RING_SIZE, recv_ring, wrapped);
+      }
+
+      current_len = expected_len;
+      *msg        = recv_ring + start + 2;
+      return expected_len - 2;
+    }
+
+    current_len = 1;  // anything nonzero, popping releases the assembly instead
+    *msg        = assembly->data;
+    return assembly->len;
+  }
+
+  int recieve_msg(char **msg)
+  {
+    if (current_len) pop_message();
+
+    while (true) {
+      int buffered_len = buffered_msg(msg);
+      if (buffered_len >= 0 || !is_connected()) return buffered_len;
+
+      uint32_t used            = recv_tail - recv_head;
+      uint32_t tail            = recv_tail & (RECV_RING_SIZE - 1);
+      uint32_t free_contiguous = std::min(RECV_RING_SIZE - used, RECV_RING_SIZE - tail);
+
+      int received_this_time = recv_some(s, recv_ring + tail, free_contiguous);
+      if (received_this_time == SOCKET_RESULT_DISCONNECTED) {
+        disconnect();
+        return -1;
+      }
+      if (received_this_time == 0) {
+        return -1;
+      }
+
+      recv_tail += received_this_time;
+
+      // a chunked message keeps reading until it's whole or the socket runs dry. otherwise the
+      // socket may not become readable again, so hand back anything that just completed
+      if (!assembly) return buffered_msg(msg);
+    }
+  }
+
+  bool has_pending_sends() { return send_head != send_tail; }
+
+  // takes a reference to buf until it has been written out
+  bool queue(SendBuffer *buf)
+  {
+    if (!connected) return false;
+    if (send_tail - send_head >= SEND_QUEUE_SIZE) {
+      printf("Dropping peer, send queue is full\n");
+      disconnect();
+      return false;
+    }
+
+    buf->refs++;
+    send_queue[send_tail & (SEND_QUEUE_SIZE - 1)] = buf;
+    send_tail++;
+    return true;
+  }
+
+  // writes as much of the queue as the socket will take without blocking
+  void flush()
+  {
+    while (connected && has_pending_sends()) {
+      IoSlice slices[MAX_IO_SLICES];
+      int slice_count = 0;
+      for (uint32_t i = send_head; i != send_tail && slice_count < MAX_IO_SLICES; i++) {
+        SendBuffer *buf       = send_queue[i & (SEND_QUEUE_SIZE - 1)];
+        uint32_t offset       = i == send_head ? send_offset : 0;
+        slices[slice_count++] = {buf->data + offset, buf->len - offset};
+      }
+
+      int sent = send_many(s, slices, slice_count);
+      if (sent == SOCKET_RESULT_DISCONNECTED) {
+        disconnect();
+        return;
+      }
+      if (sent == 0) break;
+
+      while (sent > 0) {
+        SendBuffer *buf    = send_queue[send_head & (SEND_QUEUE_SIZE - 1)];
+        uint32_t remaining = buf->len - send_offset;
+        if ((uint32_t)sent < remaining) {
+          send_offset += sent;
+          break;
+        }
+
+        sent -= remaining;
+        send_offset = 0;
+        send_head++;
+        send_buffers.release(buf);
+      }
+    }
+
+    bool pending = connected && has_pending_sends();
+    if (poller && pending != wants_writable) {
+      wants_writable = pending;
+      poller->modify(s, poll_key, pending ? POLL_READ | POLL_WRITE : POLL_READ);
+    }
+  }
+
+  void clear_send_queue()
+  {
+    while (has_pending_sends()) {
+      send_buffers.release(send_queue[send_head & (SEND_QUEUE_SIZE - 1)]);
+      send_head++;
+    }
+    send_offset = 0;
+  }
+
+  // swaps every queued buffer other peers also hold for a copy of its own, so the peer can be
+  // handed to another thread. reference counts aren't atomic, and the copies are released on that
+  // thread alone. a buffer only this peer holds can go as it is, pools just keep free buffers and
+  // which thread's pool it ends up back in doesn't matter
+  void unshare_send_queue()
+  {
+    for (uint32_t i = send_head; i != send_tail; i++) {
+      SendBuffer *&buf = send_queue[i & (SEND_QUEUE_SIZE - 1)];
+      if (buf->refs == 1) continue;
+
+      SendBuffer *copy = send_buffers.acquire(buf->len);
+      memcpy(copy->data, buf->data, buf->len);
+      copy->len = buf->len;
+      send_buffers.release(buf);
+      buf = copy;
+    }
+  }
+};
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm>
+
+#include "../common.hpp"
+
+#ifdef _WIN32
+#include "net_windows.hpp"
+#else
+#include "net_posix.hpp"
+#include <errno.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+// readiness-based socket multiplexing. epoll on linux, WSAPoll on windows. sockets are
+// level-triggered so anything left unread will be reported again on the next wait. so is a hangup
+// or error, which comes with POLL_READ set so whatever arrived before it can still be read, but
+// the owner has to drop the socket once it has or the wait spins on it.
+
+enum PollInterest : u32 {
+  POLL_READ   = 1 << 0,
+  POLL_WRITE  = 1 << 1,
+  POLL_HANGUP = 1 << 2,
+};
+
+struct PollEvent {
+  u64 key;
+  u32 events;
+};
+
+const int MAX_POLL_EVENTS = 256;
+
+#ifdef _WIN32
+
+struct Poller {
+  WSAPOLLFD *fds = nullptr;
+  u64 *keys      = nullptr;
+  int count      = 0;
+  int capacity   = 0;
+
+  void init(int max_sockets)
+  {
+    capacity = max_sockets;
+    fds      = (WSAPOLLFD *)calloc(capacity, sizeof(WSAPOLLFD));
+    keys     = (u64 *)calloc(capacity, sizeof(u64));
+  }
+
+  void deinit()
+  {
+    free(fds);
+    free(keys);
+    count = 0;
+  }
+
+  static SHORT to_native(u32 interest)
+  {
+    SHORT events = 0;
+    if (interest & POLL_READ) events |= POLLRDNORM;
+    if (interest & POLL_WRITE) events |= POLLWRNORM;
+    return events;
+  }
+
+  int find(SOCKET s)
+  {
+    for (int i = 0; i < count; i++) {
+      if (fds[i].fd == s) return i;
+    }
+    return -1;
+  }
+
+  bool add(SOCKET s, u64 key, u32 interest)
+  {
+    if (count >= capacity) {
+      printf("poller is full\n");
+      return false;
+    }
+
+    fds[count].fd      = s;
+    fds[count].events  = to_native(interest);
+    fds[count].revents = 0;
+    keys[count]        = key;
+    count++;
+    return true;
+  }
+
+  void modify(SOCKET s, u64 key, u32 interest)
+  {
+    int i = find(s);
+    if (i < 0) return;
+
+    fds[i].events = to_native(interest);
+    keys[i]       = key;
+  }
+
+  void remove(SOCKET s)
+  {
+    int i = find(s);
+    if (i < 0) return;
+
+    count--;
+    fds[i]  = fds[count];
+    keys[i] = keys[count];
+  }
+
+  // timeout_ms < 0 waits forever
+  int wait(PollEvent *events, int max_events, i64 timeout_ms)
+  {
+    int ready = WSAPoll(fds, count, timeout_ms < 0 ? -1 : (INT)timeout_ms);
+    if (ready == SOCKET_ERROR) {
+      printf("WSAPoll failed with error code : %d\n", WSAGetLastError());
+      return 0;
+    }
+
+    int n = 0;
+    for (int i = 0; i < count && n < ready && n < max_events; i++) {
+      SHORT revents = fds[i].revents;
+      if (!revents) continue;
+
+      u32 flags = 0;
+      if (revents & (POLLRDNORM | POLLRDBAND)) flags |= POLL_READ;
+      if (revents & POLLWRNORM) flags |= POLL_WRITE;
+      if (revents & (POLLHUP | POLLERR | POLLNVAL)) flags |= POLL_HANGUP | POLL_READ;
+
+      events[n++] = {keys[i], flags};
+    }
+    return n;
+  }
+};
+
+#else
+
+struct Poller {
+  int epoll_fd = -1;
+
+  // one wait never reports more events than there are sockets
+  epoll_event *native = nullptr;
+  int native_capacity = 0;
+
+  void init(int max_sockets)
+  {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+      printf("epoll_create1 failed with error code : %d\n", errno);
+      assert(false);
+    }
+    native_capacity = std::max(1, std::min(max_sockets, MAX_POLL_EVENTS));
+    native          = (epoll_event *)calloc(native_capacity, sizeof(epoll_event));
+  }
+
+  void deinit()
+  {
+    ::close(epoll_fd);
+    free(native);
+    epoll_fd        = -1;
+    native          = nullptr;
+    native_capacity = 0;
+  }
+
+  static uint32_t to_native(u32 interest)
+  {
+    uint32_t events = EPOLLRDHUP;
+    if (interest & POLL_READ) events |= EPOLLIN;
+    if (interest & POLL_WRITE) events |= EPOLLOUT;
+    return events;
+  }
+
+  bool add(SOCKET s, u64 key, u32 interest)
+  {
+    epoll_event ev;
+    ev.events   = to_native(interest);
+    ev.data.u64 = key;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, s, &ev) != 0) {
+      printf("epoll_ctl add failed with error code : %d\n", errno);
+      return false;
+    }
+    return true;
+  }
+
+  void modify(SOCKET s, u64 key, u32 interest)
+  {
+    epoll_event ev;
+    ev.events   = to_native(interest);
+    ev.data.u64 = key;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, s, &ev);
+  }
+
+  void remove(SOCKET s) { epoll_ctl(epoll_fd, EPOLL_CTL_DEL, s, nullptr); }
+
+  // timeout_ms < 0 waits forever
+  int wait(PollEvent *events, int max_events, i64 timeout_ms)
+  {
+    if (max_events > native_capacity) max_events = native_capacity;
+
+    int ready = epoll_wait(epoll_fd, native, max_events, timeout_ms < 0 ? -1 : (int)timeout_ms);
+    if (ready < 0) {
+      if (errno != EINTR) printf("epoll_wait failed with error code : %d\n", errno);
+      return 0;
+    }
+
+    for (int i = 0; i < ready; i++) {
+      u32 flags = 0;
+      if (native[i].events & EPOLLIN) flags |= POLL_READ;
+      if (native[i].events & EPOLLOUT) flags |= POLL_WRITE;
+      if (native[i].events & (EPOLLHUP | EPOLLRDHUP | EPOLLERR)) flags |= POLL_HANGUP | POLL_READ;
+
+      events[i] = {native[i].data.u64, flags};
+    }
+    return ready;
+  }
+};
+
+#endif
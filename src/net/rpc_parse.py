@@ -4,8 +4,27 @@ from string import Template
 
 message_file_template = Template("""
 #pragma once
-#include "net_windows.hpp"
-#include <vector>
+#include "peer.hpp"
+
+// hash of messages.rpc. a client's first frame is RPC_HELLO carrying the schema it was built
+// from, and the server drops clients whose schema doesn't match its own
+const uint32_t RPC_SCHEMA_VERSION = $schema_version;
+const char RPC_HELLO = 0;
+
+void append_hello(MessageBuilder *msg)
+{
+    append(msg, RPC_HELLO);
+    append(msg, RPC_SCHEMA_VERSION);
+}
+bool read_hello(char *data, int msg_len)
+{
+    MessageReader in(data, msg_len);
+    char rpc;
+    uint32_t version;
+    read(&in, &rpc);
+    read(&in, &version);
+    return !in.overran() && rpc == RPC_HELLO && version == RPC_SCHEMA_VERSION;
+}
 
 enum struct Message : char
 {
@@ -23,45 +42,63 @@ message_template = Template("""
 struct $name 
 {
 $members
+
+    // the most append() can write$max_size_note
+    static const uint32_t MAX_SIZE = $max_size;
 };
+$asserts
 void append(MessageBuilder *msg, $name &in)
 {
+    msg->reserve($reserve);
 $appends
 }
-uint32_t read(MessageReader *msg, $name *out)
+// false if the message was cut short or malformed
+bool read(MessageReader *msg, $name *out)
 {
-    uint32_t len = 0;
-
 $reads
-    return len;
+    return !msg->overran();
 }
-void append(MessageBuilder *msg, std::vector<$name> &in)
+""")
+list_template = Template("""
+// lists are inline arrays with their capacity set in messages.rpc, so messages never allocate.
+// they carry as many elements as are sure to fit in MAX_MSG_SIZE with room_after still left for
+// the rest of their message. the count is written last, as a two byte varint, once that's known.
+// its two bytes were reserved by the message. reserving can move the buffer, so the count is found
+// again by its offset
+template <size_t N>
+void append(MessageBuilder *msg, Array<$name, N> &in, uint32_t room_after)
 {
-	append(msg, (uint16_t)in.size());
-	for (auto &it : in)
+    static_assert(N < 0x4000, "list count has to fit in two varint bytes");
+    uint32_t count_offset = msg->data - msg->buf->data;
+    msg->data += 2;
+
+    uint16_t count = 0;
+    for (; count < in.len && msg->remaining() >= $name::MAX_SIZE + room_after; count++)
     {
-        append(msg, it);
+        msg->reserve($name::MAX_SIZE + room_after);
+        append(msg, in.arr[count]);
     }
-};
-uint32_t read(MessageReader *msg, std::vector<$name> *out)
+    char *count_at = msg->buf->data + count_offset;
+    count_at[0]    = (count & 0x7F) | 0x80;
+    count_at[1]    = count >> 7;
+}
+template <size_t N>
+bool read(MessageReader *msg, Array<$name, N> *out)
 {
-	uint32_t len = 0;
-
-	uint16_t list_len;
-	len += read(msg, &list_len);
-	for (int i = 0; i < list_len; i++)
+    uint16_t count;
+    read(msg, &count);
+    if (count > N) msg->fail();
+    for (uint16_t i = 0; i < count && !msg->overran(); i++)
     {
-		$name elem;
-        len += read(msg, &elem);
-        out->push_back(elem);
-	}
-
-	return len;
-};
+        read(msg, &out->arr[out->len++]);
+    }
+    return !msg->overran();
+}
 """)
 member_template = Template("""    $type $member_name = $default;""")
 append_template = Template("""    append(msg, in.$member);""")
-read_template = Template("""    len += read(msg, &out->$member);""")
+list_append_template = Template("""    append(msg, in.$member, $room_after);""")
+read_template = Template("""    read(msg, &out->$member);""")
 
 client_file_template = Template("""#pragma once
 
@@ -70,7 +107,19 @@ client_file_template = Template("""#pragma once
 
 struct RpcClient : public BaseRpcClient
 {
-    using BaseRpcClient::BaseRpcClient;
+    RpcClient() = default;
+    RpcClient(const char *address, uint16_t port) : BaseRpcClient(address, port) { hello(); }
+    void connect(const char *address, uint16_t port)
+    {
+        BaseRpcClient::connect(address, port);
+        hello();
+    }
+    void hello()
+    {
+        MessageBuilder out;
+        append_hello(&out);
+        out.send(&peer);
+    }
     bool handle_rpc(char*, int);
 
     bool msg_received();
@@ -121,7 +170,7 @@ client_rpc_case_template = Template("""
         case Rpc::${rpc}:
         {
             ${rpc}_msg = {};
-            read(&in, &${rpc}_msg);
+            if (!read(&in, &${rpc}_msg)) return false;
             got_${rpc}_msg = true;
         }
         break;""")
@@ -152,30 +201,37 @@ client_clear_messages_template = Template("""
 server_file_template = Template("""
 #pragma once
 
+#include <new>
+
 #include "base_rpc.hpp"
 #include "generated_messages.hpp"
 
 struct RpcServer : public BaseRpcServer
 {
     using BaseRpcServer::BaseRpcServer;
-    void handle_rpc(ClientId, Peer*, char*, int);
+    bool handle_rpc(ClientId, Peer*, char*, int);
 
 $rpc_handler_decls
 
 $callable_rpc_decls
+
+    // responses with lists are too big for the stack, they're rebuilt in place here instead
+$big_resps
 };
 
-void RpcServer::handle_rpc(ClientId client_id, Peer *peer, char *data, int msg_len)
+// false if the message was malformed, the peer should be dropped
+bool RpcServer::handle_rpc(ClientId client_id, Peer *peer, char *data, int msg_len)
 {
     Rpc rpc_type;
     data = read_byte(data, (char *)&rpc_type);
     MessageReader in(data, msg_len - 1);
-    MessageBuilder out;
     switch(rpc_type) {
 $handle_rpc_cases
     default:
-        assert(false);
+        printf("Dropping peer, unknown rpc %d\\n", (int)rpc_type);
+        return false;
     }
+    return true;
 }
 
 $callable_rpc_defs
@@ -186,16 +242,37 @@ server_rpc_case_template = Template(
     """    case Rpc::$name:
     {
         $req req;
-        $resp resp;
-        read(&in, &req);
+        $resp_decl
+        if (!read(&in, &req))
+        {
+            printf("Dropping peer, malformed $name\\n");
+            return false;
+        }
         Handle$name(client_id, &req, &resp);
+        MessageBuilder out;
         append(&out, (char)Rpc::$name);
         append(&out, resp);
         out.send(peer);
     }
     break;""")
+# a server rpc declared with a response of none is one way, nothing is sent back
+server_oneway_handler_decl_template = Template(
+    """    void Handle$name(ClientId client_id, $req*);""")
+server_oneway_case_template = Template(
+    """    case Rpc::$name:
+    {
+        $req req;
+        if (!read(&in, &req))
+        {
+            printf("Dropping peer, malformed $name\\n");
+            return false;
+        }
+        Handle$name(client_id, &req);
+    }
+    break;""")
 server_callable_rpc_template = Template("""
     void $name(Peer *, $req);
+    void $name(Broadcaster, $req);
 """)
 server_callable_rpc_def_template = Template("""
 void RpcServer::$name(Peer *peer, $req req)
@@ -204,27 +281,70 @@ void RpcServer::$name(Peer *peer, $req req)
     append(&out, (char) Rpc::$name);
     append(&out, req); out.send(peer);
 }
+void RpcServer::$name(Broadcaster broadcaster, $req req)
+{
+    MessageBuilder out;
+    append(&out, (char) Rpc::$name);
+    append(&out, req); broadcaster.send(&out);
+}
 """)
 
 
 builtins = {'int': 'int32_t', 'uint': 'uint32_t',
-            'string': "AllocatedString<64>", 'list': "std::vector"}
+            'string': "AllocatedString<64>"}
+max_sizes = {'int': 'MAX_VARINT32', 'uint': 'MAX_VARINT32', 'bool': '1'}
 defaults = {'int': '0', 'uint': '0',
-            'bool': 'false', 'string': '{}', 'list': '{}'}
+            'bool': 'false', 'string': '{}'}
 
 def string_type(type):
     if type == 'string': return 'AllocatedString<64>'
     return type.replace('string', 'AllocatedString')
 
 
+def is_list(ts):
+    return ts[0].startswith('list')
+
+
+# list<N>, the most elements the list can hold
+def list_capacity(ts):
+    if not ts[0].startswith('list<'):
+        print(f'{" ".join(ts)}: lists need a capacity, list<N>')
+        exit(1)
+    return int(ts[0][len('list<'):-1])
+
+
 def to_type(ts):
     if ts[0].startswith('string'):
         return string_type(ts[0])
-    if ts[0] == "list":
-        return f"{builtins[ts[0]]}<{to_type(ts[1:])}>"
+    if is_list(ts):
+        return f"Array<{to_type(ts[1:])}, {list_capacity(ts)}>"
     return builtins[ts[0]] if ts[0] in builtins else ts[0]
 
 
+def string_len(type):
+    return int(type[len('string<'):-1]) if type.startswith('string<') else 64
+
+
+# the most a member can take up on the wire, as a c++ expression
+def max_size(ts):
+    if ts[0].startswith('string'):
+        n = string_len(ts[0])
+        return f"varint_size({n}) + {n}"
+    if is_list(ts):
+        return f"2 + {list_capacity(ts)} * {ts[1]}::MAX_SIZE"
+    if ts[0] in max_sizes:
+        return max_sizes[ts[0]]
+    return f"{ts[0]}::MAX_SIZE"
+
+
+# how far past the end of a message reading a member can run. a list stops once it is past the end,
+# so it's one element
+def max_overrun(ts):
+    if is_list(ts):
+        return f"2 + {ts[1]}::MAX_SIZE"
+    return max_size(ts)
+
+
 def get_default(type):
     if type in defaults:
         return defaults[type]
@@ -245,8 +365,8 @@ class Message:
 
         members = []
         for l in lines[1:]:
-            parts = l.split(' ')
-            members.append((parts[0], to_type(parts[1:])))
+            parts = l.split()
+            members.append((parts[0], to_type(parts[1:]), parts[1:]))
 
         return Message(name, members)
 
@@ -273,6 +393,9 @@ class Rpc:
 
         return Rpc(name, req, resp)
 
+    def one_way(self):
+        return self.resp_type == 'none'
+
 
 if len(sys.argv) != 3:
     print('Wrong number of args')
@@ -289,47 +412,98 @@ message_enums = ['\t' + (m.name + " = 1" if i == 0 else m.name)
 server_rpc_enums = ['\t' + (rpc.name + " = 1" if i == 0 else rpc.name)
                     for i, rpc in enumerate(server_rpcs)]
 client_rpc_enums = ['\t' + rpc.name for rpc in client_rpcs]
+# list encoders are only generated for the types that are actually sent in lists
+listed = set(var[2][1] for msg in messages for var in msg.members if is_list(var[2]))
+for msg in messages:
+    if msg.name in listed and not msg.members:
+        print(f'{msg.name} is sent in a list but has no members')
+        exit(1)
+# a list only knows the room its own message needs after it, so those messages can't be nested
+with_lists = set(msg.name for msg in messages if any(is_list(var[2]) for var in msg.members))
+for msg in messages:
+    for var in msg.members:
+        if var[2][-1] in with_lists:
+            print(f'{msg.name}.{var[0]}: {var[2][-1]} has a list, it can only be sent on its own')
+            exit(1)
+
+
+# the most the members from i on can write, counting lists as just their count
+def room_after(members, i):
+    return " + ".join("2" if is_list(var[2]) else max_size(var[2]) for var in members[i:]) or "0"
+
 message_text = ""
 for msg in messages:
     members = [member_template.substitute(
         {'type': var[1], 'member_name': var[0], 'default': get_default(var[1])}) for var in msg.members]
-    appends = [append_template.substitute(
-        {'member': var[0]}) for var in msg.members]
+    appends = [list_append_template.substitute({'member': var[0], 'room_after': room_after(msg.members, i + 1)})
+               if is_list(var[2]) else append_template.substitute({'member': var[0]})
+               for i, var in enumerate(msg.members)]
     reads = [read_template.substitute({'member': var[0]})
              for var in msg.members]
-
+    has_list = any(is_list(var[2]) for var in msg.members)
+
+    size = " + ".join(max_size(var[2]) for var in msg.members) or "0"
+    overrun = " + ".join(max_overrun(var[2]) for var in msg.members) or "0"
+    asserts = ""
+    if msg.members:
+        asserts = (f'static_assert({msg.name}::MAX_SIZE <= MAX_MSG_SIZE, "{msg.name} is over MAX_MSG_SIZE");\n'
+                   f'static_assert({overrun} <= MAX_READ_OVERRUN, "reading {msg.name} can run too far past the end");')
     message_text += message_template.substitute(
-        {'name': msg.name, 'members': "\n".join(members), 'appends': "\n".join(appends), 'reads': "\n".join(reads)})
+        {'name': msg.name, 'members': "\n".join(members), 'appends': "\n".join(appends), 'reads': "\n".join(reads),
+         'max_size': f"std::min<uint32_t>(MAX_MSG_SIZE, {size})" if has_list else size,
+         'max_size_note': ", lists are cut short to fit MAX_MSG_SIZE" if has_list else "",
+         'reserve': room_after(msg.members, 0) if has_list else f"{msg.name}::MAX_SIZE",
+         'asserts': asserts})
+    if msg.name in listed:
+        message_text += list_template.substitute({'name': msg.name})
+
+
+# changes to the schema (names, member types and order, rpcs) change the version
+def schema_hash(text):
+    h = 0x811C9DC5
+    for c in text.encode():
+        h = ((h ^ c) * 0x01000193) & 0xFFFFFFFF
+    return h
+
+
+schema = [f"message {m.name} " + " ".join(f"{var[0]}:{'.'.join(var[2])}" for var in m.members)
+          for m in messages]
+schema += [f"server {r.name} {r.req_type} {r.resp_type}" for r in server_rpcs]
+schema += [f"client {r.name} {r.req_type}" for r in client_rpcs]
 
 messages_text = message_file_template.substitute(
-    {'messages': message_text, 'message_enum_values': ",\n".join(message_enums),  'rpc_enum_values': ",\n".join(server_rpc_enums + client_rpc_enums)})
+    {'messages': message_text, 'message_enum_values': ",\n".join(message_enums),  'rpc_enum_values': ",\n".join(server_rpc_enums + client_rpc_enums),
+     'schema_version': "0x%08X" % schema_hash("\n".join(schema))})
 
 
 client_server_rpc_decls = [client_server_rpc_decl_template.substitute(
     {'rpc': rpc.name, 'req': rpc.req_type})
     for rpc in server_rpcs]
+# one way rpcs have no response for the client to receive
+answered_rpcs = [rpc for rpc in server_rpcs if not rpc.one_way()]
+
 client_recv_decls = [client_recv_decl_template.substitute(
     {'rpc': rpc.name, 'msg_type': rpc.resp_type})
-    for rpc in server_rpcs] + [client_recv_decl_template.substitute(
+    for rpc in answered_rpcs] + [client_recv_decl_template.substitute(
         {'rpc': rpc.name, 'msg_type': rpc.req_type})
     for rpc in client_rpcs]
 client_rpc_cases = [client_rpc_case_template.substitute(
-    {'rpc': rpc.name}) for rpc in server_rpcs] + [client_rpc_case_template.substitute(
+    {'rpc': rpc.name}) for rpc in answered_rpcs] + [client_rpc_case_template.substitute(
         {'rpc': rpc.name}) for rpc in client_rpcs]
 client_server_rpc_defs = [client_server_rpc_def_template.substitute(
     {'rpc': rpc.name, 'req': rpc.req_type})
     for rpc in server_rpcs]
 client_client_recv_defs = [client_recv_def_template.substitute(
     {'rpc': rpc.name, 'msg_type': rpc.resp_type})
-    for rpc in server_rpcs] + [client_recv_def_template.substitute(
+    for rpc in answered_rpcs] + [client_recv_def_template.substitute(
         {'rpc': rpc.name, 'msg_type': rpc.req_type})
     for rpc in client_rpcs]
 client_msg_received_conditionals = [client_msg_received_conditionals_template.substitute(
-    {'rpc': rpc.name}) for rpc in server_rpcs] + [client_msg_received_conditionals_template.substitute(
+    {'rpc': rpc.name}) for rpc in answered_rpcs] + [client_msg_received_conditionals_template.substitute(
         {'rpc': rpc.name})
     for rpc in client_rpcs]
 client_clear_messages = [client_clear_messages_template.substitute(
-    {'rpc': rpc.name}) for rpc in server_rpcs] + [client_clear_messages_template.substitute(
+    {'rpc': rpc.name}) for rpc in answered_rpcs] + [client_clear_messages_template.substitute(
         {'rpc': rpc.name})
     for rpc in client_rpcs]
 client_text = client_file_template.substitute({
@@ -343,11 +517,20 @@ client_text = client_file_template.substitute({
 })
 
 
-server_rpc_handler_decls = [server_rpc_handler_decl_template.substitute(
+big_resps = [rpc for rpc in server_rpcs if rpc.resp_type in with_lists]
+
+
+def resp_decl(rpc):
+    if rpc.resp_type in with_lists:
+        return f"{rpc.resp_type} &resp = *new (&{rpc.name}_resp) {rpc.resp_type}();"
+    return f"{rpc.resp_type} resp;"
+
+
+server_rpc_handler_decls = [(server_oneway_handler_decl_template if rpc.one_way() else server_rpc_handler_decl_template).substitute(
     {'name': rpc.name, 'req': rpc.req_type, 'resp': rpc.resp_type})
     for rpc in server_rpcs]
-server_rpc_cases = [server_rpc_case_template.substitute(
-    {'name': rpc.name, 'req': rpc.req_type, 'resp': rpc.resp_type})
+server_rpc_cases = [(server_oneway_case_template if rpc.one_way() else server_rpc_case_template).substitute(
+    {'name': rpc.name, 'req': rpc.req_type, 'resp': rpc.resp_type, 'resp_decl': resp_decl(rpc)})
     for rpc in server_rpcs]
 server_callable_rpc_decls = [server_callable_rpc_template.substitute(
     {'name': ow.name, 'req': ow.req_type})
@@ -360,6 +543,7 @@ server_text = server_file_template.substitute({
     'handle_rpc_cases': "\n".join(server_rpc_cases),
     'callable_rpc_decls': "".join(server_callable_rpc_decls),
     'callable_rpc_defs': "\n".join(server_callable_rpc_defs),
+    'big_resps': "\n".join(f"    {rpc.resp_type} {rpc.name}_resp;" for rpc in big_resps),
 })
 
 messages_file = open(sys.argv[2] + '/generated_messages.hpp', 'w+')
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <atomic>
+
+#include "../common.hpp"
+#include "../util.hpp"
+#include "generated_messages.hpp"
+
+// the lobby roster and scores, replicated as numbered snapshots. the server keeps the last few it
+// made and sends each client only what changed since the newest one that client acknowledged:
+// joins, family swaps and score changes as players, leaves as removed ids. a client that has
+// acknowledged nothing still in the history (it just joined, it reconnected, or it fell that far
+// behind) gets a full snapshot, which is a delta against nothing.
+//
+// snapshot numbers come from one counter for the whole process, so an ack that arrives late from
+// a lobby the client already left can never match a snapshot of the lobby it is in now. 0 is
+// never a snapshot, as a base it means a full snapshot and as an ack it asks for one.
+
+const u32 REPLICATION_HISTORY = 8;
+
+struct ReplicatedState {
+  u32 snapshot = 0;
+  Array<Player, MAX_PLAYERS_PER_GAME> players;
+  i32 scores[2] = {0, 0};
+
+  Player *find_player(i32 user_id)
+  {
+    for (Player &player : players) {
+      if (player.user_id == user_id) return &player;
+    }
+    return nullptr;
+  }
+};
+
+inline bool same_player(Player *a, Player *b)
+{
+  return a->user_id == b->user_id && a->family == b->family && a->name.len == b->name.len &&
+         memcmp(a->name.data, b->name.data, a->name.len) == 0;
+}
+
+// order matters, clients seat players in roster order
+inline bool same_state(ReplicatedState *a, ReplicatedState *b)
+{
+  if (a->players.len != b->players.len || a->scores[0] != b->scores[0] ||
+      a->scores[1] != b->scores[1]) {
+    return false;
+  }
+  for (i32 i = 0; i < a->players.len; i++) {
+    if (!same_player(&a->players[i], &b->players[i])) return false;
+  }
+  return true;
+}
+
+std::atomic<u32> replication_snapshots = 0;
+
+u32 next_snapshot()
+{
+  u32 snapshot;
+  while (!(snapshot = ++replication_snapshots)) {
+  }
+  return snapshot;
+}
+
+// the last REPLICATION_HISTORY snapshots, oldest overwritten first
+struct StateHistory {
+  ReplicatedState states[REPLICATION_HISTORY];
+  u32 newest = 0;
+
+  ReplicatedState *find(u32 snapshot)
+  {
+    if (!snapshot) return nullptr;
+    for (ReplicatedState &state : states) {
+      if (state.snapshot == snapshot) return &state;
+    }
+    return nullptr;
+  }
+
+  ReplicatedState *latest() { return states[newest].snapshot ? &states[newest] : nullptr; }
+
+  void push(ReplicatedState *state)
+  {
+    newest         = (newest + 1) % REPLICATION_HISTORY;
+    states[newest] = *state;
+  }
+
+  // server side, numbers state and keeps it if anything changed since the latest snapshot
+  ReplicatedState *update(ReplicatedState *state)
+  {
+    ReplicatedState *last = latest();
+    if (last && same_state(last, state)) return last;
+
+    state->snapshot = next_snapshot();
+    push(state);
+    return latest();
+  }
+
+  void clear() { *this = {}; }
+};
+
+// fills in msg with what it takes to turn base into state, everything when base is null
+void diff_state(ReplicatedState *base, ReplicatedState *state, GameStatePingMessage *msg)
+{
+  msg->snapshot = state->snapshot;
+  msg->base     = base ? base->snapshot : 0;
+  msg->players.clear();
+  msg->removed.clear();
+
+  for (Player &player : state->players) {
+    Player *old = base ? base->find_player(player.user_id) : nullptr;
+    if (!old || !same_player(old, &player)) msg->players.append(player);
+  }
+  if (base) {
+    for (Player &player : base->players) {
+      if (!state->find_player(player.user_id)) msg->removed.append({player.user_id});
+    }
+  }
+  msg->family0_score = state->scores[0];
+  msg->family1_score = state->scores[1];
+}
+
+// client side, the inverse of diff_state. players already there are updated in place and new ones
+// go on the end, which keeps the server's roster order since it only ever appends
+void apply_state(ReplicatedState *base, GameStatePingMessage *msg, ReplicatedState *out)
+{
+  *out = base ? *base : ReplicatedState{};
+
+  for (RemovedPlayer &removed : msg->removed) {
+    for (i32 i = 0; i < out->players.len; i++) {
+      if (out->players[i].user_id == removed.user_id) out->players.shift_delete(i--);
+    }
+  }
+  for (Player &player : msg->players) {
+    Player *existing = out->find_player(player.user_id);
+    if (existing) {
+      *existing = player;
+    } else {
+      out->players.append(player);
+    }
+  }
+  out->snapshot  = msg->snapshot;
+  out->scores[0] = msg->family0_score;
+  out->scores[1] = msg->family1_score;
+}
+
+// client side, applies a ping and records the result. returns the snapshot to acknowledge, 0 if the
+// ping was a delta against a snapshot no longer in the history and a full one is needed
+u32 receive_state(StateHistory *history, GameStatePingMessage *msg)
+{
+  ReplicatedState *base = history->find(msg->base);
+  if (msg->base && !base) return 0;
+
+  ReplicatedState state;
+  apply_state(base, msg, &state);
+  history->push(&state);
+  return state.snapshot;
+}
@@ -18,7 +18,7 @@ struct Project {
 
 void load_assets_file(String filename, Assets *assets_o)
 {
-  Temp temp = Temp::start(&assets_temp_allocator);
+  Temp temp = Temp::start(&assets_temp_allocator, "assets load");
 
   FileData file    = read_entire_file(filename, temp);
   YAML::Dict *root = YAML::deserialize(String(file.data, file.length), temp)->as_dict();
@@ -74,7 +74,7 @@ void load_assets_file(String filename, Assets *assets_o)
         texture              = load_and_upload_texture(path, format, assets_memory);
       } else if (YAML::Value *render_target_val = in_texture->get("render_target")) {
         int render_target_id = atoi(render_target_val->as_literal().to_char_array(temp));
-        texture              = assets_o->render_targets.data[render_target_id].value.color_tex;
+        texture              = assets_o->render_targets[render_target_id].color_tex;
       } else {
         assert(false);
       }
@@ -117,7 +117,7 @@ void load_assets_file(String filename, Assets *assets_o)
       material.asset_id = id;
       for (int tex_i = 0; tex_i < texture_refs->len; tex_i++) {
         int texture_ref_id       = atoi(texture_refs->get(tex_i)->as_literal().to_char_array(temp));
-        material.textures[tex_i] = assets_o->textures.data[texture_ref_id].value;
+        material.textures[tex_i] = assets_o->textures[texture_ref_id];
       }
 
       assets_o->materials.emplace(material, id);
@@ -238,10 +238,11 @@ void load_assets_file(String filename, Assets *assets_o)
           track.keys.push_back(key);
         }
 
-        ka.tracks.push_back(track);
+        ka.tracks.push_back(std::move(track));
       }
 
-      assets_o->keyed_animations.emplace(ka, ka.asset_id);
+      i32 id = ka.asset_id;
+      assets_o->keyed_animations.emplace(std::move(ka), id);
     }
   }
 }
@@ -264,12 +265,8 @@ void deserialize_scene_file(String filepath, Assets *assets, Memory mem, Scene *
   for (int i = 0; i < in_entities->len; i++) {
     YAML::Dict *in_e = in_entities->get(i)->as_dict();
 
-    int id                             = atoi(in_e->get("id")->as_literal().to_char_array(tmp));
-    Entity &entity                     = scene_o->entities.data[id].value;
-    scene_o->entities.data[i].assigned = true;
-    if (scene_o->entities.next == &scene_o->entities.data[i]) {
-      scene_o->entities.next = scene_o->entities.data[i].next;
-    }
+    int id         = atoi(in_e->get("id")->as_literal().to_char_array(tmp));
+    Entity &entity = *scene_o->entities.emplace({}, id);
 
     entity.type           = entity_type_from_string(in_e->get("type")->as_literal());
     entity.debug_tag.name = string_to_allocated_string<32>(in_e->get("name")->as_literal());
@@ -300,15 +297,15 @@ void deserialize_scene_file(String filepath, Assets *assets, Memory mem, Scene *
       int mesh_id         = atoi(in_mesh->get("mesh")->as_literal().to_char_array(tmp));
       int material_id     = atoi(in_mesh->get("material")->as_literal().to_char_array(tmp));
 
-      entity.mesh          = &assets->meshes.data[mesh_id].value;
-      entity.vert_buffer   = assets->vertex_buffers.data[mesh_id].value;
-      entity.material      = &assets->materials.data[material_id].value;
+      entity.mesh          = &assets->meshes[mesh_id];
+      entity.vert_buffer   = assets->vertex_buffers[mesh_id];
+      entity.material      = &assets->materials[material_id];
 
       if (auto shader_id_val = in_mesh->get("shader")) {
         int shader_id = atoi(in_mesh->get("shader")->as_literal().to_char_array(tmp));
-        entity.shader = &assets->shaders.data[shader_id].value;
+        entity.shader = &assets->shaders[shader_id];
       } else {
-        entity.shader = &assets->shaders.data[0].value;
+        entity.shader = &assets->shaders[0];
       }
     } else if (entity.type == EntityType::LIGHT) {
       YAML::Dict *in_light      = in_e->get("spotlight")->as_dict();
@@ -361,7 +358,7 @@ RefArray<ViewLayer> deserialize_renderer_config(String filepath, Assets *assets,
     YAML::Dict *in_layer = in_layers->get(i)->as_dict();
 
     i32 env_map_id = atoi(in_layer->get("env_map")->as_literal().to_char_array(mem.temp));
-    view_layer->env_map = &assets->env_maps.data[env_map_id].value;
+    view_layer->env_map = &assets->env_maps[env_map_id];
     view_layer->visiblity_mask = 1 << atoi(in_layer->get("layer_index")->as_literal().to_char_array(mem.temp));
     view_layer->visible =  strcmp(in_layer->get("visible")->as_literal(), "true");
 
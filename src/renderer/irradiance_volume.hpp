@@ -109,7 +109,7 @@ IrradianceVolume create_irradiance_volume(StackAllocator *alloc)
     128, TextureFormat::RGB16F);
 
   i32 num_probes = iv.dimensions.x * iv.dimensions.y * iv.dimensions.z;
-  iv.probes.resize(num_probes);
+  iv.probes.reserve(num_probes);
 
   Vec3f cell_size = Vec3f{iv.bounds.max - iv.bounds.min} /
                     Vec3f{(float)iv.dimensions.x, (float)iv.dimensions.y, (float)iv.dimensions.z};
@@ -50,56 +50,53 @@ static Renderer renderer;
 void render_scene_entities(Scene *scene, ViewLayer *view_layer, RenderTarget target, Camera *camera,
                            Vec3f camera_postion)
 {
-  for (int i = 0; i < scene->entities.size; i++) {
-    if (scene->entities.data[i].assigned) {
-      Entity &e = scene->entities.data[i].value;
-      if (e.view_layer_mask & view_layer->visiblity_mask) {
-        if (e.type == EntityType::MESH) {
-          glm::vec3 rot(e.transform.rotation.x, e.transform.rotation.y, e.transform.rotation.z);
-          glm::vec3 pos(e.transform.position.x, e.transform.position.y, e.transform.position.z);
-          glm::vec3 scale(e.transform.scale.x, e.transform.scale.y, e.transform.scale.z);
-          glm::mat4 model = glm::translate(glm::mat4(1.0f), pos) *
-                            glm::scale(glm::mat4(1.f), scale) * glm::toMat4(glm::quat(rot));
-
-          Shader shader = *e.shader;
-          bind_shader(shader);
-          bind_camera(shader, *camera, camera_postion);
-          bind_mat4(shader, UniformId::MODEL, model);
-          bind_material(shader, *e.material, shader.material_offset);
-          bind_texture(shader, shader.pbr_texture_offset, view_layer->env_map->env_mat.textures[2]);
-
-          if (shader.asset_id == 0) {
-            bind_material(shader, view_layer->env_map->env_mat, shader.reflections_texture_offset);
-            bind_texture(shader, shader.reflections_texture_offset + 1,
-                         renderer.irradiance_volume.cubemaps);
-          } else {
-            bind_material(shader, view_layer->env_map->env_mat, shader.reflections_texture_offset);
-          }
-
-          if (shader.asset_id == 1) {
-            glEnable(GL_BLEND);
-          } else {
-            glDisable(GL_BLEND);
-          }
+  for (Entity &e : scene->entities) {
+    if (e.view_layer_mask & view_layer->visiblity_mask) {
+      if (e.type == EntityType::MESH) {
+        glm::vec3 rot(e.transform.rotation.x, e.transform.rotation.y, e.transform.rotation.z);
+        glm::vec3 pos(e.transform.position.x, e.transform.position.y, e.transform.position.z);
+        glm::vec3 scale(e.transform.scale.x, e.transform.scale.y, e.transform.scale.z);
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), pos) *
+                          glm::scale(glm::mat4(1.f), scale) * glm::toMat4(glm::quat(rot));
+
+        Shader shader = *e.shader;
+        bind_shader(shader);
+        bind_camera(shader, *camera, camera_postion);
+        bind_mat4(shader, UniformId::MODEL, model);
+        bind_material(shader, *e.material, shader.material_offset);
+        bind_texture(shader, shader.pbr_texture_offset, view_layer->env_map->env_mat.textures[2]);
+
+        if (shader.asset_id == 0) {
+          bind_material(shader, view_layer->env_map->env_mat, shader.reflections_texture_offset);
+          bind_texture(shader, shader.reflections_texture_offset + 1,
+                       renderer.irradiance_volume.cubemaps);
+        } else {
+          bind_material(shader, view_layer->env_map->env_mat, shader.reflections_texture_offset);
+        }
 
-          if (e.animation) {
-            for (int i = 0; i < e.animation->final_mats.size(); i++) {
-              // TODO shouldn't be querying location every time
-              std::string uniform_name =
-                  std::string("bone_transforms[") + std::to_string(i) + std::string("]");
-              int handle =
-                  glGetUniformLocation(threed_skinning_shader.shader_handle, uniform_name.c_str());
-              glm::mat4 transform = e.animation->final_mats[i];
-              glUniformMatrix4fv(handle, 1, false, &transform[0][0]);
-            }
-          }
+        if (shader.asset_id == 1) {
+          glEnable(GL_BLEND);
+        } else {
+          glDisable(GL_BLEND);
+        }
 
-          if (shader.shadows_enabled) {
-            bind_texture(shader, shader.shadow_texture_offset, renderer.shadow_map.depth_tex);
+        if (e.animation) {
+          for (int i = 0; i < e.animation->final_mats.size(); i++) {
+            // TODO shouldn't be querying location every time
+            std::string uniform_name =
+                std::string("bone_transforms[") + std::to_string(i) + std::string("]");
+            int handle =
+                glGetUniformLocation(threed_skinning_shader.shader_handle, uniform_name.c_str());
+            glm::mat4 transform = e.animation->final_mats[i];
+            glUniformMatrix4fv(handle, 1, false, &transform[0][0]);
           }
+        }
 
-          draw(target, shader, e.vert_buffer);
+        if (shader.shadows_enabled) {
+          bind_texture(shader, shader.shadow_texture_offset, renderer.shadow_map.depth_tex);
         }
+
+        draw(target, shader, e.vert_buffer);
       }
     }
   }
@@ -108,23 +105,20 @@ void render_scene_entities(Scene *scene, ViewLayer *view_layer, RenderTarget tar
 void render_scene_shadow_entities(Scene *scene, ViewLayer *view_layer, RenderTarget target,
                                   Camera *camera, Vec3f camera_postion)
 {
-  for (int i = 0; i < scene->entities.size; i++) {
-    if (scene->entities.data[i].assigned) {
-      Entity &e = scene->entities.data[i].value;
-      if (e.view_layer_mask & view_layer->visiblity_mask) {
-        if (e.type == EntityType::MESH) {
-          glm::vec3 rot(e.transform.rotation.x, e.transform.rotation.y, e.transform.rotation.z);
-          glm::vec3 pos(e.transform.position.x, e.transform.position.y, e.transform.position.z);
-          glm::vec3 scale(e.transform.scale.x, e.transform.scale.y, e.transform.scale.z);
-          glm::mat4 model = glm::translate(glm::mat4(1.0f), pos) *
-                            glm::scale(glm::mat4(1.f), scale) * glm::toMat4(glm::quat(rot));
-
-          Shader shader = shadow_shader;
-          bind_shader(shader);
-          bind_camera(shader, *camera, camera_postion);
-          bind_mat4(shader, UniformId::MODEL, model);
-          draw(target, shader, e.vert_buffer);
-        }
+  for (Entity &e : scene->entities) {
+    if (e.view_layer_mask & view_layer->visiblity_mask) {
+      if (e.type == EntityType::MESH) {
+        glm::vec3 rot(e.transform.rotation.x, e.transform.rotation.y, e.transform.rotation.z);
+        glm::vec3 pos(e.transform.position.x, e.transform.position.y, e.transform.position.z);
+        glm::vec3 scale(e.transform.scale.x, e.transform.scale.y, e.transform.scale.z);
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), pos) *
+                          glm::scale(glm::mat4(1.f), scale) * glm::toMat4(glm::quat(rot));
+
+        Shader shader = shadow_shader;
+        bind_shader(shader);
+        bind_camera(shader, *camera, camera_postion);
+        bind_mat4(shader, UniformId::MODEL, model);
+        draw(target, shader, e.vert_buffer);
       }
     }
   }
@@ -184,29 +178,24 @@ void render_scene(Scene *scene, ViewLayer *view_layer, RenderTarget target, Came
     camera_pos = editor_camera_pos;
   } else {
     if (view_layer->active_camera_id < 0) {
-      for (int i = 0; i < scene->entities.size; i++) {
-        if (scene->entities.data[i].assigned) {
-          Entity &e = scene->entities.data[i].value;
-          if (e.type == EntityType::CAMERA && (e.view_layer_mask & view_layer->visiblity_mask)) {
-            view_layer->active_camera_id = i;
-            break;
-          }
+      for (u32 i : scene->entities.ids()) {
+        Entity &e = scene->entities[i];
+        if (e.type == EntityType::CAMERA && (e.view_layer_mask & view_layer->visiblity_mask)) {
+          view_layer->active_camera_id = i;
+          break;
         }
       }
     }
     if (view_layer->active_camera_id < 0) {
       return;  // cant draw without camera
     }
-    camera     = &scene->entities.data[view_layer->active_camera_id].value.camera;
-    camera_pos = scene->entities.data[view_layer->active_camera_id].value.transform.position;
+    camera     = &scene->entities[view_layer->active_camera_id].camera;
+    camera_pos = scene->entities[view_layer->active_camera_id].transform.position;
   }
 
-  for (int i = 0; i < scene->entities.size; i++) {
-    if (scene->entities.data[i].assigned) {
-      Entity &e = scene->entities.data[i].value;
-      if (e.type == EntityType::CAMERA && (e.view_layer_mask & view_layer->visiblity_mask)) {
-        e.camera.update_from_transform_perspective(target, e.transform);
-      }
+  for (Entity &e : scene->entities) {
+    if (e.type == EntityType::CAMERA && (e.view_layer_mask & view_layer->visiblity_mask)) {
+      e.camera.update_from_transform_perspective(target, e.transform);
     }
   }
 
@@ -245,30 +234,30 @@ void render_scene(Scene *scene, ViewLayer *view_layer, RenderTarget target, Came
     all_lights.directional_light.direction.z = 0;
 
     all_lights.num_lights = 0;
-    for (int i = 0; i < scene->entities.size && all_lights.num_lights < MAX_LIGHTS; i++) {
-      if (scene->entities.data[i].assigned) {
-        Entity &e = scene->entities.data[i].value;
-        if (e.type == EntityType::LIGHT && (e.view_layer_mask & view_layer->visiblity_mask)) {
-          SpotLight light;
-
-          if (i == 304) {
-            light.shadow_map_index = i - 304;
-            render_shadow_map(scene, view_layer, i, i - 304, renderer.shadow_map, camera);
-            light.lightspace_mat = renderer.shadow_camera.projection * renderer.shadow_camera.view;
-          }
+    for (u32 i : scene->entities.ids()) {
+      if (all_lights.num_lights >= MAX_LIGHTS) break;
+
+      Entity &e = scene->entities[i];
+      if (e.type == EntityType::LIGHT && (e.view_layer_mask & view_layer->visiblity_mask)) {
+        SpotLight light;
 
-          light.position = {e.transform.position.x, e.transform.position.y, e.transform.position.z,
-                            0};
-          light.direction =
-              glm::rotate(glm::quat(glm::vec3{e.transform.rotation.x, e.transform.rotation.y,
-                                              e.transform.rotation.z}),
-                          glm::vec4(0, -1, 0, 0));
-          light.color       = {e.spot_light.color.x, e.spot_light.color.y, e.spot_light.color.z, 0};
-          light.outer_angle = e.spot_light.outer_angle;
-          light.inner_angle = e.spot_light.inner_angle;
-          all_lights.spot_lights[all_lights.num_lights] = light;
-          all_lights.num_lights++;
+        if (i == 304) {
+          light.shadow_map_index = i - 304;
+          render_shadow_map(scene, view_layer, i, i - 304, renderer.shadow_map, camera);
+          light.lightspace_mat = renderer.shadow_camera.projection * renderer.shadow_camera.view;
         }
+
+        light.position = {e.transform.position.x, e.transform.position.y, e.transform.position.z,
+                          0};
+        light.direction =
+            glm::rotate(glm::quat(glm::vec3{e.transform.rotation.x, e.transform.rotation.y,
+                                            e.transform.rotation.z}),
+                        glm::vec4(0, -1, 0, 0));
+        light.color       = {e.spot_light.color.x, e.spot_light.color.y, e.spot_light.color.z, 0};
+        light.outer_angle = e.spot_light.outer_angle;
+        light.inner_angle = e.spot_light.inner_angle;
+        all_lights.spot_lights[all_lights.num_lights] = light;
+        all_lights.num_lights++;
       }
     }
 
@@ -316,7 +305,7 @@ void render_scene(Scene *scene, ViewLayer *view_layer, RenderTarget target, Came
                         glm::scale(glm::mat4(1.f), glm::vec3(.2, .2, .2));
       bind_mat4(probe_debug_shader, UniformId::MODEL, model);
 
-      VertexBuffer vb = assets->vertex_buffers.data[304].value;
+      VertexBuffer vb = assets->vertex_buffers[304];
       draw(target, probe_debug_shader, vb);
     }
 }
@@ -436,7 +425,7 @@ void Renderer::raytrace(Camera *camera, Vec3f camera_pos)
       Vec3f pixel_pos     = {world_pos.x, world_pos.y, world_pos.z};
       Vec3f ray_dir       = normalize(pixel_pos - camera_pos);
 
-      float t = traverse_bvh_threaded(ray_origin, ray_dir);
+      float t = traverse_bvh(ray_origin, ray_dir);
       min_t   = fminf(min_t, t);
       max_t   = fmaxf(max_t, t);
 
@@ -530,7 +519,7 @@ struct TraverseBvhJob {
     Vec3f pixel_pos     = {world_pos.x, world_pos.y, world_pos.z};
     Vec3f ray_dir       = normalize(pixel_pos - ray_origin);
 
-    float t = traverse_bvh_threaded(ray_origin, ray_dir);
+    float t = traverse_bvh(ray_origin, ray_dir);
 
     hdr_image[(RT_WIDTH * y + x) * 3]     = t;
     hdr_image[(RT_WIDTH * y + x) * 3 + 1] = t;
@@ -627,20 +616,20 @@ void Renderer::upload_bvh(){
 
   }
   
-  for (i32 i = 0; i < threaded_nodes.count; i++) {
+  for (i32 i = 0; i < (i32)bvh_nodes.size(); i++) {
     int buf_index = 48 * 5000000 + 48 * i;
     glBufferSubData(GL_SHADER_STORAGE_BUFFER, buf_index, 16,
-                    &threaded_nodes[i].bounds.min);
+                    &bvh_nodes[i].bounds.min);
     glBufferSubData(GL_SHADER_STORAGE_BUFFER, buf_index + 16, 16,
-                    &threaded_nodes[i].bounds.max);
+                    &bvh_nodes[i].bounds.max);
     glBufferSubData(GL_SHADER_STORAGE_BUFFER, buf_index + 28, 4,
-                    &threaded_nodes[i].child_0);
+                    &bvh_nodes[i].child_0);
     glBufferSubData(GL_SHADER_STORAGE_BUFFER, buf_index + 32, 4,
-                    &threaded_nodes[i].child_1);
+                    &bvh_nodes[i].child_1);
     glBufferSubData(GL_SHADER_STORAGE_BUFFER, buf_index + 36, 4,
-                    &threaded_nodes[i].triangle_i_start);
+                    &bvh_nodes[i].triangle_i_start);
     glBufferSubData(GL_SHADER_STORAGE_BUFFER, buf_index + 40, 4,
-                    &threaded_nodes[i].triangle_count);
+                    &bvh_nodes[i].triangle_count);
   }
 }
 void Renderer::raytrace_gpu(Camera *camera, Vec3f camera_pos){
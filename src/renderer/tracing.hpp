@@ -1,6 +1,8 @@
 #pragma once
 
 #include <atomic>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include "../math.hpp"
@@ -23,8 +25,63 @@ struct BvhNode {
   i32 triangle_count;
 };
 
-std::vector<Triangle> triangles;
-Array<BvhNode, 2000000> nodes;
+// sized to match the layout of the gpu copy, see Renderer::upload_bvh. only what's used of either
+// is ever committed
+const u64 MAX_BVH_TRIANGLES = 5000000;
+const u64 MAX_BVH_NODES     = 20000000;
+
+ConcurrentArray<Triangle> triangles;
+ConcurrentArray<BvhNode> bvh_nodes;
+
+void reset_bvh()
+{
+  if (!triangles.arena.base) {
+    triangles.init(MAX_BVH_TRIANGLES);
+    bvh_nodes.init(MAX_BVH_NODES);
+  }
+  triangles.clear();
+  bvh_nodes.clear();
+}
+
+// nodes come out of uncommitted memory, not constructed
+i32 push_nodes(i32 count)
+{
+  i32 first = bvh_nodes.push_back(count);
+  for (i32 i = first; i < first + count; i++) bvh_nodes[i] = {};
+  return first;
+}
+
+// every mesh in the scene in world space. each mesh reserves its range up front, so meshes could
+// be gathered from as many threads as there are
+void gather_triangles(Scene *scene)
+{
+  for (Entity &entity : scene->entities) {
+    if (entity.type == EntityType::MESH) {
+      Entity *e  = &entity;
+      Mesh *mesh = e->mesh;
+
+      i32 tri_count = mesh->verts / 3;
+      i32 vert_size = mesh->buf_size / mesh->verts / sizeof(float);
+      i32 first     = triangles.push_back(tri_count);
+      for (i32 tri_i = 0; tri_i < tri_count; tri_i++) {
+        i32 offset = vert_size * tri_i * 3;
+
+        Triangle tri;
+        tri.verts[0] = *(Vec3f *)(mesh->data + offset);
+        tri.verts[1] = *(Vec3f *)(mesh->data + offset + vert_size);
+        tri.verts[2] = *(Vec3f *)(mesh->data + offset + vert_size + vert_size);
+
+        tri.verts[0] = e->transform * tri.verts[0];
+        tri.verts[1] = e->transform * tri.verts[1];
+        tri.verts[2] = e->transform * tri.verts[2];
+
+        tri.center = (tri.verts[0] + tri.verts[1] + tri.verts[2]) / 3;
+
+        triangles[first + tri_i] = tri;
+      }
+    }
+  }
+}
 
 void set_aabb(BvhNode *node)
 {
@@ -111,7 +168,7 @@ void split(BvhNode *node)
     }
   }
 
-  if (min_axis > -1 && nodes.len < (nodes.MAX_LEN - 2)) {
+  if (min_axis > -1 && bvh_nodes.size() < MAX_BVH_NODES - 2) {
     i32 front = node->triangle_i_start;
     i32 back  = node->triangle_i_start + node->triangle_count - 1;
     while (front <= back) {
@@ -125,12 +182,12 @@ void split(BvhNode *node)
       }
     }
 
-    i32 child_0_i             = nodes.append({});
-    i32 child_1_i             = nodes.append({});
-    BvhNode *child_0          = &nodes[child_0_i];
-    BvhNode *child_1          = &nodes[child_1_i];
+    i32 child_0_i             = push_nodes(2);
+    i32 child_1_i             = child_0_i + 1;
     node->child_0             = child_0_i;
     node->child_1             = child_1_i;
+    BvhNode *child_0          = &bvh_nodes[child_0_i];
+    BvhNode *child_1          = &bvh_nodes[child_1_i];
     child_0->triangle_i_start = node->triangle_i_start;
     child_0->triangle_count   = front - node->triangle_i_start;
     set_aabb(child_0);
@@ -145,45 +202,21 @@ void split(BvhNode *node)
 
 BvhNode create_bvh(Scene *scene)
 {
-  for (i32 i = 0; i < scene->entities.size; i++) {
-    if (scene->entities.data[i].assigned &&
-        scene->entities.data[i].value.type == EntityType::MESH) {
-      Entity *e  = &scene->entities.data[i].value;
-      Mesh *mesh = e->mesh;
-
-      i32 tri_count = mesh->verts / 3;
-      i32 vert_size = mesh->buf_size / mesh->verts / sizeof(float);
-      for (i32 tri_i = 0; tri_i < tri_count; tri_i++) {
-        i32 offset = vert_size * tri_i * 3;
-
-        Triangle tri;
-        tri.verts[0] = *(Vec3f *)(mesh->data + offset);
-        tri.verts[1] = *(Vec3f *)(mesh->data + offset + vert_size);
-        tri.verts[2] = *(Vec3f *)(mesh->data + offset + vert_size + vert_size);
-
-        tri.verts[0] = e->transform * tri.verts[0];
-        tri.verts[1] = e->transform * tri.verts[1];
-        tri.verts[2] = e->transform * tri.verts[2];
-
-        tri.center = (tri.verts[0] + tri.verts[1] + tri.verts[2]) / 3;
-
-        triangles.push_back(tri);
-      }
-    }
-  }
+  reset_bvh();
+  gather_triangles(scene);
 
   Timer timer2;
 
-  i32 root_i             = nodes.append({});
-  BvhNode *root          = &nodes[root_i];
+  i32 root_i             = push_nodes(1);
+  BvhNode *root          = &bvh_nodes[root_i];
   root->triangle_i_start = 0;
   root->triangle_count   = triangles.size();
   set_aabb(root);
 
   split(root);
 
-  printf("triangles: %llu\n", triangles.size());
-  printf("nodels: %zu\n", nodes.len);
+  printf("triangles: %u\n", triangles.size());
+  printf("nodels: %u\n", bvh_nodes.size());
 
   printf("Built BVH in:");
   timer2.print_ms();
@@ -248,7 +281,7 @@ bool ray_aabb_intersect(Vec3f ray_origin, Vec3f ray_dir, AABB &aabb)
 
 float traverse_bvh(Vec3f ray_origin, Vec3f ray_dir, i32 node_i = 0)
 {
-  BvhNode *node = &nodes[node_i];
+  BvhNode *node = &bvh_nodes[node_i];
 
   if (!ray_aabb_intersect(ray_origin, ray_dir, node->bounds)) return 1e30;
 
@@ -268,26 +301,6 @@ float traverse_bvh(Vec3f ray_origin, Vec3f ray_dir, i32 node_i = 0)
   return min_t;
 }
 
-template <typename T, size_t SIZE>
-struct ThreadSafeArray {
-  T elements[SIZE];
-  std::atomic<i32> count = 0;
-
-  const static size_t MAX_COUNT = SIZE;
-
-  i32 push_back(i32 n)
-  {
-    i32 p = count.fetch_add(n);
-    assert(p <= MAX_COUNT - n);
-    return p;
-  }
-  T &operator[](i32 i)
-  {
-    return elements[i];
-  }
-};
-ThreadSafeArray<BvhNode, 20000000> threaded_nodes;
-
 template <typename T, size_t SIZE>
 struct ThreadSafeWorkQueue {
   std::mutex lock;
@@ -295,6 +308,9 @@ struct ThreadSafeWorkQueue {
   i32 head  = 0;
   i32 count = 0;
 
+  // count as of the last push or pop, for deciding whether to share work without taking the lock
+  std::atomic<i32> queued = 0;
+
   const static size_t MAX_COUNT = SIZE;
 
   i32 push(T elem)
@@ -304,6 +320,7 @@ struct ThreadSafeWorkQueue {
     elements[pos] = elem;
     assert(count < SIZE);
     count++;
+    queued.store(count, std::memory_order_relaxed);
     lock.unlock();
 
     return pos;
@@ -311,6 +328,8 @@ struct ThreadSafeWorkQueue {
 
   b8 pop(T *elem)
   {
+    if (!queued.load(std::memory_order_relaxed)) return false;
+
     b8 exists = false;
 
     lock.lock();
@@ -322,6 +341,7 @@ struct ThreadSafeWorkQueue {
       count--;
       exists = true;
     }
+    queued.store(count, std::memory_order_relaxed);
     lock.unlock();
 
     return exists;
@@ -333,10 +353,14 @@ struct BvhConstructJob {
 
 ThreadSafeWorkQueue<BvhConstructJob, 1000000> queue;
 std::atomic<i32> remaining_jobs = 0;
+i32 bvh_thread_count            = 1;
 
 void push_job(i32 node_i) { queue.push({node_i}); }
 
-void threaded_split(BvhNode *node)
+// splits the node and hands its children on. one always stays with this worker, the other only
+// goes to the shared queue while other workers are short of work, so most of the tree is built
+// without touching the queue's lock
+void threaded_split(BvhNode *node, DynamicArray<i32> *local_jobs)
 {
   assert(node->triangle_count > 0);
   if (node->triangle_count < 5) {
@@ -346,7 +370,6 @@ void threaded_split(BvhNode *node)
 
   Vec3f size = node->bounds.max - node->bounds.min;
 
-  float debug_last_cost;
   float min_cost = 1e30;
   i32 min_axis   = -1;
   float min_partition;
@@ -355,7 +378,6 @@ void threaded_split(BvhNode *node)
     for (i32 sample = 0; sample < N_SAMPLES; sample++) {
       float partition = node->bounds.min[axis] + (sample + 1) * (size[axis] / (N_SAMPLES + 2));
       float cost      = surface_area_heuristic(node, axis, partition);
-      debug_last_cost = cost;
       if (cost < min_cost) {
         min_cost      = cost;
         min_axis      = axis;
@@ -378,12 +400,12 @@ void threaded_split(BvhNode *node)
       }
     }
 
-    i32 child_0_i             = threaded_nodes.push_back(2);
+    i32 child_0_i             = push_nodes(2);
     i32 child_1_i             = child_0_i + 1;
     node->child_0             = child_0_i;
     node->child_1             = child_1_i;
-    BvhNode *child_0          = &threaded_nodes[child_0_i];
-    BvhNode *child_1          = &threaded_nodes[child_1_i];
+    BvhNode *child_0          = &bvh_nodes[child_0_i];
+    BvhNode *child_1          = &bvh_nodes[child_1_i];
     child_0->triangle_i_start = node->triangle_i_start;
     child_0->triangle_count   = front - node->triangle_i_start;
     set_aabb(child_0);
@@ -392,8 +414,12 @@ void threaded_split(BvhNode *node)
     set_aabb(child_1);
 
     remaining_jobs += 2;
-    push_job(child_0_i);
-    push_job(child_1_i);
+    local_jobs->push_back(child_0_i);
+    if (queue.queued.load(std::memory_order_relaxed) < bvh_thread_count) {
+      push_job(child_1_i);
+    } else {
+      local_jobs->push_back(child_1_i);
+    }
   }
 
   remaining_jobs--;
@@ -401,13 +427,16 @@ void threaded_split(BvhNode *node)
 
 void bvh_thread()
 {
+  Scratch scratch("bvh jobs");
+  DynamicArray<i32> local_jobs(scratch);
+
   while (true) {
     BvhConstructJob job;
-    if (queue.pop(&job)) {
-      threaded_split(&threaded_nodes[job.node_i]);
-    }
-
-    if (remaining_jobs == 0) {
+    if (local_jobs.count) {
+      threaded_split(&bvh_nodes[local_jobs.pop_back()], &local_jobs);
+    } else if (queue.pop(&job)) {
+      threaded_split(&bvh_nodes[job.node_i], &local_jobs);
+    } else if (remaining_jobs == 0) {
       return;
     }
   }
@@ -417,119 +446,34 @@ BvhNode create_bvh_threaded(Scene *scene)
 {
   Timer timer;
 
-  for (i32 i = 0; i < 100; i++) {
-    if (scene->entities.data[i].assigned &&
-        scene->entities.data[i].value.type == EntityType::MESH) {
-      Entity *e  = &scene->entities.data[i].value;
-      Mesh *mesh = e->mesh;
-
-      i32 tri_count = mesh->verts / 3;
-      i32 vert_size = mesh->buf_size / mesh->verts / sizeof(float);
-      for (i32 tri_i = 0; tri_i < tri_count; tri_i++) {
-        i32 offset = vert_size * tri_i * 3;
-
-        Triangle tri;
-        tri.verts[0] = *(Vec3f *)(mesh->data + offset);
-        tri.verts[1] = *(Vec3f *)(mesh->data + offset + vert_size);
-        tri.verts[2] = *(Vec3f *)(mesh->data + offset + vert_size + vert_size);
+  reset_bvh();
+  gather_triangles(scene);
 
-        tri.verts[0] = e->transform * tri.verts[0];
-        tri.verts[1] = e->transform * tri.verts[1];
-        tri.verts[2] = e->transform * tri.verts[2];
-
-        tri.center = (tri.verts[0] + tri.verts[1] + tri.verts[2]) / 3;
-
-        triangles.push_back(tri);
-      }
-    }
-  }
-    
   printf("Processed triangles in:");
   timer.print_ms();
-  printf("triangles: %llu\n", triangles.size());
+  printf("triangles: %u\n", triangles.size());
 
   //////////////////////////////////////
   Timer timer2;
 
-
-  i32 root_i             = threaded_nodes.push_back(1);
-  BvhNode *root          = &threaded_nodes[root_i];
+  i32 root_i             = push_nodes(1);
+  BvhNode *root          = &bvh_nodes[root_i];
   root->triangle_i_start = 0;
   root->triangle_count   = triangles.size();
   set_aabb(root);
 
   remaining_jobs++;
   push_job(root_i);
-  
-  std::thread t0(bvh_thread);
-  std::thread t1(bvh_thread);
-  std::thread t2(bvh_thread);
-  std::thread t3(bvh_thread);
-  std::thread t4(bvh_thread);
-  std::thread t5(bvh_thread);
-  std::thread t6(bvh_thread);
-  std::thread t7(bvh_thread);
-  std::thread t8(bvh_thread);
-  std::thread t9(bvh_thread);
-  std::thread t10(bvh_thread);
-  std::thread t11(bvh_thread);
-  std::thread t12(bvh_thread);
-  std::thread t13(bvh_thread);
-  std::thread t14(bvh_thread);
-  std::thread t15(bvh_thread);
-  std::thread t16(bvh_thread);
-  std::thread t17(bvh_thread);
-  std::thread t18(bvh_thread);
-  std::thread t19(bvh_thread);
-
-  t0.join();
-  t1.join();
-  t2.join();
-  t3.join();
-  t4.join();
-  t5.join();
-  t6.join();
-  t7.join();
-  t8.join();
-  t9.join();
-  t10.join();
-  t11.join();
-  t12.join();
-  t13.join();
-  t14.join();
-  t15.join();
-  t16.join();
-  t17.join();
-  t18.join();
-  t19.join();
-
-  printf("nodels: %d\n", threaded_nodes.count.load());
+
+  bvh_thread_count = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::thread> threads;
+  for (i32 i = 0; i < bvh_thread_count; i++) threads.emplace_back(bvh_thread);
+  for (std::thread &thread : threads) thread.join();
+
+  printf("nodels: %u\n", bvh_nodes.size());
 
   printf("Built BVH in:");
   timer2.print_ms();
 
   return {};
 }
-
-
-float traverse_bvh_threaded(Vec3f ray_origin, Vec3f ray_dir, i32 node_i = 0)
-{
-  BvhNode *node = &threaded_nodes[node_i];
-
-  if (!ray_aabb_intersect(ray_origin, ray_dir, node->bounds)) return 1e30;
-
-  float min_t = 1e30;
-  if (node->child_0 == -1 && node->child_1 == -1) {
-    for (i32 i = node->triangle_i_start; i < node->triangle_i_start + node->triangle_count; i++) {
-      float t = ray_tri_intersect(ray_origin, ray_dir, triangles[i]);
-      if (t > 0) {
-        min_t = fminf(min_t, t);
-      }
-    }
-  } else {
-    min_t = fminf(min_t, traverse_bvh_threaded(ray_origin, ray_dir, node->child_0));
-    min_t = fminf(min_t, traverse_bvh_threaded(ray_origin, ray_dir, node->child_1));
-  }
-
-  return min_t;
-}
\ No newline at end of file
@@ -8,7 +8,7 @@
 #include "entity.hpp"
 
 struct Scene {
-  FreeList<Entity> entities;
+  Pool<Entity> entities;
   Scripts scripts;
 
    // sequence stuff
@@ -20,7 +20,7 @@ struct Scene {
     EntityId id;
     Transform transform;
   };
-  DynamicArray<EntityTransform, 128> saved_transforms;
+  DynamicArray<EntityTransform> saved_transforms;
 
   Entity *get(int id);
   void init(Memory mem);
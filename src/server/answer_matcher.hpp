@@ -0,0 +1,252 @@
+#pragma once
+
+#include "../common.hpp"
+#include "../util.hpp"
+#include "answer_parser.hpp"
+#include "question_db.hpp"
+
+// matches typed guesses against the current question's answers. every answer is split into its
+// slash separated alternatives ("Pen / Pencil"), normalized, expanded with thesaurus synonyms and
+// compiled into a bit-parallel levenshtein automaton when the round starts. a guess is normalized
+// the same way and run through each automaton with an edit budget, so matching is a few hundred
+// word operations no matter how long the bank is.
+
+const int MATCH_MAX_LEN      = 64;  // one automaton state bit per pattern character
+const int MATCH_MAX_PATTERNS = 48;
+const int MATCH_MAX_SYNONYMS = 4;  // per alternative, so one answer can't crowd out the rest
+const int MATCH_ALPHABET     = 37;  // a-z, 0-9 and space, all normalize() leaves behind
+
+struct MatchPattern {
+  u64 peq[MATCH_ALPHABET];  // bit i is set where pattern character i is that symbol
+  u8 len;
+  u8 max_edits;
+  u8 answer_rank;
+};
+
+i32 match_symbol(char c)
+{
+  if (c >= 'a' && c <= 'z') return c - 'a';
+  if (c >= '0' && c <= '9') return 26 + c - '0';
+  return 36;
+}
+
+bool is_stopword(String token)
+{
+  const char *stopwords[] = {"a",   "an",  "the", "of",  "to", "my", "your", "his",
+                             "her", "its", "our", "their", "some", "and", "or", "at",
+                             "in",  "on",  "for", "with", "from", "up"};
+  for (const char *stopword : stopwords) {
+    if (token.len == strlen(stopword) && memcmp(token.data, stopword, token.len) == 0) return true;
+  }
+  return false;
+}
+
+// cheap suffix stripping, applied to answers and guesses alike so both land on the same stem
+String stem(String token)
+{
+  if (token.len > 5 && memcmp(token.data + token.len - 3, "ing", 3) == 0) {
+    token.len -= 3;
+  } else if (token.len > 3 && token.data[token.len - 1] == 's' &&
+             token.data[token.len - 2] != 's') {
+    token.len -= 1;
+  }
+  return token;
+}
+
+// lowercases, drops punctuation and filler words and stems what's left, writing the tokens
+// separated by single spaces into out. returns the normalized length
+u32 normalize(String in, char *out)
+{
+  char lowered[MATCH_MAX_LEN * 2];
+  u32 lowered_len = 0;
+  for (u32 i = 0; i < in.len && lowered_len < sizeof(lowered); i++) {
+    char c = in.data[i];
+    if (c >= 'A' && c <= 'Z') c = 'a' + c - 'A';
+
+    if (c == '\'') continue;  // "wouldn't" is one word
+    if ((c < 'a' || c > 'z') && (c < '0' || c > '9')) c = ' ';
+    lowered[lowered_len++] = c;
+  }
+
+  String tokens[MATCH_MAX_LEN];
+  u32 token_count    = 0;
+  u32 content_tokens = 0;
+  for (u32 i = 0; i < lowered_len && token_count < MATCH_MAX_LEN;) {
+    while (i < lowered_len && lowered[i] == ' ') i++;
+    u32 start = i;
+    while (i < lowered_len && lowered[i] != ' ') i++;
+    if (i == start) break;
+
+    String token(lowered + start, i - start);
+    tokens[token_count++] = token;
+    if (!is_stopword(token)) content_tokens++;
+  }
+
+  u32 len = 0;
+  for (u32 t = 0; t < token_count; t++) {
+    // an answer made only of filler words is still an answer
+    if (content_tokens && is_stopword(tokens[t])) continue;
+
+    String token = stem(tokens[t]);
+    if (len && len < MATCH_MAX_LEN) out[len++] = ' ';
+    u32 copy = std::min(token.len, MATCH_MAX_LEN - len);
+    memcpy(out + len, token.data, copy);
+    len += copy;
+  }
+  return len;
+}
+
+// how far off a guess may be. short answers and numbers have to be exact, a typo in "six" is
+// usually a different answer
+u8 edit_budget(char *normalized, u32 len)
+{
+  for (u32 i = 0; i < len; i++) {
+    if (normalized[i] >= '0' && normalized[i] <= '9') return 0;
+  }
+  if (len <= 3) return 0;
+  if (len <= 5) return 1;
+  if (len <= 10) return 2;
+  return 3;
+}
+
+struct QuestionMatcher {
+  Array<MatchPattern, MATCH_MAX_PATTERNS> patterns;
+
+  void init(Question *question, QuestionDb *db, HashMap<Entry> *thesaurus)
+  {
+    patterns.clear();
+
+    for (i32 rank = 0; rank < question->answers.len; rank++) {
+      String answer = db->answer(question->answers[rank].index);
+
+      u32 alt_start = 0;
+      for (u32 i = 0; i <= answer.len; i++) {
+        if (i < answer.len && answer.data[i] != '/') continue;
+
+        String alternative(answer.data + alt_start, i - alt_start);
+        alt_start = i + 1;
+        add_pattern(alternative, rank);
+
+        // synonyms are looked up by whole word, so only single word alternatives are expanded
+        char word_buf[MATCH_MAX_LEN];
+        String word = single_word(alternative, word_buf);
+        if (!word.len || !thesaurus) continue;
+
+        Entry &entry = (*thesaurus)[word];
+        u32 synonyms = std::min(entry.synonyms.count, (u32)MATCH_MAX_SYNONYMS);
+        for (u32 s = 0; s < synonyms; s++) {
+          add_pattern(entry.synonyms[s], rank);
+        }
+      }
+    }
+  }
+
+  // rank of the answer the guess is closest to, -1 if it isn't within any answer's edit budget.
+  // ties go to the higher ranked answer
+  i32 match(String guess)
+  {
+    char normalized[MATCH_MAX_LEN];
+    u32 len = normalize(guess, normalized);
+    if (!len) return -1;
+
+    i32 best_rank  = -1;
+    u32 best_edits = MATCH_MAX_LEN + 1;
+    for (i32 i = 0; i < patterns.len; i++) {
+      MatchPattern *pattern = &patterns[i];
+
+      u32 budget = std::min((u32)pattern->max_edits, best_edits);
+      u32 edits  = distance(pattern, normalized, len, budget);
+      if (edits > budget) continue;
+      if (edits < best_edits || (edits == best_edits && pattern->answer_rank < best_rank)) {
+        best_edits = edits;
+        best_rank  = pattern->answer_rank;
+      }
+    }
+    return best_rank;
+  }
+
+  void add_pattern(String text, i32 rank)
+  {
+    if (patterns.len >= MATCH_MAX_PATTERNS) return;
+
+    char normalized[MATCH_MAX_LEN];
+    u32 len = normalize(text, normalized);
+    if (!len) return;
+
+    MatchPattern pattern = {};
+    pattern.len          = len;
+    pattern.max_edits    = edit_budget(normalized, len);
+    pattern.answer_rank  = rank;
+    for (u32 i = 0; i < len; i++) {
+      pattern.peq[match_symbol(normalized[i])] |= 1ull << i;
+    }
+
+    // slashes and synonyms often spell out the same thing twice
+    for (i32 i = 0; i < patterns.len; i++) {
+      if (patterns[i].answer_rank == rank && patterns[i].len == len &&
+          memcmp(patterns[i].peq, pattern.peq, sizeof(pattern.peq)) == 0) {
+        return;
+      }
+    }
+    patterns.append(pattern);
+  }
+
+  // the alternative lowercased and trimmed the way the thesaurus keys its words, or an empty
+  // string if it is more than one word
+  String single_word(String alternative, char *out)
+  {
+    while (alternative.len && isspace(alternative.data[0])) {
+      alternative.data++;
+      alternative.len--;
+    }
+    while (alternative.len && isspace(alternative.data[alternative.len - 1])) {
+      alternative.len--;
+    }
+    if (alternative.len > MATCH_MAX_LEN) return {};
+
+    for (u32 i = 0; i < alternative.len; i++) {
+      char c = alternative.data[i];
+      if (isspace(c)) return {};
+      out[i] = (c >= 'A' && c <= 'Z') ? 'a' + c - 'A' : c;
+    }
+    return String(out, alternative.len);
+  }
+
+  // levenshtein distance between the pattern and text, using myers' bit-vector simulation of the
+  // automaton: one column of the dp matrix per text character, held as vertical +1/-1 deltas.
+  // stops as soon as the budget can't be met and returns something larger than it
+  u32 distance(MatchPattern *pattern, char *text, u32 text_len, u32 budget)
+  {
+    u32 m = pattern->len;
+    if ((text_len > m ? text_len - m : m - text_len) > budget) return budget + 1;
+
+    u64 last  = 1ull << (m - 1);
+    u64 pv    = m == 64 ? ~0ull : (1ull << m) - 1;
+    u64 mv    = 0;
+    u32 score = m;
+
+    for (u32 j = 0; j < text_len; j++) {
+      u64 eq = pattern->peq[match_symbol(text[j])];
+      u64 xv = eq | mv;
+      u64 xh = (((eq & pv) + pv) ^ pv) | eq;
+      u64 ph = mv | ~(xh | pv);
+      u64 mh = pv & xh;
+
+      if (ph & last) {
+        score++;
+      } else if (mh & last) {
+        score--;
+      }
+
+      // row 0 of the matrix grows by one per text character, so a +1 is shifted into the bottom
+      ph = (ph << 1) | 1;
+      mh = mh << 1;
+      pv = mh | ~(xv | ph);
+      mv = ph & xv;
+
+      // every remaining character can lower the score by at most one
+      if (score > budget + (text_len - j - 1)) return budget + 1;
+    }
+    return score;
+  }
+};
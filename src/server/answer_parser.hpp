@@ -5,11 +5,21 @@
 #include <stdio.h>
 #include <cmath>
 #include <cstdint>
-#include "windows.h"
+#include <thread>
+#include <utility>
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define HASH_MAP_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "../util/string_sort.hpp"
+#include "csv_reader.hpp"
+
+// fields come from content files, so a malformed number reads as 0 rather than asserting
 u32 to_u32(String str)
 {
-  assert(str.len < 16);
+  if (str.len >= 16) return 0;
   char buf[20];
   memcpy(buf, str.data, str.len);
   buf[str.len] = '\0';
@@ -17,99 +27,216 @@ u32 to_u32(String str)
 }
 i32 to_i32(String str)
 {
-  assert(str.len < 16);
+  if (str.len >= 16) return 0;
   char buf[20];
   memcpy(buf, str.data, str.len);
   buf[str.len] = '\0';
   return strtol(buf, nullptr, 10);
 }
 
-template <typename T>
-struct DynamicArray {
-  T *data;
-  u32 size     = 0;
-  u32 capacity = 0;
+// bump allocated storage for map keys. blocks are only freed all at once, so a key's bytes never
+// move once it is in a map
+const u32 STRING_ARENA_BLOCK = 64 * 1024;
 
-  DynamicArray()
-  {
-    capacity = 2;
-    data     = (T *)malloc(capacity * sizeof(T));
-  }
-  void resize(i32 new_capacity)
-  {
-    capacity = new_capacity;
-    data     = (T *)realloc(data, capacity * sizeof(T));
-  }
-  void reset() { size = 0; }
-  void append(T element)
+struct StringArena {
+  struct Block {
+    Block *prev;
+    u32 used;
+    u32 size;
+    char data[1];
+  };
+  Block *head = nullptr;
+
+  String copy(String str)
   {
-    if (size >= capacity) {
-      resize(capacity * 2);
+    if (!head || head->used + str.len > head->size) {
+      u32 size    = std::max(STRING_ARENA_BLOCK, str.len);
+      Block *next = (Block *)malloc(sizeof(Block) + size);
+      assert(next);
+      next->prev = head;
+      next->used = 0;
+      next->size = size;
+      head       = next;
     }
 
-    data[size] = element;
-    size++;
+    String out(head->data + head->used, str.len);
+    memcpy(out.data, str.data, str.len);
+    head->used += str.len;
+    return out;
   }
-  T &operator[](i32 i)
+
+  void reset()
   {
-    assert(i < size);
-    return data[i];
+    while (head) {
+      Block *prev = head->prev;
+      free(head);
+      head = prev;
+    }
   }
 };
 
+// a swiss table: slots are split into groups of 16, each with a byte of control data per slot
+// holding either HASH_MAP_EMPTY or the low 7 bits of the slot's hash. a lookup checks a whole
+// group's control bytes against the tag at once and only compares keys for the (rare) tag
+// matches, with the full hash cached in the slot to reject most of those without touching the key.
+// keys are copied into the map's arena, values are stored inline
+const u8 HASH_MAP_EMPTY = 0x80;
+const u32 HASH_MAP_GROUP = 16;
+
+#ifdef HASH_MAP_SSE2
+u32 match_tag(u8 *group, u8 tag)
+{
+  __m128i ctrl = _mm_loadu_si128((__m128i *)group);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(tag)));
+}
+u32 match_empty(u8 *group)
+{
+  // only empty slots have the high bit set
+  return _mm_movemask_epi8(_mm_loadu_si128((__m128i *)group));
+}
+#else
+u32 match_tag(u8 *group, u8 tag)
+{
+  u32 mask = 0;
+  for (u32 i = 0; i < HASH_MAP_GROUP; i++) {
+    if (group[i] == tag) mask |= 1 << i;
+  }
+  return mask;
+}
+u32 match_empty(u8 *group) { return match_tag(group, HASH_MAP_EMPTY); }
+#endif
+
 template <typename T>
 struct HashMap {
-  struct Element {
-    bool assigned = false;
+  struct Slot {
+    u64 hash;
     String key;
     T value;
   };
-  Element *elements;
-  u32 capacity = 0b00001111111111111111111111111111;
+  u8 *ctrl    = nullptr;
+  Slot *slots = nullptr;
+
+  u32 capacity = 0;  // power of two, at least one group
+  u32 len      = 0;
+  StringArena keys;
 
   T blank = {};
 
-  HashMap()
+  HashMap() {}
+
+  // sizes the table for expected keys up front so filling it never has to grow
+  void init(u32 expected)
+  {
+    u32 wanted = HASH_MAP_GROUP;
+    while (wanted * 7 / 8 < expected) wanted *= 2;
+    if (wanted > capacity) rehash(wanted);
+  }
+
+  void deinit()
   {
-    elements = (Element *)calloc(capacity, sizeof(Element));
-    assert(elements);
+    for (u32 i = 0; i < capacity; i++) {
+      if (ctrl[i] != HASH_MAP_EMPTY) slots[i].~Slot();
+    }
+    free(ctrl);
+    free(slots);
+    keys.reset();
+    ctrl     = nullptr;
+    slots    = nullptr;
+    capacity = 0;
+    len      = 0;
   }
 
+  // sets the value for key, adding the key if it isn't in the map yet
   void emplace(String key, T val)
   {
-    u64 h     = hash(key);
-    u32 index = h % capacity;
-    while (elements[index].assigned) {
-      h     = hash(key, h);
-      index = h % capacity;
+    if (T *found = find(key)) {
+      *found = std::move(val);
+    } else {
+      get_or_emplace(key, std::move(val));
     }
+  }
 
-    elements[index].assigned = true;
-    elements[index].key      = key;
-    elements[index].value    = val;
+  // the value for key, first adding it with val if it isn't in the map
+  T &get_or_emplace(String key, T val)
+  {
+    u64 h = hash_string(key);
+    if (T *found = find(key, h)) return *found;
+
+    // grow at 7/8 full so probe sequences stay short
+    if ((len + 1) > capacity * 7 / 8) rehash(capacity ? capacity * 2 : HASH_MAP_GROUP);
+
+    u32 index   = free_slot(h);
+    ctrl[index] = h & 0x7F;
+    new (&slots[index]) Slot{h, keys.copy(key), std::move(val)};
+    len++;
+    return slots[index].value;
   }
 
+  T *find(String key) { return find(key, hash_string(key)); }
+
+  // missing keys read as a default value, as they always have
   T &operator[](String key)
   {
-    u64 h     = hash(key);
-    u32 index = h % capacity;
-    while (elements[index].key != key) {
-      if (!elements[index].assigned) return blank;
-      h     = hash(key, h);
-      index = h % capacity;
+    T *found = find(key);
+    return found ? *found : blank;
+  }
+
+  T *find(String key, u64 h)
+  {
+    if (!capacity) return nullptr;
+
+    u8 tag     = h & 0x7F;
+    u32 groups = capacity / HASH_MAP_GROUP;
+    u32 group  = (h >> 7) & (groups - 1);
+    for (u32 step = 1;; step++) {
+      u8 *group_ctrl = ctrl + group * HASH_MAP_GROUP;
+
+      for (u32 matches = match_tag(group_ctrl, tag); matches; matches &= matches - 1) {
+        Slot *slot = &slots[group * HASH_MAP_GROUP + __builtin_ctz(matches)];
+        if (slot->hash == h && slot->key == key) return &slot->value;
+      }
+      if (match_empty(group_ctrl)) return nullptr;
+
+      // triangular steps visit every group when the group count is a power of two
+      group = (group + step) & (groups - 1);
     }
-    return elements[index].value;
   }
 
-  // http://www.cse.yorku.ca/~oz/hash.html
-  u64 hash(String str, u64 start = 5381)
+  u32 free_slot(u64 h)
   {
-    for (u32 i = 0; i < str.len; i++) {
-      u32 c = str.data[i];
-      start = ((start << 5) + start) + c;
+    u32 groups = capacity / HASH_MAP_GROUP;
+    u32 group  = (h >> 7) & (groups - 1);
+    for (u32 step = 1;; step++) {
+      u32 empty = match_empty(ctrl + group * HASH_MAP_GROUP);
+      if (empty) return group * HASH_MAP_GROUP + __builtin_ctz(empty);
+
+      group = (group + step) & (groups - 1);
     }
+  }
+
+  // moves every slot into a table of new_capacity. hashes are cached, so no key is rehashed
+  void rehash(u32 new_capacity)
+  {
+    u8 *old_ctrl     = ctrl;
+    Slot *old_slots  = slots;
+    u32 old_capacity = capacity;
 
-    return start;
+    capacity = new_capacity;
+    ctrl     = (u8 *)malloc(capacity);
+    slots    = (Slot *)malloc(capacity * sizeof(Slot));
+    assert(ctrl && slots);
+    memset(ctrl, HASH_MAP_EMPTY, capacity);
+
+    for (u32 i = 0; i < old_capacity; i++) {
+      if (old_ctrl[i] == HASH_MAP_EMPTY) continue;
+
+      u32 index   = free_slot(old_slots[i].hash);
+      ctrl[index] = old_ctrl[i];
+      new (&slots[index]) Slot(std::move(old_slots[i]));
+      old_slots[i].~Slot();
+    }
+    free(old_ctrl);
+    free(old_slots);
   }
 };
 
@@ -135,13 +262,6 @@ struct Ser {
     *next   = i;
     pos += sizeof(T);
   }
-  template <>
-  void add(String i)
-  {
-    add(i.len);
-    memcpy(buf + pos, i.data, i.len);
-    pos += i.len;
-  }
 
   template <typename T>
   T get()
@@ -150,99 +270,60 @@ struct Ser {
     pos += sizeof(T);
     return *next;
   }
-  template <>
-  String get()
-  {
-    String ret;
-    ret.len  = get<u32>();
-    ret.data = (char *)buf + pos;
-    pos += ret.len;
-    return ret;
-  }
 };
+template <>
+void Ser::add(String i)
+{
+  add(i.len);
+  memcpy(buf + pos, i.data, i.len);
+  pos += i.len;
+}
+template <>
+String Ser::get()
+{
+  String ret;
+  ret.len  = get<u32>();
+  ret.data = (char *)buf + pos;
+  pos += ret.len;
+  return ret;
+}
 
 String read_file(const char *filename)
 {
-  auto file_handle =
-      CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, NULL, NULL);
-  assert(file_handle != INVALID_HANDLE_VALUE);
+  FILE *file_handle = fopen(filename, "rb");
+  assert(file_handle);
 
-  LARGE_INTEGER filesize;
-  GetFileSizeEx(file_handle, &filesize);
+  fseek(file_handle, 0, SEEK_END);
+  long filesize = ftell(file_handle);
+  fseek(file_handle, 0, SEEK_SET);
 
   String file;
-  file.len            = filesize.QuadPart;
+  file.len            = filesize;
   file.data           = (char *)malloc(file.len + 1);
   file.data[file.len] = '\0';
 
-  DWORD read;
-  ReadFile(file_handle, file.data, file.len, &read, NULL);
+  fread(file.data, 1, file.len, file_handle);
 
-  CloseHandle(file_handle);
+  fclose(file_handle);
 
   return file;
 }
 void write_file(const char *filename, String data)
 {
-  auto file_handle = CreateFileA(filename, GENERIC_WRITE, NULL, NULL, CREATE_ALWAYS, NULL, NULL);
-  if (file_handle == INVALID_HANDLE_VALUE) {
+  FILE *file_handle = fopen(filename, "wb");
+  if (!file_handle) {
     printf("ERROR writing file: %s. Dumping to stdout\n", filename);
     printf("%.*s\n", data.len, data.data);
     return;
   }
 
-  DWORD written = 0;
-  if (!WriteFile(file_handle, data.data, data.len, &written, nullptr) || written != data.len) {
+  size_t written = fwrite(data.data, 1, data.len, file_handle);
+  if (written != data.len) {
     printf("ERROR writing file: %s. Dumping to stdout\n", filename);
     printf("%.*s\n", data.len, data.data);
   }
 
-  CloseHandle(file_handle);
-}
-
-b8 less_than(String a, String b)
-{
-  i32 cmp = strncmp(a.data, b.data, min(a.len, b.len));
-  return cmp == -1 || (cmp == 0 && a.len < b.len);
-}
-void mergesort(DynamicArray<String> answers, DynamicArray<i32> src, DynamicArray<i32> dst,
-               i32 start, i32 count)
-{
-  if (count == 1) {
-    dst[start] = start;
-    return;
-  }
-
-  i32 part1_count = count / 2;
-  i32 part2_count = count - part1_count;
-  mergesort(answers, dst, src, start, part1_count);
-  mergesort(answers, dst, src, start + part1_count, part2_count);
-
-  i32 part1_i = start;
-  i32 part2_i = start + part1_count;
-  for (i32 i = start; i < start + count; i++) {
-    if (part1_i < start + part1_count &&
-        (part2_i >= start + count || less_than(answers[src[part1_i]], answers[src[part2_i]]))) {
-      dst[i] = src[part1_i];
-      part1_i++;
-    } else {
-      dst[i] = src[part2_i];
-      part2_i++;
-    }
-  }
-}
-
-DynamicArray<i32> mergesort(DynamicArray<String> answers)
-{
-  DynamicArray<i32> a;
-  DynamicArray<i32> b;
-  a.resize(answers.size);
-  b.resize(answers.size);
-  a.size = answers.size;
-  b.size = answers.size;
-  mergesort(answers, a, b, 0, answers.size);
-
-  return b;
+  fclose(file_handle);
 }
 
 struct Answer {
@@ -256,132 +337,175 @@ struct Question {
 struct QuestionsAndAnswers {
   DynamicArray<Question> questions;
   DynamicArray<String> answers;
+  DynamicArray<char *> files;  // the csv buffers all the text points into
 };
-QuestionsAndAnswers read_questions()
+
+void free_questions(QuestionsAndAnswers *qa)
 {
-  const i32 FILE_COUNT              = 10;
-  const char *filenames[FILE_COUNT] = {
-      "./src/server/questions_3_np.csv", "./src/server/questions_3.csv",
-      "./src/server/questions_4_np.csv", "./src/server/questions_4.csv",
-      "./src/server/questions_5_np.csv", "./src/server/questions_5.csv",
-      "./src/server/questions_6_np.csv", "./src/server/questions_6.csv",
-      "./src/server/questions_7_np.csv", "./src/server/questions_7.csv",
-  };
+  for (u32 i = 0; i < qa->files.count; i++) {
+    free(qa->files[i]);
+  }
+  qa->files.deinit();
+  qa->questions.deinit();
+  qa->answers.deinit();
+}
 
-  String files[FILE_COUNT];
+const i32 QUESTION_FILE_COUNT = 10;
+const char *QUESTION_FILES[QUESTION_FILE_COUNT] = {
+    "./src/server/questions_3_np.csv", "./src/server/questions_3.csv",
+    "./src/server/questions_4_np.csv", "./src/server/questions_4.csv",
+    "./src/server/questions_5_np.csv", "./src/server/questions_5.csv",
+    "./src/server/questions_6_np.csv", "./src/server/questions_6.csv",
+    "./src/server/questions_7_np.csv", "./src/server/questions_7.csv",
+};
+struct QuestionFile {
+  String file;
+  b8 missing = false;
+  DynamicArray<Question> questions;  // answer indices point into answers below
+  DynamicArray<String> answers;      // deduped within the file, in order of first appearance
+};
 
-  for (i32 i = 0; i < FILE_COUNT; i++) {
-    files[i] = read_file(filenames[i]);
+// every line is a question followed by its answers, each followed by its score in files that
+// have points. answers are lowercased in place in the file buffer once they are deduped, so
+// answers differing only in case are only folded together when the files are merged
+void parse_question_file(QuestionFile *out, const char *filename, b8 has_points,
+                         i32 answers_count)
+{
+  // files can be mid-update when the bank is reloaded, so a missing one is reported, not asserted
+  FILE *file_handle = fopen(filename, "rb");
+  if (!file_handle) {
+    printf("couldn't open question file %s\n", filename);
+    out->missing = true;
+    return;
   }
+  fclose(file_handle);
+  out->file = read_file(filename);
 
-  DynamicArray<Question> questions;
-  DynamicArray<String> all_answers;
+  HashMap<i32> answer_ids;
+  answer_ids.init(4 * 1024);
 
-  for (i32 i = 0; i < FILE_COUNT; i++) {
-    String file = files[i];
+  CsvReader csv(out->file);
+  String field;
+  b8 end_of_line = true;
+  while (csv.next(&field, &end_of_line)) {
+    Question question;
+    question.text = field;
 
-    b8 has_points     = (i % 2) == 1;
-    i32 answers_count = (i / 2) + 3;
+    while (!end_of_line && csv.next(&field, &end_of_line)) {
+      Answer answer;
 
-    u32 cursor  = 0;
-    b8 new_line = false;
-    auto token  = [&]() -> String {
-      String t = {};
-      t.data   = file.data + cursor;
-      t.len    = 0;
-
-      new_line = false;
-
-      if (file.data[cursor] == '"') {
-        cursor++;
-        t.data++;
-        while (file.data[cursor] != '"') {
-          cursor++;
-          t.len++;
-        }
-        cursor++;
-        assert(file.data[cursor] == ',');
-      } else {
-        while (file.data[cursor] != ',' && file.data[cursor] != '\n' && cursor < file.len) {
-          cursor++;
-          t.len++;
-        }
-      }
+      answer.index = answer_ids.get_or_emplace(field, out->answers.count);
+      if (answer.index == out->answers.count) out->answers.push_back(field);
 
-      if (file.data[cursor] == '\n') {
-        new_line = true;
+      if (has_points) {
+        if (!end_of_line && csv.next(&field, &end_of_line)) answer.score = to_i32(field);
+      } else {
+        answer.score = 100 / (answers_count * (answers_count + 1) / 2) *
+                       (answers_count - question.answers.len);
       }
-      cursor++;
 
-      return t;
-    };
+      question.answers.append(answer);
+    }
 
-    while (cursor < file.len) {
-      Question question;
-      question.text = token();
+    out->questions.push_back(question);
+  }
+  answer_ids.deinit();
 
-      while (!new_line) {
-        Answer answer;
+  for (u32 i = 0; i < out->answers.count; i++) {
+    lowercase_ascii(out->answers[i]);
+  }
+}
 
-        String text = token();
-        for (i32 i = 0; i < text.len; i++) {
-          if (text.data[i] >= 'A' && text.data[i] <= 'Z') text.data[i] = 'a' + text.data[i] - 'A';
-        }
-        all_answers.append(text);
-        answer.index = all_answers.size - 1;
+// no questions at all if any of the files couldn't be read
+QuestionsAndAnswers read_questions()
+{
+  const i32 FILE_COUNT = QUESTION_FILE_COUNT;
 
-        if (has_points)
-          answer.score = to_i32(token());
-        else
-          answer.score = 100 / (answers_count * (answers_count + 1) / 2) *
-                         (answers_count - question.answers.len);
+  // files are read and parsed on a thread each, then merged in file order so the result is
+  // the same however the threads were scheduled
+  QuestionFile files[FILE_COUNT];
+  std::thread parsers[FILE_COUNT];
+  for (i32 i = 0; i < FILE_COUNT; i++) {
+    b8 has_points     = (i % 2) == 1;
+    i32 answers_count = (i / 2) + 3;
 
-        question.answers.append(answer);
-      }
+    parsers[i] = std::thread(parse_question_file, &files[i], QUESTION_FILES[i], has_points,
+                             answers_count);
+  }
+  for (i32 i = 0; i < FILE_COUNT; i++) {
+    parsers[i].join();
+  }
 
-      questions.append(question);
-    }
+  QuestionsAndAnswers out;
+  b8 missing = false;
+  for (i32 i = 0; i < FILE_COUNT; i++) {
+    missing |= files[i].missing;
+    if (files[i].file.data) out.files.push_back(files[i].file.data);
+  }
+  if (missing) {
+    free_questions(&out);
+    return out;
   }
 
-  auto sorted = mergesort(all_answers);
-  DynamicArray<i32> new_positions;
-  new_positions.resize(sorted.size);
-  new_positions.size = sorted.size;
-  DynamicArray<String> deduped;
+  u32 question_count = 0;
+  for (i32 i = 0; i < FILE_COUNT; i++) {
+    question_count += files[i].questions.count;
+  }
+  DynamicArray<Question> questions;
+  questions.reserve(std::max(question_count, 1u));
 
-  i32 counts[256] = {};
+  // every file's answers go into one list, which is sorted and deduped into the pool so it can be
+  // searched by prefix. questions then refer to their answers by position in the pool
+  u32 answer_count = 0;
+  for (i32 i = 0; i < FILE_COUNT; i++) {
+    answer_count += files[i].answers.count;
+  }
+  DynamicArray<String> all_answers;
+  all_answers.reserve(std::max(answer_count, 1u));
 
-  String prev = "";
-  i32 prev_i  = -1;
-  for (i32 i = 0; i < sorted.size; i++) {
-    String answer = all_answers[sorted[i]];
+  for (i32 i = 0; i < FILE_COUNT; i++) {
+    QuestionFile *file = &files[i];
 
-    for (i32 t = 0; t < answer.len; t++) {
-      counts[answer.data[t]]++;
+    i32 first_answer = all_answers.count;
+    for (u32 a = 0; a < file->answers.count; a++) {
+      all_answers.push_back(file->answers[a]);
     }
+    for (u32 q = 0; q < file->questions.count; q++) {
+      Question question = file->questions[q];
+      for (i32 a = 0; a < question.answers.len; a++) {
+        question.answers[a].index += first_answer;
+      }
+      questions.push_back(question);
+    }
+
+    file->questions.deinit();
+    file->answers.deinit();
+  }
 
-    if (answer != prev) {
-      prev = answer;
-      prev_i++;
+  DynamicArray<u32> pool_order;
+  DynamicArray<u32> pool_position;
+  pool_order.reserve(all_answers.capacity);
+  pool_position.reserve(all_answers.capacity);
+  u32 threads   = std::thread::hardware_concurrency();
+  u32 pool_size = sort_unique_strings(all_answers.elements, all_answers.count, pool_order.elements,
+                                      pool_position.elements, false, threads);
+  pool_order.count    = pool_size;
+  pool_position.count = all_answers.count;
 
-      deduped.append(all_answers[sorted[i]]);
-    }
-    new_positions[sorted[i]] = prev_i;
+  DynamicArray<String> deduped;
+  deduped.reserve(std::max(pool_size, 1u));
+  for (u32 i = 0; i < pool_size; i++) {
+    deduped.push_back(all_answers[pool_order[i]]);
   }
 
-  for (i32 i = 0; i < questions.size; i++) {
+  for (i32 i = 0; i < questions.count; i++) {
     for (i32 a = 0; a < questions[i].answers.len; a++) {
-      questions[i].answers[a].index = new_positions[questions[i].answers[a].index];
+      questions[i].answers[a].index = pool_position[questions[i].answers[a].index];
     }
   }
-
-  for (i32 i = 0; i < deduped.size; i++) {
-    String answer = deduped[i];
-    printf("%.*s\n", answer.len, answer.data);
-  }
-  _flushall();
-
-  return {questions, deduped};
+  out.questions = std::move(questions);
+  out.answers   = std::move(deduped);
+  return out;
 }
 
 enum struct Part {
@@ -421,70 +545,85 @@ struct Entry {
   String word;
   DynamicArray<String> synonyms;
 };
-// HashMap<Entry> parse_thesaurus()
-// {
-//   String file = read_file("./src/server/th_en_US_v2.dat");
-
-//   u32 cursor  = 0;
-//   b8 new_line = false;
-//   auto token  = [&]() -> String {
-//     String t = {};
-//     t.data   = file.data + cursor;
-//     t.len    = 0;
-
-//     new_line = false;
-
-//     while (file.data[cursor] != '|' && file.data[cursor] != '\n' && cursor < file.len) {
-//       cursor++;
-//       t.len++;
-//     }
-
-//     if (file.data[cursor] == '\n') {
-//       new_line = true;
-//     }
-//     cursor++;
-
-//     return t;
-//   };
-
-//   HashMap<Entry> entries;
-//   while (cursor < file.len) {
-//     Entry entry;
-//     entry.word = token();
-
-//     u32 parts_count = to_u32(token());
-
-//     for (i32 i = 0; i < parts_count; i++) {
-//       Part part = to_part(token());
-
-//       while (!new_line) {
-//         String synonym = token();
-//         Type type      = Type::NONE;
-
-//         if (synonym.data[synonym.len - 1] == ')') {
-//           String type_str;
-//           type_str.data = synonym.data + synonym.len - 1;
-//           type_str.len  = 1;
-//           synonym.len--;
-
-//           while (type_str.data[0] != '(') {
-//             type_str.data--;
-//             type_str.len++;
-//             synonym.len--;
-//           }
-//           synonym.len--;  // space
-
-//           type = to_type(type_str);
-//         }
-
-//         if (type == Type::SIMILAR || type == Type::GENERIC || type == Type::NONE) {
-//           entry.synonyms.append(synonym);
-//         }
-//       }
-//     }
-
-//     entries.emplace(entry.word, entry);
-//   }
-
-//   return entries;
-// }
\ No newline at end of file
+
+// a mythes style thesaurus: an encoding line, then for every word a "word|meaning count" line
+// followed by that many "(part)|synonym|synonym (type)|..." lines. only close synonyms are kept,
+// similar terms and untagged ones. a generic term is broader than the word ("animal" for "dog"),
+// so it would accept wrong answers. the words point into the file, which stays loaded for the life
+// of the process
+bool load_thesaurus(HashMap<Entry> *entries, const char *filename)
+{
+  entries->deinit();
+
+  FILE *file_handle = fopen(filename, "rb");
+  if (!file_handle) return false;
+  fclose(file_handle);
+
+  String file = read_file(filename);
+
+  u32 cursor  = 0;
+  b8 new_line = false;
+  auto token  = [&]() -> String {
+    String t = {};
+    t.data   = file.data + cursor;
+    t.len    = 0;
+
+    new_line = false;
+
+    while (cursor < file.len && file.data[cursor] != '|' && file.data[cursor] != '\n' &&
+           file.data[cursor] != '\r') {
+      cursor++;
+      t.len++;
+    }
+
+    if (cursor < file.len && file.data[cursor] == '\r') cursor++;
+    if (cursor >= file.len || file.data[cursor] == '\n') {
+      new_line = true;
+    }
+    cursor++;
+
+    return t;
+  };
+
+  // encoding
+  while (!new_line) token();
+
+  while (cursor < file.len) {
+    Entry entry;
+    entry.word = token();
+    if (new_line) continue;
+
+    u32 parts_count = to_u32(token());
+    for (u32 i = 0; i < parts_count && cursor < file.len; i++) {
+      token();  // part of speech
+
+      while (!new_line) {
+        String synonym = token();
+        Type type      = Type::NONE;
+
+        // a trailing "(similar term)" style tag says how the words are related
+        if (synonym.len && synonym.data[synonym.len - 1] == ')') {
+          u32 open = synonym.len - 1;
+          while (open > 0 && synonym.data[open] != '(') open--;
+
+          String type_str(synonym.data + open, synonym.len - open);
+          if (type_str == "(generic term)") type = Type::GENERIC;
+          if (type_str == "(related term)") type = Type::RELATED;
+          if (type_str == "(similar term)") type = Type::SIMILAR;
+          if (type_str == "(antonym)") type = Type::ANTONYM;
+
+          synonym.len = open;
+          while (synonym.len && synonym.data[synonym.len - 1] == ' ') synonym.len--;
+        }
+
+        if (synonym.len && (type == Type::SIMILAR || type == Type::NONE)) {
+          entry.synonyms.push_back(synonym);
+        }
+      }
+    }
+
+    entries->emplace(entry.word, std::move(entry));
+  }
+
+  return true;
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <string.h>
+
+#include "../common.hpp"
+#include "../util.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define CSV_SSE2
+#include <emmintrin.h>
+#endif
+
+// splits a csv buffer into fields 64 bytes at a time. each block is turned into bitmasks of its
+// quotes, commas and newlines, the quote mask is prefix-xored into a mask of the bytes inside
+// quotes, and whatever commas and newlines are left outside quotes are the field ends. fields are
+// then handed out by walking the set bits, so ordinary bytes are never looked at one by one.
+
+const u32 CSV_BLOCK = 64;
+
+// bit i is set where block[i] == c
+u64 csv_match(const char *block, char c)
+{
+#ifdef CSV_SSE2
+  __m128i needle = _mm_set1_epi8(c);
+  u64 mask       = 0;
+  for (u32 i = 0; i < CSV_BLOCK; i += 16) {
+    __m128i chunk = _mm_loadu_si128((__m128i *)(block + i));
+    mask |= (u64)(u32)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)) << i;
+  }
+  return mask;
+#else
+  u64 mask = 0;
+  for (u32 i = 0; i < CSV_BLOCK; i++) {
+    if (block[i] == c) mask |= 1ull << i;
+  }
+  return mask;
+#endif
+}
+
+// bit i is set when an odd number of bits at or below i are set in mask
+u64 prefix_xor(u64 mask)
+{
+  mask ^= mask << 1;
+  mask ^= mask << 2;
+  mask ^= mask << 4;
+  mask ^= mask << 8;
+  mask ^= mask << 16;
+  mask ^= mask << 32;
+  return mask;
+}
+
+void lowercase_ascii(String str)
+{
+  u32 i = 0;
+#ifdef CSV_SSE2
+  const __m128i before_a = _mm_set1_epi8('A' - 1);
+  const __m128i after_z  = _mm_set1_epi8('Z' + 1);
+  const __m128i to_lower = _mm_set1_epi8(0x20);
+  for (; i + 16 <= str.len; i += 16) {
+    __m128i chunk = _mm_loadu_si128((__m128i *)(str.data + i));
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(chunk, before_a), _mm_cmplt_epi8(chunk, after_z));
+    _mm_storeu_si128((__m128i *)(str.data + i),
+                     _mm_or_si128(chunk, _mm_and_si128(upper, to_lower)));
+  }
+#endif
+  for (; i < str.len; i++) {
+    if (str.data[i] >= 'A' && str.data[i] <= 'Z') str.data[i] = 'a' + str.data[i] - 'A';
+  }
+}
+
+struct CsvReader {
+  String file;
+
+  u32 scan_pos     = 0;  // start of the next block to scan
+  u32 block_start  = 0;  // start of the block ends describes
+  u64 ends         = 0;  // field ends in that block not handed out yet
+  u64 inside_quote = 0;  // all ones if the last block scanned ended inside quotes
+  u32 field_start  = 0;
+
+  CsvReader(String file) { this->file = file; }
+
+  // the next field with any surrounding quotes removed. end_of_line is set when it is the last
+  // field on its line. returns false once the file is used up
+  bool next(String *field, b8 *end_of_line)
+  {
+    while (!ends) {
+      if (scan_pos >= file.len) {
+        // a last line that isn't newline terminated. a trailing comma still ends in an empty field
+        b8 trailing_comma = field_start == file.len && file.len && file.data[file.len - 1] == ',';
+        if (field_start >= file.len && !trailing_comma) return false;
+        emit(file.len, field, end_of_line);
+        *end_of_line = true;
+        return true;
+      }
+      scan_block();
+    }
+
+    u32 end = block_start + __builtin_ctzll(ends);
+    ends &= ends - 1;
+    emit(end, field, end_of_line);
+    return true;
+  }
+
+  void scan_block()
+  {
+    block_start = scan_pos;
+    scan_pos += CSV_BLOCK;
+
+    // the tail is copied out so loads never run off the end of the buffer
+    const char *block = file.data + block_start;
+    char tail[CSV_BLOCK];
+    if (file.len - block_start < CSV_BLOCK) {
+      memset(tail, 0, CSV_BLOCK);
+      memcpy(tail, block, file.len - block_start);
+      block = tail;
+    }
+
+    u64 quoted   = prefix_xor(csv_match(block, '"')) ^ inside_quote;
+    inside_quote = (u64)((i64)quoted >> 63);
+
+    ends = (csv_match(block, ',') | csv_match(block, '\n')) & ~quoted;
+  }
+
+  void emit(u32 end, String *field, b8 *end_of_line)
+  {
+    *end_of_line = end >= file.len || file.data[end] == '\n';
+
+    String out(file.data + field_start, end - field_start);
+    field_start = end + 1;
+
+    if (out.len && out.data[out.len - 1] == '\r') out.len--;
+    if (out.len >= 2 && out.data[0] == '"' && out.data[out.len - 1] == '"') {
+      out.data++;
+      out.len -= 2;
+    }
+    *field = out;
+  }
+};
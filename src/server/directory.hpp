@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+
+#include "../common.hpp"
+#include "../game_state.hpp"
+
+// lobbies are partitioned across shard threads. the owning shard is encoded in the low bits of
+// every GameId so any thread can tell where a lobby lives.
+const int SHARD_BITS = 6;
+const int MAX_SHARDS = 1 << SHARD_BITS;
+
+i32 shard_of(GameId game_id) { return game_id & (MAX_SHARDS - 1); }
+
+struct LobbyListing {
+  GameId id = 0;
+  AllocatedString<64> name;
+  AllocatedString<64> owner;
+  bool is_self_hosted = false;
+  bool not_started    = false;
+  i32 num_players     = 0;
+
+  // the directory revision this listing last changed at. a removed lobby leaves its listing behind,
+  // marked removed, until the slot is reused
+  u32 revision = 0;
+  bool removed = false;
+};
+
+// what one shard last published about its lobbies, one listing per lobby slot. only lobbies that
+// changed are rewritten. there is a single writer (the owning shard) and any number of readers.
+// readers never block the writer: they copy what they need and retry if a publish raced them.
+struct ShardListings {
+  std::atomic<u32> seq = 0;
+
+  i32 slots = 0;  // one past the highest slot ever published
+  LobbyListing listings[MAX_GAMES];
+  Array<PlayerData, MAX_PLAYERS_PER_GAME> players[MAX_GAMES];
+
+  void begin_publish()
+  {
+    seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+  void end_publish() { seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  // copy_fn copies out whatever the caller needs. it can run more than once and must not act on
+  // what it copied until read() returns
+  template <typename FN>
+  void read(FN copy_fn)
+  {
+    while (true) {
+      u32 before = seq.load(std::memory_order_acquire);
+      if (before & 1) continue;
+
+      copy_fn();
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq.load(std::memory_order_relaxed) == before) return;
+    }
+  }
+
+  // copies the listings that changed after revision, up to and including upto, into out and their
+  // slots into out_slots. returns how many there were
+  i32 copy_changes(u32 revision, u32 upto, LobbyListing *out, i32 *out_slots)
+  {
+    i32 copied = 0;
+    read([&]() {
+      copied = 0;
+      for (i32 i = 0; i < std::min(slots, MAX_GAMES); i++) {
+        u32 changed = listings[i].revision;
+        if (changed > revision && changed <= upto) {
+          out[copied]         = listings[i];
+          out_slots[copied++] = i;
+        }
+      }
+    });
+    return copied;
+  }
+
+  bool copy_lobby(GameId game_id, LobbyListing *listing,
+                  Array<PlayerData, MAX_PLAYERS_PER_GAME> *out_players)
+  {
+    bool found = false;
+    read([&]() {
+      found       = false;
+      i32 copy_of = std::min(slots, MAX_GAMES);
+      for (i32 i = 0; i < copy_of; i++) {
+        if (listings[i].id == game_id && !listings[i].removed) {
+          *listing     = listings[i];
+          *out_players = players[i];
+          found        = true;
+          break;
+        }
+      }
+    });
+    return found && out_players->len <= MAX_PLAYERS_PER_GAME;
+  }
+};
+
+// ClientIds are generational handles so they stay unique for the life of a connection even as it
+// moves between shards. every shard's client table uses the same index bits
+const u32 ID_HANDLE_BITS   = 31;  // ids go out on the wire as positive i32s
+const u32 GAME_HANDLE_BITS = ID_HANDLE_BITS - SHARD_BITS;
+
+// state shared by every shard thread
+struct LobbyDirectory {
+  i32 shard_count       = 1;
+  ShardListings *shards = nullptr;
+
+  // taken by the acceptor on connect and by a shard on disconnect
+  std::mutex client_ids_mutex;
+  HandleAllocator client_ids;
+
+  std::atomic<i32> game_count = 0;
+
+  // bumped for every listing a shard publishes. shards publish one at a time and only move this
+  // once they're done, so every change up to revision can be read
+  std::mutex publish_mutex;
+  std::atomic<u32> revision = 0;
+
+  void init(i32 shard_count)
+  {
+    this->shard_count = shard_count;
+    shards            = new ShardListings[shard_count];
+    client_ids.init(MAX_CLIENTS, ID_HANDLE_BITS);
+  }
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "../common.hpp"
+#include "../net/generated_messages.hpp"
+#include "directory.hpp"
+
+// each shard's own copy of the lobbies open to join, across every shard, for ListGames pages and
+// the diffs pushed to clients browsing them. it only catches up with the directory when the
+// directory's revision moves, and then only copies the listings that changed, so browsing costs
+// nothing per request beyond copying a page out.
+//
+// a subscriber is sent what changed since the revision it last got. lobbies that closed (started,
+// ended or removed) are remembered for the last MAX_GAMES of them, a subscriber further behind
+// than that gets everything again as a diff against nothing (base 0).
+
+struct LobbyBrowser {
+  struct Entry {
+    LobbyListing listing;
+    i32 shard = 0;
+    i32 slot  = 0;
+  };
+  struct Closed {
+    GameId id    = 0;
+    u32 revision = 0;
+  };
+
+  u32 revision = 0;
+
+  // sorted by id, so pages stay put as lobbies come and go around them
+  Array<Entry, MAX_GAMES> entries;
+
+  Closed closed[MAX_GAMES];
+  u32 closed_count = 0;  // free running, the ring holds the last MAX_GAMES
+  u32 forgotten    = 0;  // newest revision that fell out of the ring
+
+  // scratch for one shard's changes
+  LobbyListing changes[MAX_GAMES];
+  i32 change_slots[MAX_GAMES];
+
+  // returns true if anything changed
+  bool update(LobbyDirectory *directory)
+  {
+    u32 latest = directory->revision.load(std::memory_order_acquire);
+    if (latest == revision) return false;
+
+    for (i32 shard = 0; shard < directory->shard_count; shard++) {
+      i32 count = directory->shards[shard].copy_changes(revision, latest, changes, change_slots);
+      for (i32 i = 0; i < count; i++) {
+        apply(shard, change_slots[i], &changes[i]);
+      }
+    }
+    revision = latest;
+    return true;
+  }
+
+  // listings are keyed by where they were published, a reused slot means the old lobby is gone
+  void apply(i32 shard, i32 slot, LobbyListing *listing)
+  {
+    bool open = !listing->removed && listing->not_started;
+
+    i32 at = -1;
+    for (i32 i = 0; i < entries.len; i++) {
+      if (entries[i].shard == shard && entries[i].slot == slot) at = i;
+    }
+    if (at >= 0 && (entries[at].listing.id != listing->id || !open)) {
+      close(entries[at].listing.id, listing->revision);
+      entries.shift_delete(at);
+      at = -1;
+    }
+    if (!open) return;
+
+    if (at >= 0) {
+      entries[at].listing = *listing;
+      return;
+    }
+    if (entries.len >= MAX_GAMES) return;
+
+    i32 insert_at = entries.len;
+    while (insert_at > 0 && entries[insert_at - 1].listing.id > listing->id) insert_at--;
+    entries.len++;
+    for (i32 i = entries.len - 1; i > insert_at; i--) {
+      entries[i] = entries[i - 1];
+    }
+    entries[insert_at] = {*listing, shard, slot};
+  }
+
+  void close(GameId id, u32 at_revision)
+  {
+    Closed *oldest = &closed[closed_count % MAX_GAMES];
+    if (closed_count >= MAX_GAMES) forgotten = std::max(forgotten, oldest->revision);
+    *oldest = {id, at_revision};
+    closed_count++;
+  }
+
+  static GameMetadata metadata(LobbyListing *listing)
+  {
+    GameMetadata game;
+    game.id             = listing->id;
+    game.name           = listing->name;
+    game.owner          = listing->owner;
+    game.num_players    = listing->num_players;
+    game.is_self_hosted = listing->is_self_hosted;
+    return game;
+  }
+
+  void page(u32 offset, u32 limit, ListGamesResponse *resp)
+  {
+    resp->revision = revision;
+    resp->total    = entries.len;
+    limit          = std::min(limit, (u32)resp->games.MAX_LEN);
+    for (u32 i = offset; i < (u32)entries.len && i - offset < limit; i++) {
+      resp->games.append(metadata(&entries[i].listing));
+    }
+  }
+
+  // what a subscriber that has base needs to catch up. a base this can't diff from, too old or from
+  // before a restart, gets everything
+  void diff(u32 base, LobbiesChangedMessage *msg)
+  {
+    if (base < forgotten || base > revision) base = 0;
+
+    msg->base     = base;
+    msg->revision = revision;
+    msg->changed.clear();
+    msg->removed.clear();
+    for (Entry &entry : entries) {
+      if (entry.listing.revision > base) msg->changed.append(metadata(&entry.listing));
+    }
+    if (!base) return;
+    for (u32 i = 0; i < std::min(closed_count, (u32)MAX_GAMES); i++) {
+      if (closed[i].revision > base) msg->removed.append({closed[i].id});
+    }
+  }
+};
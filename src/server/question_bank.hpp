@@ -0,0 +1,188 @@
+#pragma once
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "../common.hpp"
+#include "answer_parser.hpp"
+#include "question_db.hpp"
+
+// the question bank in use is an immutable, refcounted snapshot. a lobby takes a reference when a
+// round starts and keeps it until the next round, so answer indices it handed out stay valid even
+// if the bank is swapped underneath it. a watcher thread rebuilds the bank when the csvs (or the
+// compiled db) change on disk and publishes the result, the old snapshot goes away with its last
+// reference.
+
+struct QuestionBank {
+  QuestionDb db;
+  std::atomic<i32> refs = 1;  // the published pointer holds one
+  u32 generation        = 0;
+};
+
+struct QuestionBanks {
+  std::mutex mutex;
+  QuestionBank *current = nullptr;
+  u32 generation        = 0;
+
+  // the newest bank, referenced. nullptr only before the first publish
+  QuestionBank *acquire()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (current) current->refs++;
+    return current;
+  }
+
+  void release(QuestionBank *bank)
+  {
+    if (!bank) return;
+    if (--bank->refs == 0) {
+      printf("question bank %u retired\n", bank->generation);
+      bank->db.unload();
+      delete bank;
+    }
+  }
+
+  // takes over the caller's reference to bank
+  void publish(QuestionBank *bank)
+  {
+    QuestionBank *old;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      bank->generation = ++generation;
+      old              = current;
+      current          = bank;
+    }
+    printf("question bank %u: %u questions, %u answers\n", bank->generation,
+           bank->db.question_count(), bank->db.answer_count());
+    release(old);
+  }
+};
+QuestionBanks question_banks;
+
+// mtime and size of a file, 0 if it doesn't exist
+u64 file_signature(const char *filename)
+{
+  struct stat info;
+  if (stat(filename, &info) != 0) return 0;
+  return ((u64)info.st_mtime << 32) ^ (u64)info.st_size;
+}
+
+u64 file_mtime(const char *filename)
+{
+  struct stat info;
+  if (stat(filename, &info) != 0) return 0;
+  return (u64)info.st_mtime;
+}
+
+// compiles the csvs into a new bank. the compiled db is written out as a best effort so the next
+// startup can map it, but the bank itself is served from memory
+QuestionBank *build_question_bank(const char *db_filename)
+{
+  QuestionsAndAnswers qa = read_questions();
+  if (!qa.questions.count) return nullptr;
+
+  String compiled = build_question_db(&qa);
+  free_questions(&qa);
+  replace_file(db_filename, compiled);
+
+  QuestionBank *bank = new QuestionBank;
+  if (!bank->db.load_from_memory(compiled)) {
+    delete bank;
+    return nullptr;
+  }
+  return bank;
+}
+
+QuestionBank *map_question_bank(const char *db_filename)
+{
+  QuestionBank *bank = new QuestionBank;
+  if (!bank->db.load(db_filename)) {
+    delete bank;
+    return nullptr;
+  }
+  return bank;
+}
+
+// polls the csvs and the compiled db once a second. editors and copies don't write a file in one
+// go, so a change is only acted on once it has held still for a whole poll
+struct QuestionWatcher {
+  const char *db_filename = QUESTION_DB_PATH;
+  std::thread thread;
+
+  u64 csvs_seen = 0;  // signatures as of the last publish
+  u64 db_seen   = 0;
+  u64 csvs_last = 0;  // signatures as of the last poll
+  u64 db_last   = 0;
+
+  u64 csv_signature()
+  {
+    u64 signature = 0;
+    for (i32 i = 0; i < QUESTION_FILE_COUNT; i++) {
+      signature = signature * 31 + file_signature(QUESTION_FILES[i]);
+    }
+    return signature;
+  }
+
+  // loads the first bank, rebuilding the db if it is missing or older than the csvs
+  bool load()
+  {
+    u64 newest_csv = 0;
+    for (i32 i = 0; i < QUESTION_FILE_COUNT; i++) {
+      newest_csv = std::max(newest_csv, file_mtime(QUESTION_FILES[i]));
+    }
+
+    QuestionBank *bank = nullptr;
+    if (file_mtime(db_filename) >= newest_csv) bank = map_question_bank(db_filename);
+    if (!bank) {
+      printf("question db %s is missing or stale, compiling it from the csvs\n", db_filename);
+      bank = build_question_bank(db_filename);
+    }
+    if (!bank) return false;
+
+    csvs_seen = csvs_last = csv_signature();
+    db_seen = db_last     = file_signature(db_filename);
+    question_banks.publish(bank);
+    return true;
+  }
+
+  void start() { thread = std::thread(&QuestionWatcher::run, this); }
+
+  void run()
+  {
+    while (true) {
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+
+      u64 csvs   = csv_signature();
+      u64 db     = file_signature(db_filename);
+      b8 settled = csvs == csvs_last && db == db_last;
+      csvs_last  = csvs;
+      db_last    = db;
+      if (!settled) continue;
+
+      QuestionBank *bank = nullptr;
+      if (csvs != csvs_seen) {
+        printf("question csvs changed, rebuilding the question bank\n");
+        bank = build_question_bank(db_filename);
+      } else if (db != db_seen && db) {
+        printf("question db %s changed, reloading it\n", db_filename);
+        bank = map_question_bank(db_filename);
+      } else {
+        continue;
+      }
+
+      // our own write of the db shouldn't trigger another reload, and a broken update is only
+      // retried once the files change again
+      csvs_seen = csvs_last = csvs;
+      db_seen = db_last     = file_signature(db_filename);
+      if (!bank) {
+        printf("keeping question bank %u\n", question_banks.generation);
+        continue;
+      }
+      question_banks.publish(bank);
+    }
+  }
+};
@@ -0,0 +1,508 @@
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../common.hpp"
+#include "../util.hpp"
+#include "answer_parser.hpp"
+
+// the question bank, precompiled by fracas_questions into one flat file that the server maps
+// read-only at startup. nothing is parsed or copied: every String handed out points straight into
+// the mapping, so startup cost and resident memory don't grow with the bank.
+//
+// layout, all little-endian and every section 8 byte aligned:
+//   QuestionDbHeader
+//   QuestionRecord[question_count]
+//   Answer[answer_ref_count]       scores and answer pool indices, questions index into this
+//   StringRecord[answer_count]     the sorted, deduped answer pool
+//   u32[answer_count]              answer weights, the points each answer is worth across the bank
+//   u32[2 * answer_count]          completion tree, see complete()
+//   char[chars_len]                question and answer text
+
+const char *QUESTION_DB_PATH  = "./src/server/questions.db";
+const u32 QUESTION_DB_MAGIC   = 'F' | ('Q' << 8) | ('D' << 16) | ('B' << 24);
+const u32 QUESTION_DB_VERSION = 2;
+
+const i32 MAX_COMPLETIONS = 32;
+
+struct QuestionDbHeader {
+  u32 magic;
+  u32 version;
+  u32 file_size;
+
+  u32 question_count;
+  u32 answer_ref_count;
+  u32 answer_count;
+  u32 chars_len;
+
+  u32 questions_offset;
+  u32 answer_refs_offset;
+  u32 answers_offset;
+  u32 weights_offset;
+  u32 completion_tree_offset;
+  u32 chars_offset;
+};
+
+struct QuestionRecord {
+  u32 text_offset;
+  u16 text_len;
+  u16 answer_count;
+  u32 first_answer;
+};
+
+struct StringRecord {
+  u32 offset;
+  u32 len;
+};
+
+u32 align_db_offset(u32 offset) { return (offset + 7) & ~7u; }
+
+struct QuestionDb {
+  u8 *base  = nullptr;
+  u64 size  = 0;
+  u32 count = 0;
+
+  b8 owns_buffer = false;  // loaded from memory rather than mapped
+
+  QuestionDbHeader *header  = nullptr;
+  QuestionRecord *questions = nullptr;
+  Answer *answer_refs       = nullptr;
+  StringRecord *answers     = nullptr;
+  u32 *weights              = nullptr;
+  u32 *completion_tree      = nullptr;
+  char *chars               = nullptr;
+
+#ifdef _WIN32
+  HANDLE file    = INVALID_HANDLE_VALUE;
+  HANDLE mapping = nullptr;
+#endif
+
+  bool load(const char *filename)
+  {
+    if (!map(filename)) return false;
+    if (!validate()) {
+      printf("question db %s is corrupt or from another version\n", filename);
+      unload();
+      return false;
+    }
+    return true;
+  }
+
+  // takes ownership of a compiled db that only exists in memory, freeing it on unload
+  bool load_from_memory(String compiled)
+  {
+    base        = (u8 *)compiled.data;
+    size        = compiled.len;
+    owns_buffer = true;
+    if (size < sizeof(QuestionDbHeader) || !validate()) {
+      printf("compiled question db is corrupt\n");
+      unload();
+      return false;
+    }
+    return true;
+  }
+
+  void unload()
+  {
+    if (owns_buffer) {
+      free(base);
+      owns_buffer = false;
+      base        = nullptr;
+    }
+#ifdef _WIN32
+    if (base) UnmapViewOfFile(base);
+    if (mapping) CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+    mapping = nullptr;
+    file    = INVALID_HANDLE_VALUE;
+#else
+    if (base) munmap(base, size);
+#endif
+    base   = nullptr;
+    size   = 0;
+    count  = 0;
+    header = nullptr;
+  }
+
+  u32 question_count() { return count; }
+  u32 answer_count() { return header ? header->answer_count : 0; }
+
+  Question question(u32 i)
+  {
+    assert(i < count);
+    QuestionRecord *record = &questions[i];
+
+    Question q;
+    q.text = String(chars + record->text_offset, record->text_len);
+    for (u32 a = 0; a < record->answer_count; a++) {
+      q.answers.append(answer_refs[record->first_answer + a]);
+    }
+    return q;
+  }
+
+  String answer(u32 i)
+  {
+    assert(i < answer_count());
+    return String(chars + answers[i].offset, answers[i].len);
+  }
+
+  // the range [*first, *last) of pool answers that start with prefix. the pool is sorted, so this
+  // is a binary search that tracks how much of the prefix the answers at either bound share with
+  // it: everything between them shares at least the smaller of the two, so those characters are
+  // never compared again
+  void prefix_range(String prefix, u32 *first, u32 *last)
+  {
+    *first = prefix_bound(prefix, false);
+    *last  = prefix_bound(prefix, true);
+  }
+
+  // up to k answers starting with prefix, heaviest first, written to out as pool indices.
+  // the completion tree is a flattened segment tree holding the heaviest answer of each node's
+  // range, so the best answer of any range takes O(log n). ranges are pulled from a small
+  // frontier: take the heaviest, then push what's left either side of its answer
+  i32 complete(String prefix, u32 *out, i32 k)
+  {
+    k = std::min(k, MAX_COMPLETIONS);
+
+    u32 first, last;
+    prefix_range(prefix, &first, &last);
+    if (first >= last || k <= 0) return 0;
+
+    struct Range {
+      u32 first, last, best;
+    };
+    Range frontier[MAX_COMPLETIONS * 2 + 1];
+    i32 frontier_len = 0;
+
+    frontier[frontier_len++] = {first, last, heaviest(first, last)};
+
+    i32 found = 0;
+    while (found < k && frontier_len) {
+      i32 pick = 0;
+      for (i32 i = 1; i < frontier_len; i++) {
+        if (heavier(frontier[i].best, frontier[pick].best)) pick = i;
+      }
+      Range range    = frontier[pick];
+      frontier[pick] = frontier[--frontier_len];
+      out[found++]   = range.best;
+
+      if (range.first < range.best) {
+        frontier[frontier_len++] = {range.first, range.best, heaviest(range.first, range.best)};
+      }
+      if (range.best + 1 < range.last) {
+        frontier[frontier_len++] = {range.best + 1, range.last,
+                                    heaviest(range.best + 1, range.last)};
+      }
+    }
+    return found;
+  }
+
+  bool heavier(u32 a, u32 b)
+  {
+    return weights[a] > weights[b] || (weights[a] == weights[b] && a < b);
+  }
+
+  // heaviest answer in [first, last), which must not be empty
+  u32 heaviest(u32 first, u32 last)
+  {
+    u32 n    = answer_count();
+    u32 best = first;
+    for (first += n, last += n; first < last; first /= 2, last /= 2) {
+      if (first & 1) {
+        u32 candidate = completion_tree[first++];
+        if (heavier(candidate, best)) best = candidate;
+      }
+      if (last & 1) {
+        u32 candidate = completion_tree[--last];
+        if (heavier(candidate, best)) best = candidate;
+      }
+    }
+    return best;
+  }
+
+  // the first answer not ordered before prefix, or with upper set, the first ordered after it.
+  // only the first prefix.len characters of an answer take part
+  u32 prefix_bound(String prefix, bool upper)
+  {
+    i64 low         = -1;
+    i64 high        = answer_count();
+    u32 low_shared  = 0;
+    u32 high_shared = 0;
+    while (high - low > 1) {
+      i64 mid       = (low + high) / 2;
+      String answer = this->answer(mid);
+
+      u32 shared = std::min(low_shared, high_shared);
+      while (shared < prefix.len && shared < answer.len &&
+             answer.data[shared] == prefix.data[shared]) {
+        shared++;
+      }
+
+      i32 cmp;
+      if (shared == prefix.len) {
+        cmp = 0;
+      } else if (shared == answer.len) {
+        cmp = -1;
+      } else {
+        cmp = (u8)answer.data[shared] < (u8)prefix.data[shared] ? -1 : 1;
+      }
+
+      if (cmp < 0 || (upper && cmp == 0)) {
+        low        = mid;
+        low_shared = shared;
+      } else {
+        high        = mid;
+        high_shared = shared;
+      }
+    }
+    return high;
+  }
+
+  bool map(const char *filename)
+  {
+#ifdef _WIN32
+    file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) ||
+        file_size.QuadPart < (LONGLONG)sizeof(QuestionDbHeader)) {
+      unload();
+      return false;
+    }
+    size = file_size.QuadPart;
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+      unload();
+      return false;
+    }
+    base = (u8 *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!base) {
+      unload();
+      return false;
+    }
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(QuestionDbHeader)) {
+      close(fd);
+      return false;
+    }
+    size = st.st_size;
+
+    // the mapping keeps the file alive, the descriptor isn't needed past this
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+      size = 0;
+      return false;
+    }
+    base = (u8 *)mapped;
+#endif
+    return true;
+  }
+
+  // bounds check every section once so lookups never have to
+  bool validate()
+  {
+    header = (QuestionDbHeader *)base;
+    if (header->magic != QUESTION_DB_MAGIC || header->version != QUESTION_DB_VERSION ||
+        header->file_size != size) {
+      return false;
+    }
+
+    auto section_fits = [&](u32 offset, u64 bytes) {
+      return offset % 8 == 0 && offset >= sizeof(QuestionDbHeader) && offset + bytes <= size;
+    };
+    if (!section_fits(header->questions_offset,
+                      (u64)header->question_count * sizeof(QuestionRecord)) ||
+        !section_fits(header->answer_refs_offset, (u64)header->answer_ref_count * sizeof(Answer)) ||
+        !section_fits(header->answers_offset, (u64)header->answer_count * sizeof(StringRecord)) ||
+        !section_fits(header->weights_offset, (u64)header->answer_count * sizeof(u32)) ||
+        !section_fits(header->completion_tree_offset,
+                      (u64)header->answer_count * 2 * sizeof(u32)) ||
+        !section_fits(header->chars_offset, header->chars_len)) {
+      return false;
+    }
+
+    questions       = (QuestionRecord *)(base + header->questions_offset);
+    answer_refs     = (Answer *)(base + header->answer_refs_offset);
+    answers         = (StringRecord *)(base + header->answers_offset);
+    weights         = (u32 *)(base + header->weights_offset);
+    completion_tree = (u32 *)(base + header->completion_tree_offset);
+    chars           = (char *)(base + header->chars_offset);
+
+    for (u32 i = 0; i < header->question_count; i++) {
+      QuestionRecord q = questions[i];
+      if ((u64)q.text_offset + q.text_len > header->chars_len ||
+          (u64)q.first_answer + q.answer_count > header->answer_ref_count || q.answer_count > 8) {
+        return false;
+      }
+    }
+    for (u32 i = 0; i < header->answer_ref_count; i++) {
+      if (answer_refs[i].index < 0 || (u32)answer_refs[i].index >= header->answer_count) {
+        return false;
+      }
+    }
+    for (u32 i = 0; i < header->answer_count; i++) {
+      if ((u64)answers[i].offset + answers[i].len > header->chars_len) return false;
+    }
+    for (u32 i = header->answer_count ? 1 : 0; i < header->answer_count * 2; i++) {
+      if (completion_tree[i] >= header->answer_count) return false;
+    }
+
+    count = header->question_count;
+    return true;
+  }
+};
+
+// writes data next to filename and then moves it over filename, so anything that has the old file
+// mapped keeps seeing the old contents instead of a half written file. on windows a file can't be
+// replaced while it is mapped, in which case this fails and leaves the old file alone
+bool replace_file(const char *filename, String data)
+{
+  char temp_name[512];
+  snprintf(temp_name, sizeof(temp_name), "%s.tmp", filename);
+
+  FILE *file_handle = fopen(temp_name, "wb");
+  if (!file_handle) {
+    printf("ERROR writing file: %s\n", temp_name);
+    return false;
+  }
+  size_t written = fwrite(data.data, 1, data.len, file_handle);
+  fclose(file_handle);
+  if (written != data.len) {
+    printf("ERROR writing file: %s\n", temp_name);
+    remove(temp_name);
+    return false;
+  }
+
+#ifdef _WIN32
+  bool replaced = MoveFileExA(temp_name, filename, MOVEFILE_REPLACE_EXISTING);
+#else
+  bool replaced = rename(temp_name, filename) == 0;
+#endif
+  if (!replaced) {
+    printf("ERROR replacing file: %s\n", filename);
+    remove(temp_name);
+  }
+  return replaced;
+}
+
+// flattens parsed questions into the on-disk layout. used by the offline compiler, and by the
+// server when it has to rebuild a missing or stale db
+String build_question_db(QuestionsAndAnswers *qa)
+{
+  u32 answer_ref_count = 0;
+  u32 chars_len        = 0;
+  for (u32 i = 0; i < qa->questions.count; i++) {
+    answer_ref_count += qa->questions[i].answers.len;
+    chars_len += qa->questions[i].text.len;
+  }
+  for (u32 i = 0; i < qa->answers.count; i++) {
+    chars_len += qa->answers[i].len;
+  }
+
+  QuestionDbHeader header   = {};
+  header.magic              = QUESTION_DB_MAGIC;
+  header.version            = QUESTION_DB_VERSION;
+  header.question_count     = qa->questions.count;
+  header.answer_ref_count   = answer_ref_count;
+  header.answer_count       = qa->answers.count;
+  header.chars_len          = chars_len;
+  header.questions_offset   = align_db_offset(sizeof(QuestionDbHeader));
+  header.answer_refs_offset = align_db_offset(header.questions_offset +
+                                              header.question_count * sizeof(QuestionRecord));
+  header.answers_offset =
+      align_db_offset(header.answer_refs_offset + answer_ref_count * sizeof(Answer));
+  header.weights_offset =
+      align_db_offset(header.answers_offset + header.answer_count * sizeof(StringRecord));
+  header.completion_tree_offset =
+      align_db_offset(header.weights_offset + header.answer_count * sizeof(u32));
+  header.chars_offset =
+      align_db_offset(header.completion_tree_offset + header.answer_count * 2 * sizeof(u32));
+  header.file_size = align_db_offset(header.chars_offset + chars_len);
+
+  String out;
+  out.len  = header.file_size;
+  out.data = (char *)calloc(out.len, 1);
+
+  Ser ser;
+  ser.buf = (u8 *)out.data;
+  ser.add(header);
+
+  u32 chars_pos  = 0;
+  u32 answer_pos = 0;
+  ser.pos        = header.questions_offset;
+  for (u32 i = 0; i < qa->questions.count; i++) {
+    Question &q = qa->questions[i];
+    assert(q.text.len <= UINT16_MAX);
+
+    QuestionRecord record;
+    record.text_offset  = chars_pos;
+    record.text_len     = q.text.len;
+    record.answer_count = q.answers.len;
+    record.first_answer = answer_pos;
+    ser.add(record);
+
+    memcpy(out.data + header.chars_offset + chars_pos, q.text.data, q.text.len);
+    chars_pos += q.text.len;
+    answer_pos += q.answers.len;
+  }
+
+  ser.pos = header.answer_refs_offset;
+  for (u32 i = 0; i < qa->questions.count; i++) {
+    for (u32 a = 0; a < qa->questions[i].answers.len; a++) {
+      ser.add(qa->questions[i].answers[a]);
+    }
+  }
+
+  ser.pos = header.answers_offset;
+  for (u32 i = 0; i < qa->answers.count; i++) {
+    String answer = qa->answers[i];
+    ser.add(StringRecord{chars_pos, answer.len});
+
+    memcpy(out.data + header.chars_offset + chars_pos, answer.data, answer.len);
+    chars_pos += answer.len;
+  }
+
+  // an answer's weight is every point it is worth across the bank, so completions favour the
+  // answers that come up most
+  u32 *weights = (u32 *)(out.data + header.weights_offset);
+  for (u32 i = 0; i < qa->questions.count; i++) {
+    for (u32 a = 0; a < qa->questions[i].answers.len; a++) {
+      Answer answer = qa->questions[i].answers[a];
+      weights[answer.index] += std::max(answer.score, 1);
+    }
+  }
+
+  // leaves hold the answers themselves, each parent the heavier of its children
+  u32 n     = header.answer_count;
+  u32 *tree = (u32 *)(out.data + header.completion_tree_offset);
+  for (u32 i = 0; i < n; i++) {
+    tree[n + i] = i;
+  }
+  for (u32 i = n ? n - 1 : 0; i > 0; i--) {
+    u32 left  = tree[2 * i];
+    u32 right = tree[2 * i + 1];
+    tree[i]   = weights[left] > weights[right] || (weights[left] == weights[right] && left < right)
+                    ? left
+                    : right;
+  }
+
+  return out;
+}
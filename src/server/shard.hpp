@@ -0,0 +1,276 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../common.hpp"
+#include "../lobby.hpp"
+#include "../net/net.hpp"
+#include "../net/poller.hpp"
+#include "directory.hpp"
+
+// the main thread only accepts connections. every client and every lobby belongs to exactly one
+// shard thread, which does all the socket io and game logic for them without taking any locks.
+// players of a lobby always share its shard: a client that joins a lobby owned by another shard is
+// handed over to that shard before the join is handled.
+
+// the wakeup socket and ClientIds share the poller's key space, so it sits above any ClientId
+const u64 WAKE_KEY = ~0ull;
+
+// how often a shard republishes its lobbies to the directory while they are changing
+const uint64_t PUBLISH_INTERVAL = second / 20;
+
+struct Shard {
+  i32 index = 0;
+  ServerData server_data;
+  Poller poller;
+
+  SOCKET wake_read  = INVALID_SOCKET;
+  SOCKET wake_write = INVALID_SOCKET;
+
+  // clients handed over by the acceptor or by other shards, waiting to be adopted
+  std::mutex inbox_mutex;
+  std::vector<Client> inbox;
+
+  struct Shards *shards = nullptr;
+  std::thread thread;
+
+  void hand_off(Client client)
+  {
+    {
+      std::lock_guard<std::mutex> lock(inbox_mutex);
+      inbox.push_back(client);
+    }
+
+    char wake = 1;
+    send_some(wake_write, &wake, 1);
+  }
+
+  void run();
+  void adopt(Client client, RpcServer *rpc_server);
+  void read_client(ClientId client_id, RpcServer *rpc_server);
+  i32 route(Client *client, char *msg, int msg_len);
+  void migrate(Client *client, i32 target);
+  void drop_client(ClientId client_id, RpcServer *rpc_server);
+};
+
+struct Shards {
+  i32 count     = 0;
+  Shard *shards = nullptr;
+  LobbyDirectory directory;
+
+  void start(i32 shard_count)
+  {
+    count  = shard_count;
+    shards = new Shard[count];
+    directory.init(count);
+
+    for (i32 i = 0; i < count; i++) {
+      Shard *shard  = &shards[i];
+      shard->index  = i;
+      shard->shards = this;
+      shard->server_data.init(&directory, i);
+      if (!open_wakeup_pair(&shard->wake_read, &shard->wake_write)) {
+        assert(false);
+      }
+    }
+
+    for (i32 i = 0; i < count; i++) {
+      shards[i].thread = std::thread(&Shard::run, &shards[i]);
+    }
+  }
+};
+
+void Shard::run()
+{
+  tmp.init(10 * 1000);
+  char arena_name[32];
+  snprintf(arena_name, sizeof(arena_name), "shard %d tmp", index);
+  tmp.track(arena_name);
+
+  RpcServer rpc_server{&server_data};
+
+  poller.init(MAX_CLIENTS + 1);
+  poller.add(wake_read, WAKE_KEY, POLL_READ);
+
+  TimerWheel *timers = &server_data.timers;
+
+  PollEvent events[MAX_POLL_EVENTS];
+  std::vector<Client> adopting;
+
+  auto start_time  = std::chrono::steady_clock::now();
+  u64 last_publish = 0;
+  while (true) {
+    // sleep until a socket is ready, the next timer is due, or changes need publishing
+    u64 until_next = timers->time_until_next();
+    if (server_data.changed_listings.len) {
+      u64 since_publish = timers->now - last_publish;
+      u64 until_publish = since_publish < PUBLISH_INTERVAL ? PUBLISH_INTERVAL - since_publish : 0;
+      until_next        = std::min(until_next, until_publish);
+    }
+    // what other shards publish is only noticed on waking up
+    if (server_data.lobby_subscribers.len) until_next = std::min(until_next, PUBLISH_INTERVAL);
+    i64 timeout_ms  = until_next == TIMER_NEVER ? -1 : (i64)((until_next + 999999) / 1000000);
+    int event_count = poller.wait(events, MAX_POLL_EVENTS, timeout_ms);
+
+    u64 now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now() - start_time)
+                  .count();
+    timers->advance(now, [&](u64 key, u32 kind) {
+      Lobby *lobby = server_data.get_lobby((GameId)key);
+      if (!lobby) return;
+
+      lobby->on_timer({&rpc_server, lobby}, kind);
+      if (lobby->stage == LobbyStage::DEAD) {
+        remove_game(&server_data, (GameId)key);
+      }
+    });
+
+    for (int e = 0; e < event_count; e++) {
+      PollEvent event = events[e];
+
+      if (event.key == WAKE_KEY) {
+        char drain[64];
+        while (recv_some(wake_read, drain, sizeof(drain)) > 0) {
+        }
+
+        {
+          std::lock_guard<std::mutex> lock(inbox_mutex);
+          adopting.swap(inbox);
+        }
+        for (Client &client : adopting) {
+          adopt(client, &rpc_server);
+        }
+        adopting.clear();
+        continue;
+      }
+
+      ClientId client_id = (ClientId)event.key;
+      Client *client     = server_data.get_client(client_id);
+      if (!client) continue;
+
+      if (event.events & POLL_WRITE) {
+        client->peer.flush();
+      }
+      read_client(client_id, &rpc_server);
+
+      // whatever it sent before hanging up has been handled, unless it moved shards on the way
+      if ((event.events & POLL_HANGUP) && server_data.get_client(client_id)) {
+        drop_client(client_id, &rpc_server);
+      }
+    }
+
+    if (server_data.changed_listings.len && timers->now - last_publish >= PUBLISH_INTERVAL) {
+      publish_listings(&server_data);
+      last_publish = timers->now;
+    }
+    if (server_data.lobby_subscribers.len) push_lobby_changes(&server_data);
+
+    tmp.reset();
+  }
+}
+
+void Shard::adopt(Client client, RpcServer *rpc_server)
+{
+  Client *added = add_client(&server_data, client);
+  if (!added) {
+    close_socket(client.peer.s);
+    return;
+  }
+  if (!poller.add(added->peer.s, added->client_id, POLL_READ)) {
+    close_socket(added->peer.s);
+    remove_client(&server_data, added->client_id);
+    return;
+  }
+
+  // write interest belonged to the old poller, so start clean and let flush() re-arm it
+  added->peer.wants_writable = false;
+  added->peer.watch(&poller, added->client_id);
+  added->peer.flush();
+
+  // a client can be handed over while it's on the lobby browser
+  if (added->browsing) server_data.lobby_subscribers.append(added->client_id);
+
+  // a migrated client usually arrives with the message that moved it still buffered
+  read_client(added->client_id, rpc_server);
+}
+
+void Shard::read_client(ClientId client_id, RpcServer *rpc_server)
+{
+  Client *client = server_data.get_client(client_id);
+
+  int msg_len;
+  char *msg;
+  while ((msg_len = client->peer.recieve_msg(&msg)) > 0) {
+    // nothing else is read until the client has shown it speaks our schema
+    if (!client->greeted) {
+      if (!read_hello(msg, msg_len)) {
+        printf("Dropping peer, it was built from a different rpc schema\n");
+        client->peer.disconnect();
+        break;
+      }
+      client->greeted = true;
+      continue;
+    }
+
+    i32 target = route(client, msg, msg_len);
+    if (target != index) {
+      client->peer.rewind_message();
+      migrate(client, target);
+      return;
+    }
+
+    if (!rpc_server->handle_rpc(client->client_id, &client->peer, msg, msg_len)) {
+      client->peer.disconnect();
+      break;
+    }
+    client->peer.pop_message();
+  }
+
+  if (!client->peer.is_connected()) {
+    drop_client(client_id, rpc_server);
+  }
+}
+
+// the shard that should handle this message
+i32 Shard::route(Client *client, char *msg, int msg_len)
+{
+  if (client->game_id || (Rpc)msg[0] != Rpc::JoinGame) return index;
+
+  JoinGameRequest req;
+  MessageReader in(msg + 1, msg_len - 1);
+  if (!read(&in, &req)) return index;
+
+  i32 target = shard_of(req.game_id);
+  return target < shards->count ? target : index;
+}
+
+void Shard::migrate(Client *client, i32 target)
+{
+  ClientId client_id = client->client_id;
+
+  // the socket stays open, only this thread lets go of it
+  poller.remove(client->peer.s);
+  client->peer.poller = nullptr;
+
+  // queued broadcasts are shared with peers staying here, send what the socket takes now and copy
+  // the rest
+  client->peer.flush();
+  client->peer.unshare_send_queue();
+
+  // the ClientId stays reserved, it moves with the connection
+  Client moving = *client;
+  server_data.clients.remove(client_id);
+  shards->shards[target].hand_off(moving);
+}
+
+void Shard::drop_client(ClientId client_id, RpcServer *rpc_server)
+{
+  SOCKET socket = server_data.get_client(client_id)->peer.s;
+  poller.remove(socket);
+  close_socket(socket);
+  rpc_server->on_disconnect(client_id);
+  remove_client(&server_data, client_id);
+}
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <stdlib.h>
+
+#include "../common.hpp"
+
+// hierarchical timer wheel. deadlines are rounded up to TIMER_TICK and kept in LEVELS wheels of
+// 64 slots each, every level 64 times coarser than the one below. timers in the coarser levels
+// are cascaded down as their slot comes around, so scheduling, cancelling and firing are all
+// O(1), and the time until the next expiry is found from per-level occupancy bitmaps instead of
+// by walking timers.
+
+typedef u64 TimerId;  // 0 is never a valid timer
+
+const u64 TIMER_TICK         = 1000000;  // 1ms in ns
+const int TIMER_LEVEL_BITS   = 6;
+const int TIMER_SLOTS        = 1 << TIMER_LEVEL_BITS;
+const int TIMER_LEVELS       = 4;  // covers 2^24 ticks, about 4.6 hours
+const u64 TIMER_MAX_TICKS    = (1ull << (TIMER_LEVEL_BITS * TIMER_LEVELS)) - 1;
+const u64 TIMER_NEVER        = ~0ull;
+const u8 TIMER_LEVEL_FIRING  = 0xFE;
+const u8 TIMER_LEVEL_UNUSED  = 0xFF;
+
+struct Timer {
+  Timer *prev = nullptr;
+  Timer *next = nullptr;
+
+  u64 expiry_tick = 0;
+  u64 key         = 0;
+  u32 kind        = 0;
+  u32 generation  = 0;
+  u8 level        = TIMER_LEVEL_UNUSED;
+  u8 slot         = 0;
+};
+
+struct TimerWheel {
+  // each slot is a circular list around a sentinel
+  Timer slots[TIMER_LEVELS][TIMER_SLOTS];
+  u64 occupied[TIMER_LEVELS] = {};
+  Timer firing;
+
+  // fixed pool, so scheduling never allocates once the wheel is up
+  Timer *pool      = nullptr;
+  Timer *free_list = nullptr;
+  u32 capacity     = 0;
+  u32 active       = 0;
+
+  u64 current_tick = 0;  // next tick that hasn't been processed yet
+  u64 now          = 0;  // ns, as of the last advance()
+
+  void init(u32 capacity)
+  {
+    this->capacity = capacity;
+    pool           = (Timer *)calloc(capacity, sizeof(Timer));
+    for (u32 i = 0; i < capacity; i++) {
+      pool[i].level = TIMER_LEVEL_UNUSED;
+      pool[i].next  = i + 1 < capacity ? &pool[i + 1] : nullptr;
+    }
+    free_list = capacity ? &pool[0] : nullptr;
+
+    for (int level = 0; level < TIMER_LEVELS; level++) {
+      for (int slot = 0; slot < TIMER_SLOTS; slot++) {
+        slots[level][slot].prev = slots[level][slot].next = &slots[level][slot];
+      }
+    }
+    firing.prev = firing.next = &firing;
+  }
+
+  void deinit()
+  {
+    free(pool);
+    pool      = nullptr;
+    free_list = nullptr;
+    active    = 0;
+  }
+
+  // key and kind are handed back to the callback passed to advance() when the timer fires
+  TimerId schedule(u64 delay, u64 key, u32 kind)
+  {
+    if (!free_list) {
+      printf("timer pool is exhausted\n");
+      return 0;
+    }
+
+    Timer *timer = free_list;
+    free_list    = timer->next;
+    active++;
+
+    // round up so a timer never fires early
+    timer->expiry_tick = (now + delay + TIMER_TICK - 1) / TIMER_TICK;
+    timer->key         = key;
+    timer->kind        = kind;
+    timer->generation++;
+    insert(timer);
+
+    return ((u64)timer->generation << 32) | (u64)(timer - pool + 1);
+  }
+
+  // cancelling a timer that already fired or was already cancelled does nothing
+  void cancel(TimerId id)
+  {
+    Timer *timer = lookup(id);
+    if (!timer) return;
+
+    unlink(timer);
+    release(timer);
+  }
+
+  // ns until the next timer fires or needs cascading, TIMER_NEVER if nothing is scheduled
+  u64 time_until_next()
+  {
+    u64 tick = next_event_tick();
+    if (tick == TIMER_NEVER) return TIMER_NEVER;
+
+    u64 at = tick * TIMER_TICK;
+    return at > now ? at - now : 0;
+  }
+
+  // fires everything due by now_ns, calling fire(key, kind) for each. callbacks may schedule and
+  // cancel timers, including ones due in the same advance
+  template <typename FN>
+  void advance(u64 now_ns, FN fire)
+  {
+    now          = now_ns;
+    u64 end_tick = now_ns / TIMER_TICK;
+
+    while (current_tick <= end_tick) {
+      u64 tick = next_event_tick();
+      if (tick > end_tick) {
+        current_tick = end_tick + 1;
+        break;
+      }
+      current_tick = tick;
+
+      // pull coarser levels down first, highest level first, so anything due this tick lands in
+      // the level 0 slot about to fire
+      for (int level = TIMER_LEVELS - 1; level > 0; level--) {
+        u64 span = 1ull << (TIMER_LEVEL_BITS * level);
+        if (tick & (span - 1)) continue;
+
+        int slot = (tick >> (TIMER_LEVEL_BITS * level)) & (TIMER_SLOTS - 1);
+        cascade(level, slot);
+      }
+
+      // detach the slot before firing so anything rescheduled for this tick goes to the next one
+      int slot    = tick & (TIMER_SLOTS - 1);
+      Timer *head = &slots[0][slot];
+      if (head->next != head) {
+        firing.next       = head->next;
+        firing.prev       = head->prev;
+        firing.next->prev = &firing;
+        firing.prev->next = &firing;
+        head->prev = head->next = head;
+        occupied[0] &= ~(1ull << slot);
+
+        for (Timer *t = firing.next; t != &firing; t = t->next) {
+          t->level = TIMER_LEVEL_FIRING;
+        }
+      }
+      current_tick = tick + 1;
+
+      while (firing.next != &firing) {
+        Timer *timer = firing.next;
+        u64 key      = timer->key;
+        u32 kind     = timer->kind;
+        unlink(timer);
+        release(timer);
+
+        fire(key, kind);
+      }
+    }
+  }
+
+  Timer *lookup(TimerId id)
+  {
+    u32 index = (u32)id;
+    if (index == 0 || index > capacity) return nullptr;
+
+    Timer *timer = &pool[index - 1];
+    if (timer->generation != (u32)(id >> 32) || timer->level == TIMER_LEVEL_UNUSED) return nullptr;
+    return timer;
+  }
+
+  void insert(Timer *timer)
+  {
+    u64 tick = timer->expiry_tick;
+    if (tick < current_tick) tick = current_tick;
+    u64 delta = tick - current_tick;
+    if (delta > TIMER_MAX_TICKS) {
+      delta = TIMER_MAX_TICKS;
+      tick  = current_tick + delta;
+    }
+
+    int level = 0;
+    while (level < TIMER_LEVELS - 1 && delta >= (1ull << (TIMER_LEVEL_BITS * (level + 1)))) {
+      level++;
+    }
+    int slot = (tick >> (TIMER_LEVEL_BITS * level)) & (TIMER_SLOTS - 1);
+
+    Timer *head      = &slots[level][slot];
+    timer->level     = level;
+    timer->slot      = slot;
+    timer->prev      = head->prev;
+    timer->next      = head;
+    head->prev->next = timer;
+    head->prev       = timer;
+    occupied[level] |= 1ull << slot;
+  }
+
+  void unlink(Timer *timer)
+  {
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+
+    if (timer->level < TIMER_LEVELS) {
+      Timer *head = &slots[timer->level][timer->slot];
+      if (head->next == head) occupied[timer->level] &= ~(1ull << timer->slot);
+    }
+    timer->prev = timer->next = nullptr;
+  }
+
+  void release(Timer *timer)
+  {
+    timer->level = TIMER_LEVEL_UNUSED;
+    timer->next  = free_list;
+    free_list    = timer;
+    active--;
+  }
+
+  void cascade(int level, int slot)
+  {
+    Timer *head = &slots[level][slot];
+    while (head->next != head) {
+      Timer *timer = head->next;
+      unlink(timer);
+      insert(timer);
+    }
+  }
+
+  // the first tick at or after current_tick where a level 0 slot fires or a coarser slot cascades
+  u64 next_event_tick()
+  {
+    if (!active) return TIMER_NEVER;
+
+    u64 next = TIMER_NEVER;
+    for (int level = 0; level < TIMER_LEVELS; level++) {
+      if (!occupied[level]) continue;
+
+      int shift    = TIMER_LEVEL_BITS * level;
+      u64 base     = current_tick >> shift;
+      int start    = base & (TIMER_SLOTS - 1);
+      bool aligned = (current_tick & ((1ull << shift) - 1)) == 0;
+
+      // at level 0 every tick is aligned. above that, a slot whose boundary has already passed is
+      // next cascaded a full rotation later
+      u64 rotated = occupied[level] >> start;
+      if (start) rotated |= occupied[level] << (TIMER_SLOTS - start);
+      u64 steps;
+      if (aligned && (rotated & 1)) {
+        steps = 0;
+      } else if (rotated & ~1ull) {
+        steps = __builtin_ctzll(rotated & ~1ull);
+      } else {
+        steps = TIMER_SLOTS;
+      }
+
+      u64 tick = (base + steps) << shift;
+      if (tick < next) next = tick;
+    }
+    return next;
+  }
+};
@@ -2,65 +2,355 @@
 
 #include <inttypes.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 #include "common.hpp"
+#include "util/virtual_memory.hpp"
 
 #define DEBUG_PRINT printf
 
+// a counter with one writer that any thread can read
+struct StatCounter {
+  std::atomic<u64> value = 0;
+
+  u64 get() { return value.load(std::memory_order_relaxed); }
+  void set(u64 to) { value.store(to, std::memory_order_relaxed); }
+  void add(i64 n) { set(get() + n); }
+  void raise(u64 to)
+  {
+    if (to > get()) set(to);
+  }
+};
+
+// opt-in accounting for an arena, turned on with StackAllocator::track(). only the thread using the
+// arena writes it, so it costs no locking, and a dump from another thread sees it a little stale.
+//
+// allocations are counted against the tag of the innermost ArenaTag or tagged Temp on the arena. a
+// scratch arena is one that's meant to be used through Temp scopes, anything allocated on it
+// outside of one stays until a reset, and is counted as unscoped.
+const u32 ARENA_STATS_TAGS   = 16;
+const u32 MAX_TRACKED_ARENAS = 64;
+
+struct ArenaStats {
+  struct Tag {
+    const char *name = nullptr;
+    StatCounter allocations;
+    StatCounter bytes;
+  };
+
+  char name[32] = {};
+  bool scratch  = false;
+
+  StatCounter in_use;
+  StatCounter high_water;
+  StatCounter committed;
+  StatCounter reserved;
+  StatCounter allocations;
+  StatCounter chained_blocks;
+  StatCounter temp_scopes;
+  StatCounter biggest_temp;
+  StatCounter unscoped_bytes;
+  StatCounter unscoped_allocations;
+
+  // the last row also takes whatever doesn't fit
+  Tag tags[ARENA_STATS_TAGS];
+  std::atomic<u32> tag_count = 0;
+
+  const char *tag = nullptr;
+  u32 temp_depth  = 0;
+
+  void count(u64 bytes)
+  {
+    allocations.add(1);
+    if (scratch && !temp_depth) {
+      unscoped_bytes.add(bytes);
+      unscoped_allocations.add(1);
+    }
+
+    const char *name = tag ? tag : "untagged";
+    u32 rows         = tag_count.load(std::memory_order_relaxed);
+    u32 row          = 0;
+    while (row < rows && tags[row].name != name) row++;
+    if (row == rows) {
+      row = std::min(rows, ARENA_STATS_TAGS - 1);
+      if (row == rows) {
+        tags[row].name = name;
+        tag_count.store(rows + 1, std::memory_order_release);
+      } else {
+        tags[row].name = "other";
+      }
+    }
+    tags[row].allocations.add(1);
+    tags[row].bytes.add(bytes);
+  }
+
+  void print()
+  {
+    printf("%-24s %10llu used %10llu peak %10llu committed %12llu reserved %8llu allocs\n", name,
+           (unsigned long long)in_use.get(), (unsigned long long)high_water.get(),
+           (unsigned long long)committed.get(), (unsigned long long)reserved.get(),
+           (unsigned long long)allocations.get());
+    printf("%-24s %10llu chained blocks, %llu temp scopes, biggest %llu\n", "",
+           (unsigned long long)chained_blocks.get(), (unsigned long long)temp_scopes.get(),
+           (unsigned long long)biggest_temp.get());
+    if (unscoped_allocations.get()) {
+      printf("%-24s %10llu bytes in %llu allocations outside any temp scope\n", "",
+             (unsigned long long)unscoped_bytes.get(),
+             (unsigned long long)unscoped_allocations.get());
+    }
+    u32 rows = tag_count.load(std::memory_order_acquire);
+    for (u32 i = 0; i < rows; i++) {
+      printf("  %-22s %10llu bytes in %llu allocations\n", tags[i].name,
+             (unsigned long long)tags[i].bytes.get(),
+             (unsigned long long)tags[i].allocations.get());
+    }
+  }
+};
+
+// every tracked arena, in the order they were tracked. entries are never removed
+ArenaStats *tracked_arenas[MAX_TRACKED_ARENAS];
+std::atomic<u32> tracked_arena_count = 0;
+
+void print_arena_stats()
+{
+  u32 count = tracked_arena_count.load(std::memory_order_acquire);
+  for (u32 i = 0; i < count; i++) tracked_arenas[i]->print();
+}
+
+// an arena over reserved address space. memory is committed ARENA_COMMIT_SIZE at a time as
+// allocations reach it, so a generous reservation costs nothing until it's used. an arena that runs
+// out of room chains on another block rather than failing, and free() and reset() unwind back
+// through the chain, giving chained blocks back. reset(true) also decommits what the first block
+// committed past its first ARENA_COMMIT_SIZE, for arenas that had a one off spike.
+//
+// init(from, size) carves the first block out of another arena instead, that block is never
+// committed or given back by this one. allocations are byte aligned unless asked otherwise, so
+// consecutive byte allocations are contiguous within a block.
+const u64 ARENA_COMMIT_SIZE = 64 * 1024;
+
 struct StackAllocator {
-  char *beg, *end, *next;
+  // what a chained block starts with: the block it was chained on to
+  struct Block {
+    char *beg, *end, *next, *committed;
+    Block *prev;
+    u64 below;
+    u64 reserved;
+  };
+  static constexpr u64 BLOCK_HEADER_SIZE = (sizeof(Block) + 15) & ~15ull;
+
+  // the block being allocated from
+  char *beg = nullptr, *end = nullptr, *next = nullptr;
+  char *committed = nullptr;
+  Block *block    = nullptr;  // null while in the first block
+  u64 below       = 0;        // bytes in use in the blocks before this one
+
+  u64 block_size  = 0;  // chained blocks reserve at least this
+  bool owns_first = false;
+
+  char *last_allocation    = nullptr;
+  u64 last_allocation_size = 0;
 
-  char *last_allocation         = nullptr;
-  uint32_t last_allocation_size = 0;
+  ArenaStats *stats = nullptr;
 
-  void init(StackAllocator *from, uint64_t size)
+  void init(StackAllocator *from, u64 size)
   {
-    beg  = (char *)from->alloc(size);
-    next = beg;
-    end  = beg + size;
+    beg        = from->alloc(size, 16);
+    next       = beg;
+    end        = beg + size;
+    committed  = end;
+    block      = nullptr;
+    below      = 0;
+    block_size = vm_round_up(size, VM_PAGE_SIZE);
+    owns_first = false;
+    if (stats) stats->reserved.set(size);
   }
 
   void init(u64 size)
   {
-    beg  = (char *)malloc(size);
-    next = beg;
-    end  = beg + size;
+    block_size = vm_round_up(size, VM_PAGE_SIZE);
+    beg        = vm_reserve(block_size);
+    assert(beg);
+    next       = beg;
+    end        = beg + block_size;
+    committed  = beg;
+    block      = nullptr;
+    below      = 0;
+    owns_first = true;
+    if (stats) stats->reserved.set(block_size);
+  }
+
+  // starts accounting for this arena under name, see ArenaStats
+  void track(const char *name, bool scratch = false)
+  {
+    u32 index = tracked_arena_count.load(std::memory_order_relaxed);
+    while (true) {
+      if (index >= MAX_TRACKED_ARENAS) return;
+      if (tracked_arena_count.compare_exchange_weak(index, index + 1)) break;
+    }
+
+    stats          = new ArenaStats;
+    stats->scratch = scratch;
+    snprintf(stats->name, sizeof(stats->name), "%s", name);
+    stats->reserved.set(end - beg);
+    stats->committed.set(owns_first ? committed - beg : 0);
+    stats->in_use.set(in_use());
+    tracked_arenas[index] = stats;
   }
 
-  void reset() { next = beg; }
+  u64 in_use() { return below + (next - beg); }
 
-  char *alloc(uint32_t size)
+  // gives everything back. the arena can be init()ed again after
+  void deinit()
   {
-    assert(next + size < end);
+    while (block) pop_block();
+    if (owns_first) vm_release(beg, end - beg);
+    if (stats) {
+      stats->reserved.set(0);
+      stats->committed.set(0);
+      stats->in_use.set(0);
+    }
+    beg = end = next = committed = nullptr;
+    last_allocation = nullptr;
+  }
 
-    char *ret = next;
-    next += size;
+  void reset(bool decommit = false)
+  {
+    while (block) pop_block();
+    next            = beg;
+    last_allocation = nullptr;
+
+    char *keep = std::min(beg + ARENA_COMMIT_SIZE, end);
+    if (decommit && owns_first && committed > keep) {
+      vm_decommit(keep, committed - keep);
+      if (stats) stats->committed.add(-(i64)(committed - keep));
+      committed = keep;
+    }
+    if (stats) stats->in_use.set(0);
+  }
+
+  // align is a power of 2
+  char *alloc(u64 size, u64 align = 1)
+  {
+    char *ret = align_up(next, align);
+    if (ret + size > end) {
+      chain(size + align);
+      ret = align_up(next, align);
+    }
+    if (ret + size > committed) commit(ret + size);
+
+    next = ret + size;
 
     last_allocation      = ret;
     last_allocation_size = size;
 
+    if (stats) {
+      stats->count(size);
+      stats->in_use.set(in_use());
+      stats->high_water.raise(in_use());
+    }
     return ret;
   }
 
-  char *resize(char *ptr, uint32_t size)
+  template <typename T>
+  T *alloc(u64 count = 1)
   {
-    if (!ptr || ptr != last_allocation) return alloc(size);
+    return (T *)alloc(count * sizeof(T), alignof(T));
+  }
+
+  // grows or shrinks the last allocation in place if it can. anything else gets a new allocation,
+  // and copying over is up to the caller
+  char *resize(char *ptr, u64 size, u64 align = 1)
+  {
+    if (!ptr || ptr != last_allocation || ptr + size > end) return alloc(size, align);
+    if (ptr + size > committed) commit(ptr + size);
 
     last_allocation_size = size;
     next                 = last_allocation + size;
+
+    if (stats) {
+      stats->in_use.set(in_use());
+      stats->high_water.raise(in_use());
+    }
     return ptr;
   }
 
   void free(void *loc)
   {
-    assert(loc >= beg && loc < end);
+    while (block && (loc < beg || loc > end)) pop_block();
+    assert(loc >= beg && loc <= end);
 
     if (loc < next) {
       next = (char *)loc;
     }
+    if (stats) stats->in_use.set(in_use());
+  }
+
+  static char *align_up(char *ptr, u64 align)
+  {
+    return (char *)(((uintptr_t)ptr + align - 1) & ~(uintptr_t)(align - 1));
+  }
+
+  // commit granules are aligned in the address space, so they never straddle two blocks
+  void commit(char *upto)
+  {
+    char *to = std::min((char *)vm_round_up((uintptr_t)upto, ARENA_COMMIT_SIZE), end);
+    if (!vm_commit(committed, to - committed)) {
+      DEBUG_PRINT("failed to commit arena memory\n");
+      assert(false);
+    }
+    if (stats) stats->committed.add(to - committed);
+    committed = to;
+  }
+
+  // moves on to a new block with room for at least size
+  void chain(u64 size)
+  {
+    u64 reserved = vm_round_up(std::max(block_size, size + BLOCK_HEADER_SIZE), VM_PAGE_SIZE);
+    char *base   = vm_reserve(reserved);
+    assert(base);
+
+    Block header = {beg, end, next, committed, block, below, reserved};
+    below += next - beg;
+    beg       = base + BLOCK_HEADER_SIZE;
+    next      = beg;
+    end       = base + reserved;
+    committed = base;
+    if (stats) {
+      stats->chained_blocks.add(1);
+      stats->reserved.add(reserved);
+    }
+    commit(beg);
+
+    block  = (Block *)base;
+    *block = header;
+  }
+
+  // gives the current block back and picks up where the one before it left off
+  void pop_block()
+  {
+    Block header = *block;
+    if (stats) {
+      stats->reserved.add(-(i64)header.reserved);
+      stats->committed.add(-(i64)(committed - (char *)block));
+    }
+    vm_release((char *)block, header.reserved);
+
+    beg             = header.beg;
+    end             = header.end;
+    next            = header.next;
+    committed       = header.committed;
+    block           = header.prev;
+    below           = header.below;
+    last_allocation = nullptr;
   }
 };
 
@@ -69,28 +359,177 @@ struct Memory {
   StackAllocator *temp;
 };
 
+// counts allocations on a tracked arena against tag until it goes out of scope. tags are compared
+// by address, so use string literals
+struct ArenaTag {
+  ArenaStats *stats    = nullptr;
+  const char *previous = nullptr;
+
+  ArenaTag(StackAllocator *allocator, const char *tag)
+  {
+    stats = allocator->stats;
+    if (!stats) return;
+    previous   = stats->tag;
+    stats->tag = tag;
+  }
+  ~ArenaTag()
+  {
+    if (stats) stats->tag = previous;
+  }
+};
+
+// everything allocated on the arena while this is in scope is freed when it ends
 struct Temp {
   StackAllocator *allocator;
   char *data = nullptr;
 
-  Temp(Memory mem)
-  {
-    allocator = mem.temp;
-    data      = mem.temp->next;
-  }
-  Temp(StackAllocator *alloc)
+  u64 in_use_at_start  = 0;
+  const char *tag      = nullptr;
+  const char *previous = nullptr;
+
+  Temp(Memory mem, const char *tag = nullptr) : Temp(mem.temp, tag) {}
+  Temp(StackAllocator *alloc, const char *tag = nullptr)
   {
     allocator = alloc;
     data      = alloc->next;
+
+    if (ArenaStats *stats = alloc->stats) {
+      stats->temp_scopes.add(1);
+      stats->temp_depth++;
+      in_use_at_start = alloc->in_use();
+      this->tag       = tag;
+      if (tag) {
+        previous   = stats->tag;
+        stats->tag = tag;
+      }
+    }
+  }
+  ~Temp()
+  {
+    if (ArenaStats *stats = allocator->stats) {
+      stats->temp_depth--;
+      u64 in_use = allocator->in_use();
+      if (in_use > in_use_at_start) stats->biggest_temp.raise(in_use - in_use_at_start);
+      if (tag) stats->tag = previous;
+    }
+    allocator->free(data);
   }
-  ~Temp() { allocator->free(data); }
 
-  static Temp start(Memory mem) { return Temp(mem); }
-  static Temp start(StackAllocator *alloc) { return Temp(alloc); }
+  static Temp start(Memory mem, const char *tag = nullptr) { return Temp(mem, tag); }
+  static Temp start(StackAllocator *alloc, const char *tag = nullptr) { return Temp(alloc, tag); }
 
   operator StackAllocator *() { return allocator; }
 };
 
+// every thread gets its own scratch arena, reserved the first time the thread asks for it and given
+// back when the thread exits. nothing is shared, so worker threads can allocate without locking as
+// long as what they allocate doesn't outlive the Scratch scope it came from.
+const u64 THREAD_SCRATCH_RESERVE = 256ull * 1024 * 1024;
+
+struct ThreadScratch {
+  StackAllocator arena;
+  ~ThreadScratch() { arena.deinit(); }
+};
+
+StackAllocator *thread_scratch()
+{
+  thread_local ThreadScratch scratch;
+  if (!scratch.arena.beg) scratch.arena.init(THREAD_SCRATCH_RESERVE);
+  return &scratch.arena;
+}
+
+// a Temp on the calling thread's scratch arena
+struct Scratch : Temp {
+  Scratch(const char *tag = nullptr) : Temp(thread_scratch(), tag) {}
+};
+
+// a bump allocator any number of threads can allocate from at once, for output shared between
+// them. an allocation is one atomic add, pages are committed by whichever thread first reaches
+// them. nothing is freed individually, reset() and deinit() must not race allocations.
+struct ConcurrentArena {
+  char *base   = nullptr;
+  u64 reserved = 0;
+  std::atomic<u64> used      = 0;
+  std::atomic<u64> committed = 0;
+
+  void init(u64 size)
+  {
+    reserved = vm_round_up(size, VM_PAGE_SIZE);
+    base     = vm_reserve(reserved);
+    assert(base);
+    used.store(0);
+    committed.store(0);
+  }
+
+  void deinit()
+  {
+    if (base) vm_release(base, reserved);
+    base     = nullptr;
+    reserved = 0;
+    used.store(0);
+    committed.store(0);
+  }
+
+  // keeps what's committed so the next round of allocations doesn't fault it in again
+  void reset() { used.store(0); }
+
+  // align is a power of 2 no bigger than a page
+  char *alloc(u64 size, u64 align = 1)
+  {
+    u64 start = used.fetch_add(size + align - 1, std::memory_order_relaxed);
+    start     = (start + align - 1) & ~(align - 1);
+    if (start + size > reserved) {
+      DEBUG_PRINT("ConcurrentArena overfull\n");
+      assert(false);
+      return nullptr;
+    }
+    commit(start + size);
+    return base + start;
+  }
+
+  template <typename T>
+  T *alloc(u64 count = 1)
+  {
+    return (T *)alloc(count * sizeof(T), alignof(T));
+  }
+
+  // every commit runs from the committed mark up, so a thread that sees the mark past its
+  // allocation knows all of it is backed, whoever committed it. racing commits of the same pages
+  // are harmless
+  void commit(u64 upto)
+  {
+    u64 mark = committed.load(std::memory_order_acquire);
+    while (mark < upto) {
+      u64 to = std::min(vm_round_up(upto, ARENA_COMMIT_SIZE), reserved);
+      if (!vm_commit(base + mark, to - mark)) {
+        DEBUG_PRINT("failed to commit arena memory\n");
+        assert(false);
+      }
+      if (committed.compare_exchange_weak(mark, to, std::memory_order_acq_rel)) return;
+    }
+  }
+};
+
+// an array of T that threads can append to at once, indexed like any array. it never moves
+template <typename T>
+struct ConcurrentArray {
+  ConcurrentArena arena;
+
+  void init(u64 max_count) { arena.init(max_count * sizeof(T)); }
+  void deinit() { arena.deinit(); }
+  void clear() { arena.reset(); }
+
+  // index of the first of count new, uninitialized elements
+  i32 push_back(i32 count = 1)
+  {
+    return (i32)((arena.alloc(count * sizeof(T)) - arena.base) / sizeof(T));
+  }
+
+  u32 size() { return arena.used.load(std::memory_order_acquire) / sizeof(T); }
+
+  T &operator[](i32 i) { return ((T *)arena.base)[i]; }
+};
+
 template <typename T>
 struct RefArray {
   RefArray() = default;
@@ -154,73 +593,273 @@ struct Array {
 
   void clear() { len = 0; }
 
+  T *begin() { return arr; }
+  T *end() { return arr + len; }
+
   T arr[N];
   size_t len                  = 0;
   const static size_t MAX_LEN = N;
 };
 
-// TODO this isn't really a freelist, more just a object pool
+// a fixed pool of T addressed by id, for assets and entities. values never move, so a pointer into
+// the pool is good until its element is removed, and ids can be chosen by the caller when they come
+// from a file.
+//
+// ids are kept as a sparse set: order holds every id, the ones in use packed at the front and the
+// free ones after them, and positions says where each id sits in order. adding or removing an id
+// swaps it across the boundary, so both are constant time and iterating walks just the packed
+// front. the order is whatever adds and removes left it in, and a removed id is the next one handed
+// out.
+//
+// every slot counts how many times it has been removed. handle() folds that count into the id, a
+// handle kept past a remove resolves to nullptr rather than to whatever took the slot next
 template <typename T>
-struct FreeList {
-  struct Element {
-    bool assigned;
-    union {
-      T value;
-      Element *next;
-    };
+struct Pool {
+  T *values        = nullptr;
+  u32 *generations = nullptr;
+  u32 *order       = nullptr;  // ids in use, then free ids
+  u32 *positions   = nullptr;  // where each id is in order
+  u32 capacity     = 0;
+  u32 len          = 0;
+  u32 index_bits   = 0;
+
+  struct Iterator {
+    T *values;
+    u32 *at;
+
+    T &operator*() { return values[*at]; }
+    Iterator &operator++()
+    {
+      at++;
+      return *this;
+    }
+    bool operator!=(const Iterator &other) { return at != other.at; }
   };
 
-  Element *data = nullptr;
-  int size      = 0;
-  Element *next = nullptr, *last = nullptr;
+  void init(StackAllocator *allocator, u32 capacity)
+  {
+    this->capacity = capacity;
+    len            = 0;
+    index_bits     = 0;
+    while ((1u << index_bits) < capacity) index_bits++;
+
+    values      = allocator->alloc<T>(capacity);
+    generations = allocator->alloc<u32>(capacity);
+    order       = allocator->alloc<u32>(capacity);
+    positions   = allocator->alloc<u32>(capacity);
+    for (u32 i = 0; i < capacity; i++) {
+      generations[i] = 1;
+      order[i]       = i;
+      positions[i]   = i;
+    }
+  }
+
+  bool contains(i32 id) { return id >= 0 && (u32)id < capacity && positions[id] < len; }
 
-  void init(StackAllocator *allocator, int size)
+  // moves id to position in order, whatever was there takes id's old place
+  void swap_into(u32 id, u32 position)
   {
-    this->size = size;
-    data       = (Element *)allocator->alloc(size * sizeof(Element));
-    next       = data;
-    last       = next;
+    u32 other            = order[position];
+    order[position]      = id;
+    order[positions[id]] = other;
+    positions[other]     = positions[id];
+    positions[id]        = position;
+  }
 
-    for (int i = 0; i < size; i++) {
-      free(data + i);
-    }
+  // takes a free id, -1 if the pool is full
+  i32 push_back(T value)
+  {
+    if (len >= capacity) return -1;
+
+    i32 id = order[len];
+    emplace(std::move(value), id);
+    return id;
   }
 
-  int push_back(T value)
+  // replaces whatever was in id
+  T *emplace(T value, i32 id)
   {
-    Element *current = next;
-    if (!current) {
-      return -1;
+    assert(id >= 0 && (u32)id < capacity);
+
+    if (contains(id)) {
+      values[id] = std::move(value);
+      return &values[id];
     }
+    swap_into(id, len);
+    len++;
+    return new (&values[id]) T(std::move(value));
+  }
+
+  void remove(i32 id)
+  {
+    if (!contains(id)) return;
 
-    next = current->next;
+    len--;
+    swap_into(id, len);
+    values[id].~T();
+
+    u32 generation_mask = (u32)((1ull << (32 - index_bits)) - 1);
+    u32 generation      = (generations[id] + 1) & generation_mask;
+    generations[id]     = generation ? generation : 1;
+  }
+
+  T *get(i32 id) { return contains(id) ? &values[id] : nullptr; }
+
+  T &operator[](i32 id)
+  {
+    assert(contains(id));
+    return values[id];
+  }
 
-    current->value    = value;
-    current->assigned = true;
+  i32 id_of(T *value) { return value - values; }
 
-    return current - data;
+  u32 handle(i32 id) { return (generations[id] << index_bits) | id; }
+
+  // nullptr once the element the handle was made for is gone
+  T *get_by_handle(u32 handle)
+  {
+    u32 id = handle & ((1u << index_bits) - 1);
+    if (id >= capacity || generations[id] != handle >> index_bits) return nullptr;
+    return get(id);
   }
 
-  T *emplace(T &value, int index)
+  Iterator begin() { return {values, order}; }
+  Iterator end() { return {values, order + len}; }
+
+  // the ids in use
+  struct Ids {
+    u32 *first, *last;
+    u32 *begin() { return first; }
+    u32 *end() { return last; }
+  };
+  Ids ids() { return {order, order + len}; }
+};
+
+// hands out generational handles. the low index_bits pick a slot and the bits above that count how
+// many times the slot has been reused, so a stale handle never matches the slot's next owner.
+// handles are never 0
+struct HandleAllocator {
+  u32 capacity        = 0;
+  u32 index_bits      = 0;
+  u32 generation_mask = 0;
+  u32 *generations    = nullptr;
+  u32 *free_indices   = nullptr;
+  u32 free_count      = 0;
+
+  // handle_bits caps the size of a handle, e.g. 31 so it fits in a positive i32
+  void init(u32 capacity, u32 handle_bits)
   {
-    if (next == &data[index]) {
-      next = data[index].next;
+    this->capacity = capacity;
+    index_bits     = 0;
+    while ((1u << index_bits) < capacity) index_bits++;
+    assert(index_bits < handle_bits);
+    generation_mask = (1u << (handle_bits - index_bits)) - 1;
+
+    generations  = (u32 *)malloc(capacity * sizeof(u32));
+    free_indices = (u32 *)malloc(capacity * sizeof(u32));
+    for (u32 i = 0; i < capacity; i++) {
+      generations[i]  = 1;
+      free_indices[i] = capacity - 1 - i;
     }
-    data[index].value    = value;
-    data[index].assigned = true;
+    free_count = capacity;
+  }
+
+  // 0 if every slot is taken
+  u32 alloc()
+  {
+    if (free_count == 0) return 0;
+
+    u32 index = free_indices[--free_count];
+    return (generations[index] << index_bits) | index;
+  }
+
+  void release(u32 handle)
+  {
+    if (!is_live(handle)) return;
+
+    u32 index          = index_of(handle);
+    u32 generation     = (generations[index] + 1) & generation_mask;
+    generations[index] = generation ? generation : 1;
+    free_indices[free_count++] = index;
+  }
+
+  bool is_live(u32 handle)
+  {
+    u32 index = index_of(handle);
+    return handle && index < capacity && generations[index] == handle >> index_bits;
+  }
+
+  u32 index_of(u32 handle) { return handle & ((1u << index_bits) - 1); }
+
+  // the handle live in index, or the one it will hand out next if it's free
+  u32 handle_at(u32 index) { return (generations[index] << index_bits) | index; }
+};
+
+// values packed densely and addressed by handles from a HandleAllocator with the same index_bits.
+// lookups are one hop through the sparse index and removal swaps the last value into the gap, so
+// pointers into the map only last until the next remove. storage is reserved up front and never
+// grows
+template <typename T>
+struct SlotMap {
+  T *values        = nullptr;
+  u32 *handles     = nullptr;  // handle of each packed value
+  u32 *dense_index = nullptr;  // slot index -> position in values
+  u32 index_mask   = 0;
+  u32 capacity     = 0;
+  u32 len          = 0;
+
+  void init(u32 capacity, u32 index_bits)
+  {
+    this->capacity = capacity;
+    index_mask     = (1u << index_bits) - 1;
+
+    // calloc so untouched capacity stays uncommitted
+    values      = (T *)calloc(capacity, sizeof(T));
+    handles     = (u32 *)calloc(capacity, sizeof(u32));
+    dense_index = (u32 *)calloc(index_mask + 1, sizeof(u32));
+  }
+
+  // nullptr if the handle's slot is already occupied or the map is full
+  T *insert(u32 handle, T value)
+  {
+    if (len >= capacity || contains_slot(handle)) return nullptr;
 
-    return &data[index].value;
+    dense_index[handle & index_mask] = len;
+    handles[len]                     = handle;
+    T *added                         = new (&values[len]) T(value);
+    len++;
+    return added;
   }
 
-  void free(Element *elem)
+  T *get(u32 handle)
   {
-    elem->assigned = false;
-    elem->next     = nullptr;
-    last->next     = elem;
-    last           = elem;
+    u32 i = dense_index[handle & index_mask];
+    return i < len && handles[i] == handle ? &values[i] : nullptr;
   }
 
-  int index_of(T *ptr) { return ((Element *)ptr - data); }
+  void remove(u32 handle)
+  {
+    u32 i = dense_index[handle & index_mask];
+    if (i >= len || handles[i] != handle) return;
+
+    u32 last = len - 1;
+    if (i != last) {
+      values[i]                               = values[last];
+      handles[i]                              = handles[last];
+      dense_index[handles[last] & index_mask] = i;
+    }
+    values[last].~T();
+    len--;
+  }
+
+  bool contains_slot(u32 handle)
+  {
+    u32 i = dense_index[handle & index_mask];
+    return i < len && (handles[i] & index_mask) == (handle & index_mask);
+  }
+
+  T *begin() { return values; }
+  T *end() { return values + len; }
 };
 
 template <size_t N>
@@ -342,7 +981,7 @@ struct String {
   {
     String ret;
     ret.data = allocator->alloc(15);  // should never be more than 15 digits, right
-    _itoa_s(i, ret.data, 15, 10);
+    snprintf(ret.data, 15, "%u", i);
     ret.len = strlen(ret.data);
     return ret;
   }
@@ -351,7 +990,7 @@ struct String {
   {
     String ret;
     ret.data = allocator->alloc(15);  // should never be more than 15 digits, right
-    _itoa_s(i, ret.data, 15, 10);
+    snprintf(ret.data, 15, "%d", i);
     ret.len = strlen(ret.data);
     return ret;
   }
@@ -455,56 +1094,190 @@ struct Optional {
   constexpr static NoVal empty = {};
 };
 
-template <typename T, u32 INITIAL_CAPACITY = 2>
+// a growable array. the first INLINE_CAPACITY elements live in the array itself, past that they
+// go in the allocator it was made with, or on the heap without one. an arena buffer that's still
+// the arena's last allocation grows in place, any other is left behind in the arena when it grows
+// and stays there until the arena resets, so arrays that grow while other things are allocated
+// can leave a few times their size behind. INLINE_CAPACITY makes every array that much bigger, so
+// it's for arrays that usually stay small. reserve() sizes one up front instead.
+//
+// copies are deep and moves take the buffer. a heap buffer is freed when the array is destroyed or
+// deinit(), an arena buffer goes with its arena. elements that are trivially copyable are moved
+// around with memcpy and realloc, anything else is moved one at a time
+template <typename T, u32 INLINE_CAPACITY = 0>
 struct DynamicArray {
-  T *elements  = nullptr;
-  u32 count    = 0;
-  u32 capacity = INITIAL_CAPACITY;
+  static constexpr bool TRIVIAL = std::is_trivially_copyable<T>::value;
 
-  StackAllocator *allocator;
+  T *elements               = nullptr;
+  u32 count                 = 0;
+  u32 capacity              = INLINE_CAPACITY;
+  StackAllocator *allocator = nullptr;
+
+  alignas(T) char inline_storage[INLINE_CAPACITY ? INLINE_CAPACITY * sizeof(T) : 1];
+
+  DynamicArray() { elements = inline_elements(); }
+  DynamicArray(StackAllocator *allocator) : allocator(allocator) { elements = inline_elements(); }
+
+  DynamicArray(const DynamicArray &other) : allocator(other.allocator)
+  {
+    elements = inline_elements();
+    copy_from(other);
+  }
+  DynamicArray(DynamicArray &&other) : allocator(other.allocator)
+  {
+    elements = inline_elements();
+    take(other);
+  }
+  ~DynamicArray() { deinit(); }
+  DynamicArray &operator=(const DynamicArray &other)
+  {
+    if (this != &other) {
+      clear();
+      copy_from(other);
+    }
+    return *this;
+  }
+  DynamicArray &operator=(DynamicArray &&other)
+  {
+    if (this != &other) {
+      deinit();
+      allocator = other.allocator;
+      take(other);
+    }
+    return *this;
+  }
+
+  T *inline_elements() { return (T *)inline_storage; }
+  bool is_inline() { return elements == inline_elements(); }
 
-  DynamicArray() = default;
-  DynamicArray(StackAllocator *allocator)
+  // gives a heap buffer back, an arena buffer stays where it is until the arena resets
+  void deinit()
   {
-    this->allocator = allocator;
-    elements        = (T *)allocator->alloc(sizeof(T) * capacity);
+    clear();
+    if (!allocator && !is_inline()) free(elements);
+    elements = inline_elements();
+    capacity = INLINE_CAPACITY;
   }
 
-  void resize(u32 new_size)
+  static void relocate(T *to, T *from, u32 n)
   {
-    T *new_elements = (T *)allocator->resize((char *)elements, sizeof(T) * new_size);
+    if constexpr (TRIVIAL) {
+      memmove(to, from, n * sizeof(T));
+    } else if (to < from) {
+      for (u32 i = 0; i < n; i++) {
+        new (&to[i]) T(std::move(from[i]));
+        from[i].~T();
+      }
+    } else {
+      for (u32 i = n; i-- > 0;) {
+        new (&to[i]) T(std::move(from[i]));
+        from[i].~T();
+      }
+    }
+  }
 
-    if (new_elements != elements) {
-      u32 to_copy_n = std::min(capacity, new_size);
-      memcpy(new_elements, elements, to_copy_n * sizeof(T));
+  // room for new_capacity elements without growing again. never shrinks
+  void reserve(u32 new_capacity)
+  {
+    if (new_capacity <= capacity) return;
+
+    u64 size = (u64)new_capacity * sizeof(T);
+    T *grown;
+    if (allocator) {
+      // extends the buffer if nothing was allocated after it, otherwise it's a new one
+      char *old = is_inline() ? nullptr : (char *)elements;
+      grown     = (T *)allocator->resize(old, size, alignof(T));
+    } else if (TRIVIAL && !is_inline()) {
+      grown = (T *)realloc(elements, size);
+      assert(grown);
+      elements = grown;
+    } else {
+      grown = (T *)malloc(size);
+      assert(grown);
     }
 
-    capacity = new_size;
-    elements = new_elements;
+    if (grown != elements) {
+      relocate(grown, elements, count);
+      if (!allocator && !is_inline()) free(elements);
+    }
+    elements = grown;
+    capacity = new_capacity;
   }
 
   T &push_back(T val)
   {
-    if (count >= capacity) {
-      resize(capacity * 2);
+    if (count >= capacity) reserve(std::max(capacity * 2, 4u));
+    new (&elements[count]) T(std::move(val));
+    return elements[count++];
+  }
+
+  void append(const T *values, u32 n)
+  {
+    if (count + n > capacity) reserve(std::max(capacity * 2, count + n));
+    if constexpr (TRIVIAL) {
+      memcpy(elements + count, values, n * sizeof(T));
+    } else {
+      for (u32 i = 0; i < n; i++) new (&elements[count + i]) T(values[i]);
     }
-    elements[count] = val;
-    count++;
-    return elements[count - 1];
+    count += n;
+  }
+
+  T pop_back()
+  {
+    assert(count > 0);
+    T val = std::move(elements[--count]);
+    elements[count].~T();
+    return val;
   }
 
   void remove(u32 i)
   {
     assert(i < count);
-    memcpy(elements + i, elements + i + 1, (count - (i + 1)) * sizeof(T));
+    elements[i].~T();
+    relocate(elements + i, elements + i + 1, count - (i + 1));
     count--;
   }
 
-  void clear() { count = 0; }
+  void clear()
+  {
+    if constexpr (!std::is_trivially_destructible<T>::value) {
+      for (u32 i = 0; i < count; i++) elements[i].~T();
+    }
+    count = 0;
+  }
+
+  void copy_from(const DynamicArray &other)
+  {
+    reserve(other.count);
+    if constexpr (TRIVIAL) {
+      memcpy(elements, other.elements, other.count * sizeof(T));
+    } else {
+      for (u32 i = 0; i < other.count; i++) new (&elements[i]) T(other.elements[i]);
+    }
+    count = other.count;
+  }
+
+  // other is left empty
+  void take(DynamicArray &other)
+  {
+    if (other.is_inline()) {
+      relocate(elements, other.elements, other.count);
+    } else {
+      elements = other.elements;
+      capacity = other.capacity;
+    }
+    count          = other.count;
+    other.elements = other.inline_elements();
+    other.count    = 0;
+    other.capacity = INLINE_CAPACITY;
+  }
 
   T &operator[](u32 i)
   {
     assert(i < count);
     return elements[i];
   }
+
+  T *begin() { return elements; }
+  T *end() { return elements + count; }
 };
\ No newline at end of file
@@ -0,0 +1,288 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../common.hpp"
+#include "../util.hpp"
+
+// sorting and deduplicating big arrays of strings. strings order bytewise (as unsigned chars), a
+// string before any longer string it is a prefix of.
+//
+// the sort is a multikey quicksort: a three way partition on one character at a time, so equal
+// prefixes are only ever compared once instead of on every comparison like a comparison sort. big
+// inputs get a first msd radix pass on their leading byte, counted and scattered in parallel, and
+// the resulting buckets are then sorted on separate threads.
+
+const u32 STRING_SORT_INSERTION  = 16;         // ranges below this are insertion sorted
+const u32 STRING_SORT_PARALLEL   = 64 * 1024;  // inputs below this are sorted on one thread
+const u32 STRING_SORT_MAX_THREAD = 16;
+
+u64 hash_string(String str)
+{
+  const u64 K = 0x9E3779B97F4A7C15ull;
+
+  u64 h = (str.len + 1) * K;
+  u32 i = 0;
+  for (; i + 8 <= str.len; i += 8) {
+    u64 word;
+    memcpy(&word, str.data + i, 8);
+    h = (h ^ word) * K;
+    h ^= h >> 32;
+  }
+  u64 tail = 0;
+  memcpy(&tail, str.data + i, str.len - i);
+  h = (h ^ tail) * K;
+
+  // finalize so both the high bits (the probe position) and the low 7 (the tag) are well mixed
+  h ^= h >> 31;
+  h *= 0xBF58476D1CE4E5B9ull;
+  h ^= h >> 29;
+  return h;
+}
+
+// a string with its index in the caller's array, so the sort never chases back through it
+struct SortKey {
+  const u8 *data;
+  u32 len;
+  u32 index;
+};
+
+// the character at depth, 0 past the end so shorter strings sort first
+inline u32 sort_char(SortKey *key, u32 depth)
+{
+  return depth < key->len ? key->data[depth] + 1 : 0;
+}
+
+// a and b are known to be equal before depth
+bool sort_less(SortKey *a, SortKey *b, u32 depth)
+{
+  u32 len = std::min(a->len, b->len);
+  i32 cmp = depth < len ? memcmp(a->data + depth, b->data + depth, len - depth) : 0;
+  return cmp < 0 || (cmp == 0 && a->len < b->len);
+}
+
+void insertion_sort_keys(SortKey *keys, u32 count, u32 depth)
+{
+  for (u32 i = 1; i < count; i++) {
+    SortKey key = keys[i];
+    u32 j       = i;
+    for (; j > 0 && sort_less(&key, &keys[j - 1], depth); j--) {
+      keys[j] = keys[j - 1];
+    }
+    keys[j] = key;
+  }
+}
+
+void multikey_quicksort(SortKey *keys, u32 count, u32 depth)
+{
+  // the equal partition is looped on rather than recursed into, it's the one that can be deep
+  while (count >= STRING_SORT_INSERTION) {
+    u32 a     = sort_char(&keys[0], depth);
+    u32 b     = sort_char(&keys[count / 2], depth);
+    u32 c     = sort_char(&keys[count - 1], depth);
+    u32 pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));
+
+    // [0, lt) < pivot, [lt, i) == pivot, (gt, count) > pivot
+    u32 lt = 0, i = 0, gt = count;
+    while (i < gt) {
+      u32 ch = sort_char(&keys[i], depth);
+      if (ch < pivot) {
+        std::swap(keys[lt++], keys[i++]);
+      } else if (ch > pivot) {
+        std::swap(keys[i], keys[--gt]);
+      } else {
+        i++;
+      }
+    }
+
+    multikey_quicksort(keys, lt, depth);
+    multikey_quicksort(keys + gt, count - gt, depth);
+
+    // strings that all ended here are equal
+    if (pivot == 0) return;
+    keys += lt;
+    count = gt - lt;
+    depth++;
+  }
+  insertion_sort_keys(keys, count, depth);
+}
+
+// buckets keys by their first character into out, each thread counting and then scattering its
+// own slice of the input. bucket_starts gets the 258 bucket boundaries
+void radix_partition(SortKey *keys, SortKey *out, u32 count, u32 threads, u32 *bucket_starts)
+{
+  const u32 BUCKETS = 257;
+  std::vector<u32> counts(threads * BUCKETS, 0);
+  u32 slice = (count + threads - 1) / threads;
+
+  auto run = [&](auto &&work) {
+    std::vector<std::thread> workers;
+    for (u32 t = 1; t < threads; t++) workers.emplace_back(work, t);
+    work(0);
+    for (std::thread &worker : workers) worker.join();
+  };
+
+  run([&](u32 t) {
+    u32 *thread_counts = &counts[t * BUCKETS];
+    for (u32 i = t * slice; i < std::min(count, (t + 1) * slice); i++) {
+      thread_counts[sort_char(&keys[i], 0)]++;
+    }
+  });
+
+  // turns the counts into each thread's write position in each bucket
+  u32 pos = 0;
+  for (u32 bucket = 0; bucket < BUCKETS; bucket++) {
+    bucket_starts[bucket] = pos;
+    for (u32 t = 0; t < threads; t++) {
+      u32 n                        = counts[t * BUCKETS + bucket];
+      counts[t * BUCKETS + bucket] = pos;
+      pos += n;
+    }
+  }
+  bucket_starts[BUCKETS] = pos;
+
+  run([&](u32 t) {
+    u32 *thread_pos = &counts[t * BUCKETS];
+    for (u32 i = t * slice; i < std::min(count, (t + 1) * slice); i++) {
+      out[thread_pos[sort_char(&keys[i], 0)]++] = keys[i];
+    }
+  });
+}
+
+// sorts the strings picked out by order[0, count) in place. equal strings end up next to each
+// other in no particular order. threads is a cap, small inputs always sort on the calling thread
+void sort_strings(String *strings, u32 *order, u32 count, u32 threads = 1)
+{
+  SortKey *keys = (SortKey *)malloc(std::max(count, 1u) * sizeof(SortKey));
+  for (u32 i = 0; i < count; i++) {
+    String str = strings[order[i]];
+    keys[i]    = {(const u8 *)str.data, str.len, order[i]};
+  }
+
+  threads = std::max(1u, std::min(threads, STRING_SORT_MAX_THREAD));
+  if (threads == 1 || count < STRING_SORT_PARALLEL) {
+    multikey_quicksort(keys, count, 0);
+  } else {
+    SortKey *partitioned = (SortKey *)malloc(count * sizeof(SortKey));
+    u32 bucket_starts[258];
+    radix_partition(keys, partitioned, count, threads, bucket_starts);
+    std::swap(keys, partitioned);
+    free(partitioned);
+
+    // biggest buckets are handed out first so one late, large bucket doesn't hold up the rest.
+    // bucket 0, the empty strings, is already sorted
+    std::vector<u32> buckets;
+    for (u32 bucket = 1; bucket < 257; bucket++) {
+      if (bucket_starts[bucket + 1] - bucket_starts[bucket] > 1) buckets.push_back(bucket);
+    }
+    auto size = [&](u32 bucket) { return bucket_starts[bucket + 1] - bucket_starts[bucket]; };
+    std::sort(buckets.begin(), buckets.end(), [&](u32 a, u32 b) { return size(a) > size(b); });
+
+    std::atomic<u32> next_bucket = 0;
+
+    auto work = [&]() {
+      for (u32 i; (i = next_bucket++) < buckets.size();) {
+        u32 bucket = buckets[i];
+        multikey_quicksort(keys + bucket_starts[bucket], size(bucket), 1);
+      }
+    };
+    std::vector<std::thread> workers;
+    for (u32 t = 1; t < threads; t++) workers.emplace_back(work);
+    work();
+    for (std::thread &worker : workers) worker.join();
+  }
+
+  for (u32 i = 0; i < count; i++) {
+    order[i] = keys[i].index;
+  }
+  free(keys);
+}
+
+// collapses the runs of equal strings in a sorted order to their first string, returning how many
+// are left. rank, when given, gets the position in the collapsed order of every string in the runs
+u32 dedup_sorted(String *strings, u32 *order, u32 count, u32 *rank = nullptr)
+{
+  u32 unique = 0;
+  for (u32 i = 0; i < count; i++) {
+    if (!unique || strings[order[i]] != strings[order[unique - 1]]) {
+      order[unique++] = order[i];
+    }
+    if (rank) rank[order[i]] = unique - 1;
+  }
+  return unique;
+}
+
+// drops repeats with a hash table, keeping the first of each. order gets the indices of the
+// distinct strings in input order and first (when given) the index of every string's first
+// occurrence. cheaper than sorting everything when most strings are repeats
+u32 dedup_hashed(String *strings, u32 count, u32 *order, u32 *first = nullptr)
+{
+  // sized for the distinct strings rather than the input, so a pool full of repeats stays in cache
+  struct Entry {
+    u32 hash;
+    u32 index;  // + 1, 0 when empty
+  };
+  u32 capacity = 1024;
+  Entry *table = (Entry *)calloc(capacity, sizeof(Entry));
+
+  u32 unique = 0;
+  for (u32 i = 0; i < count; i++) {
+    u32 hash = hash_string(strings[i]) >> 32;
+    u32 slot = hash & (capacity - 1);
+    while (table[slot].index &&
+           (table[slot].hash != hash || strings[table[slot].index - 1] != strings[i])) {
+      slot = (slot + 1) & (capacity - 1);
+    }
+    if (first) first[i] = table[slot].index ? table[slot].index - 1 : i;
+
+    if (!table[slot].index) {
+      table[slot]     = {hash, i + 1};
+      order[unique++] = i;
+
+      // grow at half full, reinserting by the stored hashes
+      if (unique * 2 > capacity) {
+        Entry *old = table;
+        capacity *= 2;
+        table = (Entry *)calloc(capacity, sizeof(Entry));
+        for (u32 e = 0; e < capacity / 2; e++) {
+          if (!old[e].index) continue;
+          u32 to = old[e].hash & (capacity - 1);
+          while (table[to].index) to = (to + 1) & (capacity - 1);
+          table[to] = old[e];
+        }
+        free(old);
+      }
+    }
+  }
+
+  free(table);
+  return unique;
+}
+
+// the distinct strings in sorted order: order gets their indices, and rank (when given) each
+// input string's position among them. hash_dedup removes repeats before sorting instead of after,
+// which wins when there are a lot of them. returns the number of distinct strings
+u32 sort_unique_strings(String *strings, u32 count, u32 *order, u32 *rank = nullptr,
+                        b8 hash_dedup = false, u32 threads = 1)
+{
+  if (!hash_dedup) {
+    for (u32 i = 0; i < count; i++) order[i] = i;
+    sort_strings(strings, order, count, threads);
+    return dedup_sorted(strings, order, count, rank);
+  }
+
+  u32 *first = rank ? (u32 *)malloc(std::max(count, 1u) * sizeof(u32)) : nullptr;
+  u32 unique = dedup_hashed(strings, count, order, first);
+  sort_strings(strings, order, unique, threads);
+  if (rank) {
+    for (u32 i = 0; i < unique; i++) rank[order[i]] = i;
+    for (u32 i = 0; i < count; i++) rank[i] = rank[first[i]];
+    free(first);
+  }
+  return unique;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include "../common.hpp"
+
+// address space is reserved up front without any memory behind it, then committed a range at a
+// time as it's needed. everything here works in whole pages, callers pass page aligned addresses
+// and sizes.
+
+const u64 VM_PAGE_SIZE = 4096;
+
+inline u64 vm_round_up(u64 size, u64 granularity)
+{
+  return (size + granularity - 1) & ~(granularity - 1);
+}
+
+// nullptr if the address space isn't there
+char *vm_reserve(u64 size)
+{
+#ifdef _WIN32
+  return (char *)VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+  void *reserved =
+      mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  return reserved == MAP_FAILED ? nullptr : (char *)reserved;
+#endif
+}
+
+bool vm_commit(char *at, u64 size)
+{
+#ifdef _WIN32
+  return VirtualAlloc(at, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+  return mprotect(at, size, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+// the range stays reserved, and reads back as zeros once committed again
+void vm_decommit(char *at, u64 size)
+{
+#ifdef _WIN32
+  VirtualFree(at, size, MEM_DECOMMIT);
+#else
+  madvise(at, size, MADV_DONTNEED);
+  mprotect(at, size, PROT_NONE);
+#endif
+}
+
+void vm_release(char *at, u64 size)
+{
+#ifdef _WIN32
+  VirtualFree(at, 0, MEM_RELEASE);
+#else
+  munmap(at, size);
+#endif
+}
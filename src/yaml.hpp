@@ -177,20 +177,14 @@ Dict *Value::as_dict()
   return (Dict *)this;
 }
 
-void serialize(Value *root, StackAllocator *alloc, int indents = 0, bool should_newline = true)
+void serialize(Value *root, DynamicArray<char> *out, int indents, bool should_newline)
 {
   auto append = [&](String str, bool newline = false) {
     if (newline) {
-      char *next = alloc->alloc(1 + indents * 2);
-      *next++    = '\n';
-      for (int i = 0; i < indents; i++) {
-        *next++ = ' ';
-        *next++ = ' ';
-      }
+      out->push_back('\n');
+      for (int i = 0; i < indents * 2; i++) out->push_back(' ');
     }
-
-    char *next = alloc->alloc(str.len);
-    memcpy(next, str.data, str.len);
+    out->append(str.data, str.len);
   };
 
   switch (root->type) {
@@ -200,7 +194,7 @@ void serialize(Value *root, StackAllocator *alloc, int indents = 0, bool should_
       List::Elem *elem = l->head;
       while (elem) {
         append("- ", elem != l->head || should_newline);
-        serialize(elem->value, alloc, indents + 1, false);
+        serialize(elem->value, out, indents + 1, false);
 
         elem = elem->next;
       }
@@ -214,7 +208,7 @@ void serialize(Value *root, StackAllocator *alloc, int indents = 0, bool should_
 
         append(kp->key, elem != d->head || should_newline);
         append(": ");
-        serialize(kp->value, alloc, indents + 1, true);
+        serialize(kp->value, out, indents + 1, true);
 
         elem = elem->next;
       }
@@ -227,6 +221,16 @@ void serialize(Value *root, StackAllocator *alloc, int indents = 0, bool should_
   }
 }
 
+// the whole document as one contiguous run in alloc, however many blocks the arena chains on to
+// hold it. anything allocated from alloc meanwhile would split it, so nothing else is
+String serialize(Value *root, StackAllocator *alloc)
+{
+  DynamicArray<char> out(alloc);
+  out.reserve(4096);
+  serialize(root, &out, 0, false);
+  return String(out.elements, out.count);
+}
+
 Value *deserialize(char **buf, char *buf_end, StackAllocator *alloc, int indents = 0,
                    bool newline = true)
 {